@@ -0,0 +1,1125 @@
+/*
+ * createfs.c
+ * Builds the filesystem image loaded as a multiboot module, from the
+ * files in a directory. Replaces the prebuilt createfs binary.
+ *
+ *   createfs -i fsdir -o student-distrib/filesys_img [-n inodes] [-z]
+ *
+ * The image is laid out the way student-distrib/filesystem.h reads it:
+ * one boot block, the inode blocks, then the data blocks. On top of
+ * that layout this builder
+ *   - stores each file's blocks contiguously and in order, so the
+ *     kernel's block-run reads copy whole files in one span,
+ *   - describes files with extent inodes (runs of blocks) where they
+ *     fit and indirect inodes otherwise, so files are not limited to
+ *     the 1023 direct blocks of the original inode,
+ *   - stores identical 4 KB blocks once (the kernel copies a shared
+ *     block before writing it),
+ *   - with -z, compresses each block of a file on its own with a small
+ *     LZ coder and stores the file as one contiguous compressed stream,
+ *     when that saves at least one block,
+ *   - sorts the dentries by name after "." and "rtc",
+ *   - turns each subdirectory into a directory inode whose data blocks
+ *     hold its dentries, so a directory is not limited to the 63 slots
+ *     of the boot block,
+ *   - reads the finished image back and checks every file against its
+ *     source before reporting success.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Layout constants, the same as filesystem.h */
+#define FILENAME_LEN 32
+#define BLOCK_SIZE 4096
+#define DENTRY_SIZE 64
+#define DATA_BLOCK_NUM_SIZE 1023
+#define RESERVED_DENTRY 24
+#define RESERVED_BOOT_BLOCK 52
+#define FILE_TYPE_RTC 0
+#define FILE_TYPE_DIRECTORY 1
+#define FILE_TYPE_REGULAR 2
+#define INODE_LAYOUT_EXTENT 0xFFFFFFFE
+#define INODE_LAYOUT_INDIRECT 0xFFFFFFFD
+#define INODE_LAYOUT_COMPRESSED 0xFFFFFFFC
+#define EXTENTS_PER_INODE 340
+#define INDIRECT_PER_INODE 1022
+#define BLOCKS_PER_INDIRECT 1024
+#define COMPRESSED_PER_INODE 1019
+#define FS_MAX_FILE_SIZE 0x7FFFF000
+#define BAD_BLOCK 0xFFFFFFFF
+
+/* Builder limits */
+#define MAX_ROOT_FILES (DENTRY_SIZE - 1)
+#define MAX_DIR_FILES (DATA_BLOCK_NUM_SIZE * (BLOCK_SIZE / DENTRY_SIZE))
+#define MAX_DEPTH 16
+#define DEFAULT_INODES 64
+#define MAX_INODES 4096
+#define DEDUP_HASH_SIZE 4096
+#define FNV64_OFFSET_BASIS 14695981039346656037ULL
+#define FNV64_PRIME 1099511628211ULL
+
+/* Block compression, the same format as student-distrib/lz.h */
+#define LZ_MIN_MATCH 4
+#define LZ_RUN_MASK 15
+#define LZ_LENGTH_MORE 255
+#define LZ_TOKEN_SHIFT 4
+#define LZ_OFFSET_SIZE 2
+#define LZ_HASH_BITS 12
+#define LZ_HASH_MULT 2654435761U
+#define LZ_BOUND (2 * BLOCK_SIZE)
+
+/* On-disk structures, the same as filesystem.h */
+typedef struct dentry
+{
+    int8_t filename[FILENAME_LEN];
+    int32_t filetype;
+    int32_t inode_num;
+    int8_t reserved[RESERVED_DENTRY];
+} dentry_t;
+
+typedef struct boot_block
+{
+    int32_t dir_count;
+    int32_t inode_count;
+    int32_t data_count;
+    int8_t reserved[RESERVED_BOOT_BLOCK];
+    dentry_t direntries[DENTRY_SIZE - 1];
+} boot_block_t;
+
+typedef struct inode
+{
+    int32_t length;
+    int32_t data_block_num[DATA_BLOCK_NUM_SIZE];
+} inode_t;
+
+typedef struct extent
+{
+    uint32_t first;
+    uint32_t start;
+    uint32_t count;
+} extent_t;
+
+typedef struct inode_extent
+{
+    int32_t length;
+    uint32_t layout;
+    uint32_t count;
+    extent_t extents[EXTENTS_PER_INODE];
+} inode_extent_t;
+
+typedef struct inode_indirect
+{
+    int32_t length;
+    uint32_t layout;
+    uint32_t blocks[INDIRECT_PER_INODE];
+} inode_indirect_t;
+
+typedef struct inode_compressed
+{
+    int32_t length;
+    uint32_t layout;
+    uint32_t start;
+    uint32_t size;
+    uint32_t offsets[COMPRESSED_PER_INODE + 1];
+} inode_compressed_t;
+
+/* Every structure fills its slot exactly, or the kernel would misread it */
+typedef char check_dentry_size[(sizeof(dentry_t) == DENTRY_SIZE) ? 1 : -1];
+typedef char check_boot_block_size[(sizeof(boot_block_t) == BLOCK_SIZE) ? 1 : -1];
+typedef char check_inode_size[(sizeof(inode_t) == BLOCK_SIZE) ? 1 : -1];
+typedef char check_extent_size[(sizeof(inode_extent_t) <= BLOCK_SIZE) ? 1 : -1];
+typedef char check_indirect_size[(sizeof(inode_indirect_t) == BLOCK_SIZE) ? 1 : -1];
+typedef char check_compressed_size[(sizeof(inode_compressed_t) == BLOCK_SIZE) ? 1 : -1];
+
+/* One source file or directory */
+typedef struct source
+{
+    char name[FILENAME_LEN + 1];
+    char path[4096];
+    int is_dir;
+    uint8_t* data;
+    uint32_t length;
+    struct source* children;
+    int child_count;
+    int32_t inode;
+} source_t;
+
+/* Chained index from block content hash to data block number */
+typedef struct dedup_entry
+{
+    uint64_t hash;
+    uint32_t block;
+    struct dedup_entry* next;
+} dedup_entry_t;
+
+static source_t root;
+static int file_count;
+static int dir_count;
+static int32_t next_inode;
+
+static uint8_t* blocks;
+static uint32_t block_count;
+static uint32_t block_capacity;
+static dedup_entry_t* dedup[DEDUP_HASH_SIZE];
+static int compress;
+
+/* Counters for the summary */
+static uint32_t blocks_shared;
+static uint32_t runs_total;
+static uint32_t extent_inodes;
+static uint32_t indirect_inodes;
+static uint32_t compressed_inodes;
+static uint32_t blocks_saved;
+
+/* die
+ * 	Description: Prints an error and exits.
+ * 	Inputs: message, argument
+ * 	Outputs: None
+ * 	Side Effects: Exits with status 1.
+ */
+static void die(const char* message, const char* arg)
+{
+    fprintf(stderr, "createfs: %s%s%s\n", message, arg ? ": " : "", arg ? arg : "");
+    exit(1);
+}
+
+/* read_file
+ * 	Description: Loads a whole file into memory.
+ * 	Inputs: file to fill, with its path set
+ * 	Outputs: None
+ * 	Side Effects: Allocates the data, exits on an error.
+ */
+static void read_file(source_t* file)
+{
+    FILE* in;
+    struct stat st;
+
+    if(stat(file->path, &st) == -1)
+    {
+        die(strerror(errno), file->path);
+    }
+    if(st.st_size > (off_t)FS_MAX_FILE_SIZE)
+    {
+        die("file is larger than one inode can hold", file->path);
+    }
+
+    file->length = (uint32_t)st.st_size;
+    file->data = malloc(file->length ? file->length : 1);
+    in = fopen(file->path, "rb");
+    if(file->data == NULL || in == NULL ||
+       fread(file->data, 1, file->length, in) != file->length)
+    {
+        die("cannot read", file->path);
+    }
+    fclose(in);
+}
+
+/* compare_files
+ * 	Description: Orders files by name for qsort.
+ * 	Inputs: a, b
+ * 	Outputs: strcmp order
+ * 	Side Effects: None
+ */
+static int compare_files(const void* a, const void* b)
+{
+    return strcmp(((const source_t*)a)->name, ((const source_t*)b)->name);
+}
+
+/* scan_dir
+ * 	Description: Collects the regular files and subdirectories of a
+ *  directory, descending into the subdirectories. Names longer than
+ *  FILENAME_LEN are cut, like the original createfs did.
+ * 	Inputs: dir (node with its path set), depth
+ * 	Outputs: None
+ * 	Side Effects: Fills the node's children and sorts them by name.
+ */
+static void scan_dir(source_t* dir, int depth)
+{
+    DIR* d;
+    struct dirent* ent;
+    struct stat st;
+    source_t* file;
+    int i, capacity = 0;
+    int limit = (depth == 0) ? MAX_ROOT_FILES - 2 : MAX_DIR_FILES;
+
+    if(depth > MAX_DEPTH)
+    {
+        die("directories are nested too deeply", dir->path);
+    }
+    d = opendir(dir->path);
+    if(d == NULL)
+    {
+        die(strerror(errno), dir->path);
+    }
+
+    while((ent = readdir(d)) != NULL)
+    {
+        if(ent->d_name[0] == '.')
+        {
+            continue;
+        }
+        if(dir->child_count == limit)
+        {
+            die(depth == 0 ? "too many files for one boot block" : "too many files for one directory", dir->path);
+        }
+        if(dir->child_count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 16;
+            dir->children = realloc(dir->children, capacity * sizeof(source_t));
+            if(dir->children == NULL)
+            {
+                die("out of memory", NULL);
+            }
+        }
+
+        file = &dir->children[dir->child_count];
+        memset(file, 0, sizeof(source_t));
+        if((size_t)snprintf(file->path, sizeof(file->path), "%s/%s", dir->path, ent->d_name) >= sizeof(file->path))
+        {
+            die("path is too long", dir->path);
+        }
+        if(stat(file->path, &st) == -1 || (!S_ISREG(st.st_mode) && !S_ISDIR(st.st_mode)))
+        {
+            continue;
+        }
+        memcpy(file->name, ent->d_name, strnlen(ent->d_name, FILENAME_LEN));
+        if(depth == 0 && !strcmp(file->name, "rtc"))
+        {
+            die("name is reserved for the RTC device", file->path);
+        }
+        if(S_ISDIR(st.st_mode))
+        {
+            file->is_dir = 1;
+            scan_dir(file, depth + 1);
+            dir_count++;
+        }
+        else
+        {
+            read_file(file);
+            file_count++;
+        }
+        dir->child_count++;
+    }
+    closedir(d);
+
+    qsort(dir->children, dir->child_count, sizeof(source_t), compare_files);
+    for(i = 1; i < dir->child_count; i++)
+    {
+        if(!strcmp(dir->children[i - 1].name, dir->children[i].name))
+        {
+            die("two names are the same after cutting to 32 bytes", dir->children[i].path);
+        }
+    }
+}
+
+/* block_hash
+ * 	Description: 64-bit FNV-1a hash of one block.
+ * 	Inputs: block
+ * 	Outputs: Return the hash
+ * 	Side Effects: None
+ */
+static uint64_t block_hash(const uint8_t* block)
+{
+    uint64_t hash = FNV64_OFFSET_BASIS;
+    int i;
+
+    for(i = 0; i < BLOCK_SIZE; i++)
+    {
+        hash = (hash ^ block[i]) * FNV64_PRIME;
+    }
+    return hash;
+}
+
+/* append_block
+ * 	Description: Appends a block to the data area without looking for an
+ *  equal one. Block tables go through here, since the kernel changes
+ *  them in place.
+ * 	Inputs: block (BLOCK_SIZE bytes)
+ * 	Outputs: Return the data block number
+ * 	Side Effects: Grows the data area.
+ */
+static uint32_t append_block(const uint8_t* block)
+{
+    if(block_count == block_capacity)
+    {
+        block_capacity = block_capacity ? block_capacity * 2 : 64;
+        blocks = realloc(blocks, (size_t)block_capacity * BLOCK_SIZE);
+        if(blocks == NULL)
+        {
+            die("out of memory", NULL);
+        }
+    }
+    memcpy(blocks + (size_t)block_count * BLOCK_SIZE, block, BLOCK_SIZE);
+    return block_count++;
+}
+
+/* store_block
+ * 	Description: Returns the data block holding a block's content. A block
+ *  equal to one already stored reuses it; anything else is appended.
+ * 	Inputs: block (BLOCK_SIZE bytes, zero padded)
+ * 	Outputs: Return the data block number
+ * 	Side Effects: May grow the data area and the dedup index.
+ */
+static uint32_t store_block(const uint8_t* block)
+{
+    uint64_t hash = block_hash(block);
+    dedup_entry_t* entry;
+
+    for(entry = dedup[hash % DEDUP_HASH_SIZE]; entry != NULL; entry = entry->next)
+    {
+        if(entry->hash == hash && !memcmp(blocks + (size_t)entry->block * BLOCK_SIZE, block, BLOCK_SIZE))
+        {
+            blocks_shared++;
+            return entry->block;
+        }
+    }
+
+    entry = malloc(sizeof(dedup_entry_t));
+    if(entry == NULL)
+    {
+        die("out of memory", NULL);
+    }
+    entry->hash = hash;
+    entry->block = append_block(block);
+    entry->next = dedup[hash % DEDUP_HASH_SIZE];
+    dedup[hash % DEDUP_HASH_SIZE] = entry;
+
+    return entry->block;
+}
+
+/* store_data
+ * 	Description: Stores bytes as the data blocks of an inode and picks
+ *  the inode layout. Files use an extent inode when their runs fit in
+ *  one, directories keep the direct layout the kernel grows cheaply,
+ *  and anything else falls back to an indirect inode.
+ * 	Inputs: inode, data, length, is_dir
+ * 	Outputs: None
+ * 	Side Effects: Fills the inode and the data area.
+ */
+static void store_data(inode_t* inode, const uint8_t* data, uint32_t length, int is_dir)
+{
+    uint32_t j, n, runs = 0;
+    uint32_t* map;
+    uint8_t block[BLOCK_SIZE];
+    inode_extent_t* extent = (inode_extent_t*)inode;
+    inode_indirect_t* indirect = (inode_indirect_t*)inode;
+    uint32_t* table = (uint32_t*)block;
+
+    n = (length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    map = malloc((n ? n : 1) * sizeof(uint32_t));
+    if(map == NULL)
+    {
+        die("out of memory", NULL);
+    }
+    for(j = 0; j < n; j++)
+    {
+        memset(block, 0, BLOCK_SIZE);
+        memcpy(block, data + (size_t)j * BLOCK_SIZE, (j == n - 1) ? length - j * BLOCK_SIZE : BLOCK_SIZE);
+        map[j] = store_block(block);
+
+        /* Count where the inode breaks into a new run */
+        if(j == 0 || map[j] != map[j - 1] + 1)
+        {
+            runs++;
+        }
+    }
+    runs_total += runs;
+
+    inode->length = length;
+    if(n <= DATA_BLOCK_NUM_SIZE && (is_dir || runs > EXTENTS_PER_INODE))
+    {
+        for(j = 0; j < n; j++)
+        {
+            inode->data_block_num[j] = map[j];
+        }
+    }
+    else if(runs <= EXTENTS_PER_INODE)
+    {
+        extent->layout = INODE_LAYOUT_EXTENT;
+        extent->count = 0;
+        for(j = 0; j < n; j++)
+        {
+            if(j == 0 || map[j] != map[j - 1] + 1)
+            {
+                extent->extents[extent->count].first = j;
+                extent->extents[extent->count].start = map[j];
+                extent->count++;
+            }
+            extent->extents[extent->count - 1].count++;
+        }
+        extent_inodes++;
+    }
+    else
+    {
+        indirect->layout = INODE_LAYOUT_INDIRECT;
+        for(j = 0; j < INDIRECT_PER_INODE; j++)
+        {
+            indirect->blocks[j] = BAD_BLOCK;
+        }
+        for(j = 0; j < n; j += BLOCKS_PER_INDIRECT)
+        {
+            memset(block, 0, BLOCK_SIZE);
+            memcpy(table, map + j, ((n - j < BLOCKS_PER_INDIRECT) ? n - j : BLOCKS_PER_INDIRECT) * sizeof(uint32_t));
+            indirect->blocks[j / BLOCKS_PER_INDIRECT] = append_block(block);
+        }
+        indirect_inodes++;
+    }
+
+    free(map);
+}
+
+/* lz_extra
+ * 	Description: Writes the extra length bytes for a length that does
+ *  not fit in its token nibble.
+ * 	Inputs: dst, out (write position), length
+ * 	Outputs: Return the new write position
+ * 	Side Effects: Fills dst.
+ */
+static uint32_t lz_extra(uint8_t* dst, uint32_t out, uint32_t length)
+{
+    if(length < LZ_RUN_MASK)
+    {
+        return out;
+    }
+    for(length -= LZ_RUN_MASK; length >= LZ_LENGTH_MORE; length -= LZ_LENGTH_MORE)
+    {
+        dst[out++] = LZ_LENGTH_MORE;
+    }
+    dst[out++] = length;
+    return out;
+}
+
+/* lz_sequence
+ * 	Description: Writes one sequence: the token, the literals and, when
+ *  match is not 0, the offset and match length.
+ * 	Inputs: dst, out (write position), literals, literal count, offset,
+ *  match (length, 0 for none)
+ * 	Outputs: Return the new write position
+ * 	Side Effects: Fills dst.
+ */
+static uint32_t lz_sequence(uint8_t* dst, uint32_t out, const uint8_t* literals, uint32_t count,
+                            uint32_t offset, uint32_t match)
+{
+    uint32_t token = out++;
+
+    dst[token] = ((count < LZ_RUN_MASK) ? count : LZ_RUN_MASK) << LZ_TOKEN_SHIFT;
+    out = lz_extra(dst, out, count);
+    memcpy(dst + out, literals, count);
+    out += count;
+    if(match == 0)
+    {
+        return out;
+    }
+
+    dst[out++] = offset & 0xFF;
+    dst[out++] = offset >> 8;
+    match -= LZ_MIN_MATCH;
+    dst[token] |= (match < LZ_RUN_MASK) ? match : LZ_RUN_MASK;
+    return lz_extra(dst, out, match);
+}
+
+/* lz_compress
+ * 	Description: Compresses one block greedily, finding matches through
+ *  a table of the last position of each 4-byte hash.
+ * 	Inputs: src, length (at most BLOCK_SIZE), dst (LZ_BOUND bytes)
+ * 	Outputs: Return the compressed size
+ * 	Side Effects: Fills dst.
+ */
+static uint32_t lz_compress(const uint8_t* src, uint32_t length, uint8_t* dst)
+{
+    int32_t table[1 << LZ_HASH_BITS];
+    uint32_t pos = 0, anchor = 0, out = 0;
+    uint32_t hash, match, quad;
+    int32_t cand;
+
+    memset(table, -1, sizeof(table));
+    while(pos + LZ_MIN_MATCH <= length)
+    {
+        memcpy(&quad, src + pos, sizeof(quad));
+        hash = (quad * LZ_HASH_MULT) >> (32 - LZ_HASH_BITS);
+        cand = table[hash];
+        table[hash] = pos;
+        if(cand == -1 || memcmp(src + cand, src + pos, LZ_MIN_MATCH))
+        {
+            pos++;
+            continue;
+        }
+
+        for(match = LZ_MIN_MATCH; pos + match < length && src[cand + match] == src[pos + match]; match++);
+        out = lz_sequence(dst, out, src + anchor, pos - anchor, pos - cand, match);
+        pos += match;
+        anchor = pos;
+    }
+
+    /* Whatever is left goes out as literals */
+    if(anchor < length)
+    {
+        out = lz_sequence(dst, out, src + anchor, length - anchor, 0, 0);
+    }
+    return out;
+}
+
+/* lz_decompress
+ * 	Description: Decodes one block, with the same checks as the kernel's
+ *  decoder, so verify reads compressed files the way the kernel will.
+ * 	Inputs: src, src_len, dst, dst_len (size of dst)
+ * 	Outputs: Return the number of bytes decoded, -1 on a corrupt block
+ * 	Side Effects: Fills dst.
+ */
+static int32_t lz_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len)
+{
+    uint32_t pos = 0, out = 0;
+    uint32_t literals, match, offset, i;
+    uint8_t token, more;
+
+    while(pos < src_len)
+    {
+        token = src[pos++];
+        literals = token >> LZ_TOKEN_SHIFT;
+        if(literals == LZ_RUN_MASK)
+        {
+            do
+            {
+                if(pos >= src_len)
+                {
+                    return -1;
+                }
+                more = src[pos++];
+                literals += more;
+            } while(more == LZ_LENGTH_MORE);
+        }
+        if(literals > src_len - pos || literals > dst_len - out)
+        {
+            return -1;
+        }
+        memcpy(dst + out, src + pos, literals);
+        pos += literals;
+        out += literals;
+        if(pos == src_len)
+        {
+            break;
+        }
+
+        if(src_len - pos < LZ_OFFSET_SIZE)
+        {
+            return -1;
+        }
+        offset = src[pos] | (src[pos + 1] << 8);
+        pos += LZ_OFFSET_SIZE;
+        match = token & LZ_RUN_MASK;
+        if(match == LZ_RUN_MASK)
+        {
+            do
+            {
+                if(pos >= src_len)
+                {
+                    return -1;
+                }
+                more = src[pos++];
+                match += more;
+            } while(more == LZ_LENGTH_MORE);
+        }
+        match += LZ_MIN_MATCH;
+        if(offset == 0 || offset > out || match > dst_len - out)
+        {
+            return -1;
+        }
+        for(i = 0; i < match; i++, out++)
+        {
+            dst[out] = dst[out - offset];
+        }
+    }
+
+    return out;
+}
+
+/* store_compressed
+ * 	Description: Stores a file as a compressed inode. Each block is
+ *  compressed on its own and kept as it is when that does not shrink
+ *  it; the results are appended back to back, without sharing, as one
+ *  contiguous stream.
+ * 	Inputs: inode, data, length
+ * 	Outputs: Return 0, -1 if the file does not fit in a compressed inode
+ *  or compressing it would not save a block
+ * 	Side Effects: Fills the inode and the data area on success.
+ */
+static int store_compressed(inode_t* inode, const uint8_t* data, uint32_t length)
+{
+    inode_compressed_t* node = (inode_compressed_t*)inode;
+    uint32_t j, n, tail, size, total = 0;
+    uint8_t packed[LZ_BOUND];
+    uint8_t block[BLOCK_SIZE];
+    uint8_t* stream;
+
+    n = (length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if(n == 0 || n > COMPRESSED_PER_INODE)
+    {
+        return -1;
+    }
+    stream = malloc((size_t)n * BLOCK_SIZE);
+    if(stream == NULL)
+    {
+        die("out of memory", NULL);
+    }
+
+    for(j = 0; j < n; j++)
+    {
+        tail = (j == n - 1) ? length - j * BLOCK_SIZE : BLOCK_SIZE;
+        size = lz_compress(data + (size_t)j * BLOCK_SIZE, tail, packed);
+        node->offsets[j] = total;
+        if(size < tail)
+        {
+            memcpy(stream + total, packed, size);
+            total += size;
+        }
+        else
+        {
+            memcpy(stream + total, data + (size_t)j * BLOCK_SIZE, tail);
+            total += tail;
+        }
+    }
+    node->offsets[n] = total;
+
+    if((total + BLOCK_SIZE - 1) / BLOCK_SIZE >= n)
+    {
+        memset(inode, 0, sizeof(inode_t));
+        free(stream);
+        return -1;
+    }
+
+    node->length = length;
+    node->layout = INODE_LAYOUT_COMPRESSED;
+    node->start = block_count;
+    node->size = total;
+    for(j = 0; j < total; j += BLOCK_SIZE)
+    {
+        memset(block, 0, BLOCK_SIZE);
+        memcpy(block, stream + j, (total - j < BLOCK_SIZE) ? total - j : BLOCK_SIZE);
+        append_block(block);
+    }
+
+    blocks_saved += n - (total + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    compressed_inodes++;
+    free(stream);
+    return 0;
+}
+
+/* fill_dentry
+ * 	Description: Fills the dentry of a file or directory.
+ * 	Inputs: dentry, file
+ * 	Outputs: None
+ * 	Side Effects: None
+ */
+static void fill_dentry(dentry_t* dentry, const source_t* file)
+{
+    memcpy(dentry->filename, file->name, strlen(file->name));
+    dentry->filetype = file->is_dir ? FILE_TYPE_DIRECTORY : FILE_TYPE_REGULAR;
+    dentry->inode_num = file->inode;
+}
+
+/* build_dir
+ * 	Description: Gives every entry of a directory the next inode, in
+ *  name order and depth first, and stores its data. A subdirectory's
+ *  data is its packed dentries, stored after everything inside it.
+ * 	Inputs: dir, inodes, inode count
+ * 	Outputs: None
+ * 	Side Effects: Fills the inodes and the data area.
+ */
+static void build_dir(source_t* dir, inode_t* inodes, int inode_count)
+{
+    int i;
+    source_t* file;
+    dentry_t* dentries;
+
+    for(i = 0; i < dir->child_count; i++)
+    {
+        file = &dir->children[i];
+        if(next_inode >= inode_count)
+        {
+            die("not enough inodes for the files", NULL);
+        }
+        file->inode = next_inode++;
+
+        if(!file->is_dir)
+        {
+            if(!compress || store_compressed(&inodes[file->inode], file->data, file->length) == -1)
+            {
+                store_data(&inodes[file->inode], file->data, file->length, 0);
+            }
+            continue;
+        }
+
+        build_dir(file, inodes, inode_count);
+        dentries = calloc(file->child_count ? file->child_count : 1, sizeof(dentry_t));
+        if(dentries == NULL)
+        {
+            die("out of memory", NULL);
+        }
+        for(file->length = 0; file->length < (uint32_t)file->child_count; file->length++)
+        {
+            fill_dentry(&dentries[file->length], &file->children[file->length]);
+        }
+        file->length *= sizeof(dentry_t);
+        store_data(&inodes[file->inode], (uint8_t*)dentries, file->length, 1);
+        free(dentries);
+    }
+}
+
+/* build
+ * 	Description: Fills the boot block and inodes. Entries get inodes from
+ *  1 up in name order, depth first, and their blocks are appended in
+ *  the same order, so a file without shared blocks is one contiguous run.
+ * 	Inputs: boot block, inodes, inode count
+ * 	Outputs: None
+ * 	Side Effects: Fills the data area.
+ */
+static void build(boot_block_t* boot, inode_t* inodes, int inode_count)
+{
+    int i;
+
+    /* "." and "rtc" come first, both on inode 0 */
+    boot->dir_count = root.child_count + 2;
+    boot->inode_count = inode_count;
+    strcpy((char*)boot->direntries[0].filename, ".");
+    boot->direntries[0].filetype = FILE_TYPE_DIRECTORY;
+    strcpy((char*)boot->direntries[1].filename, "rtc");
+    boot->direntries[1].filetype = FILE_TYPE_RTC;
+
+    next_inode = 1;
+    build_dir(&root, inodes, inode_count);
+    for(i = 0; i < root.child_count; i++)
+    {
+        fill_dentry(&boot->direntries[i + 2], &root.children[i]);
+    }
+
+    boot->data_count = block_count;
+}
+
+/* image_bmap
+ * 	Description: Finds the data block holding a block of a file in the
+ *  written image, for any inode layout, the way the kernel does.
+ * 	Inputs: image, boot block, node, idx (file block)
+ * 	Outputs: Return the block number, BAD_BLOCK if there is none
+ * 	Side Effects: None
+ */
+static uint32_t image_bmap(const uint8_t* image, const boot_block_t* boot, const inode_t* node, uint32_t idx)
+{
+    const inode_extent_t* extent = (const inode_extent_t*)node;
+    const inode_indirect_t* indirect = (const inode_indirect_t*)node;
+    uint32_t i, table;
+
+    if((uint32_t)node->data_block_num[0] == INODE_LAYOUT_EXTENT)
+    {
+        for(i = 0; i < extent->count && i < EXTENTS_PER_INODE; i++)
+        {
+            if(idx >= extent->extents[i].first && idx - extent->extents[i].first < extent->extents[i].count)
+            {
+                return extent->extents[i].start + (idx - extent->extents[i].first);
+            }
+        }
+        return BAD_BLOCK;
+    }
+    if((uint32_t)node->data_block_num[0] == INODE_LAYOUT_INDIRECT)
+    {
+        table = (idx / BLOCKS_PER_INDIRECT < INDIRECT_PER_INODE) ? indirect->blocks[idx / BLOCKS_PER_INDIRECT] : BAD_BLOCK;
+        if(table >= (uint32_t)boot->data_count)
+        {
+            return BAD_BLOCK;
+        }
+        return ((const uint32_t*)(image + (size_t)(1 + boot->inode_count + table) * BLOCK_SIZE))[idx % BLOCKS_PER_INDIRECT];
+    }
+    return (idx < DATA_BLOCK_NUM_SIZE) ? (uint32_t)node->data_block_num[idx] : BAD_BLOCK;
+}
+
+/* verify_compressed
+ * 	Description: Checks that a compressed inode's stream is in range and
+ *  that every block decodes to the expected bytes.
+ * 	Inputs: image, boot block, node, data, length, path (for messages)
+ * 	Outputs: Return 0 if the data matches, -1 otherwise
+ * 	Side Effects: Prints the problem found.
+ */
+static int verify_compressed(const uint8_t* image, const boot_block_t* boot, const inode_t* inode,
+                             const uint8_t* data, uint32_t length, const char* path)
+{
+    const inode_compressed_t* node = (const inode_compressed_t*)inode;
+    const uint8_t* stream;
+    uint8_t block[BLOCK_SIZE];
+    uint32_t j, n, tail, from, to;
+
+    n = (length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if(n > COMPRESSED_PER_INODE || node->start > (uint32_t)boot->data_count ||
+       (node->size + BLOCK_SIZE - 1) / BLOCK_SIZE > boot->data_count - node->start)
+    {
+        fprintf(stderr, "createfs: verify: bad stream for %s\n", path);
+        return -1;
+    }
+    stream = image + (size_t)(1 + boot->inode_count + node->start) * BLOCK_SIZE;
+
+    for(j = 0; j < n; j++)
+    {
+        tail = (j == n - 1) ? length - j * BLOCK_SIZE : BLOCK_SIZE;
+        from = node->offsets[j];
+        to = node->offsets[j + 1];
+        if(from > to || to > node->size ||
+           (to - from != tail && lz_decompress(stream + from, to - from, block, tail) != (int32_t)tail) ||
+           memcmp((to - from == tail) ? stream + from : block, data + (size_t)j * BLOCK_SIZE, tail))
+        {
+            fprintf(stderr, "createfs: verify: block %u of %s is wrong\n", j, path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* verify_data
+ * 	Description: Checks that an inode's blocks are in range and hold the
+ *  expected bytes.
+ * 	Inputs: image, boot block, inode number, data, length, path (for
+ *  messages)
+ * 	Outputs: Return 0 if the data matches, -1 otherwise
+ * 	Side Effects: Prints the problem found.
+ */
+static int verify_data(const uint8_t* image, const boot_block_t* boot, int32_t inode,
+                       const uint8_t* data, uint32_t length, const char* path)
+{
+    const inode_t* node = (const inode_t*)(image + BLOCK_SIZE) + inode;
+    uint32_t j, n, tail, block;
+
+    if((uint32_t)node->length != length)
+    {
+        fprintf(stderr, "createfs: verify: wrong length for %s\n", path);
+        return -1;
+    }
+    if((uint32_t)node->data_block_num[0] == INODE_LAYOUT_COMPRESSED)
+    {
+        return verify_compressed(image, boot, node, data, length, path);
+    }
+
+    n = (length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for(j = 0; j < n; j++)
+    {
+        block = image_bmap(image, boot, node, j);
+        tail = (j == n - 1) ? length - j * BLOCK_SIZE : BLOCK_SIZE;
+        if(block >= (uint32_t)boot->data_count ||
+           memcmp(image + (size_t)(1 + boot->inode_count + block) * BLOCK_SIZE,
+                  data + (size_t)j * BLOCK_SIZE, tail))
+        {
+            fprintf(stderr, "createfs: verify: block %u of %s is wrong\n", j, path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* verify_dir
+ * 	Description: Checks a directory's dentries against its sources, then
+ *  every file and subdirectory below it.
+ * 	Inputs: image, boot block, dentries, dir
+ * 	Outputs: Return 0 if the directory is good, -1 otherwise
+ * 	Side Effects: Prints each problem found.
+ */
+static int verify_dir(const uint8_t* image, const boot_block_t* boot, const dentry_t* dentries, const source_t* dir)
+{
+    const dentry_t* dentry;
+    const source_t* file;
+    const inode_t* node;
+    uint8_t* listing;
+    uint32_t j, block;
+    int i, bad = 0;
+
+    for(i = 0; i < dir->child_count; i++)
+    {
+        dentry = &dentries[i];
+        file = &dir->children[i];
+
+        /* Names are sorted and the dentry points at a valid inode */
+        if(strncmp((char*)dentry->filename, file->name, FILENAME_LEN) ||
+           (i > 0 && strncmp((char*)dentries[i - 1].filename, (char*)dentry->filename, FILENAME_LEN) >= 0) ||
+           dentry->filetype != (file->is_dir ? FILE_TYPE_DIRECTORY : FILE_TYPE_REGULAR) ||
+           dentry->inode_num <= 0 || dentry->inode_num >= boot->inode_count)
+        {
+            fprintf(stderr, "createfs: verify: bad dentry for %s\n", file->path);
+            bad = 1;
+            continue;
+        }
+
+        if(!file->is_dir)
+        {
+            bad |= verify_data(image, boot, dentry->inode_num, file->data, file->length, file->path);
+            continue;
+        }
+
+        /* A directory's blocks are read back into one listing first */
+        node = (const inode_t*)(image + BLOCK_SIZE) + dentry->inode_num;
+        if((uint32_t)node->length != file->child_count * sizeof(dentry_t))
+        {
+            fprintf(stderr, "createfs: verify: wrong length for %s\n", file->path);
+            bad = 1;
+            continue;
+        }
+        listing = calloc(1, node->length + BLOCK_SIZE);
+        if(listing == NULL)
+        {
+            die("out of memory", NULL);
+        }
+        for(j = 0; j * BLOCK_SIZE < (uint32_t)node->length; j++)
+        {
+            block = image_bmap(image, boot, node, j);
+            if(block >= (uint32_t)boot->data_count)
+            {
+                fprintf(stderr, "createfs: verify: block %u of %s is wrong\n", j, file->path);
+                bad = 1;
+                break;
+            }
+            memcpy(listing + (size_t)j * BLOCK_SIZE,
+                   image + (size_t)(1 + boot->inode_count + block) * BLOCK_SIZE, BLOCK_SIZE);
+        }
+        if(!bad)
+        {
+            bad |= verify_dir(image, boot, (const dentry_t*)listing, file);
+        }
+        free(listing);
+    }
+
+    return bad ? -1 : 0;
+}
+
+/* verify
+ * 	Description: Reads the written image back and checks it against the
+ *  layout the kernel expects and against every source file.
+ * 	Inputs: path of the image
+ * 	Outputs: Return 0 if the image is good, -1 otherwise
+ * 	Side Effects: Prints each problem found.
+ */
+static int verify(const char* path)
+{
+    FILE* in;
+    struct stat st;
+    uint8_t* image;
+    boot_block_t* boot;
+    dentry_t* dentry;
+    uint32_t i;
+    int bad = 0;
+
+    in = fopen(path, "rb");
+    if(in == NULL || stat(path, &st) == -1 || st.st_size < BLOCK_SIZE)
+    {
+        fprintf(stderr, "createfs: verify: cannot read %s\n", path);
+        return -1;
+    }
+    image = malloc(st.st_size);
+    if(image == NULL || fread(image, 1, st.st_size, in) != (size_t)st.st_size)
+    {
+        fprintf(stderr, "createfs: verify: cannot read %s\n", path);
+        return -1;
+    }
+    fclose(in);
+
+    boot = (boot_block_t*)image;
+
+    /* Header and total size */
+    if(boot->dir_count != root.child_count + 2 || boot->dir_count > DENTRY_SIZE - 1 ||
+       boot->inode_count <= 0 || boot->data_count < 0 ||
+       (off_t)(1 + boot->inode_count + boot->data_count) * BLOCK_SIZE != st.st_size)
+    {
+        fprintf(stderr, "createfs: verify: boot block counts do not match the image size\n");
+        free(image);
+        return -1;
+    }
+
+    for(i = 0; i < 2; i++)
+    {
+        dentry = &boot->direntries[i];
+        if(dentry->inode_num != 0 ||
+           dentry->filetype != (i == 0 ? FILE_TYPE_DIRECTORY : FILE_TYPE_RTC))
+        {
+            fprintf(stderr, "createfs: verify: bad special dentry %u\n", i);
+            bad = 1;
+        }
+    }
+    if(verify_dir(image, boot, &boot->direntries[2], &root) == -1)
+    {
+        bad = 1;
+    }
+
+    free(image);
+    return bad ? -1 : 0;
+}
+
+/* usage
+ * 	Description: Prints the command line and exits.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Exits with status 1.
+ */
+static void usage()
+{
+    fprintf(stderr, "usage: createfs -i <input dir> -o <output image> [-n <inodes>] [-z]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    const char* input = NULL;
+    const char* output = NULL;
+    int inode_count = DEFAULT_INODES;
+    int opt;
+    size_t header_size;
+    uint8_t* header;
+    FILE* out;
+
+    while((opt = getopt(argc, argv, "i:o:n:z")) != -1)
+    {
+        switch(opt)
+        {
+            case 'i': input = optarg; break;
+            case 'o': output = optarg; break;
+            case 'n': inode_count = atoi(optarg); break;
+            case 'z': compress = 1; break;
+            default: usage();
+        }
+    }
+    if(input == NULL || output == NULL || inode_count < 1 || inode_count > MAX_INODES)
+    {
+        usage();
+    }
+
+    snprintf(root.path, sizeof(root.path), "%s", input);
+    scan_dir(&root, 0);
+
+    /* Boot block and inodes, all zero until filled */
+    header_size = (size_t)(1 + inode_count) * BLOCK_SIZE;
+    header = calloc(1, header_size);
+    if(header == NULL)
+    {
+        die("out of memory", NULL);
+    }
+    build((boot_block_t*)header, (inode_t*)(header + BLOCK_SIZE), inode_count);
+
+    out = fopen(output, "wb");
+    if(out == NULL ||
+       fwrite(header, 1, header_size, out) != header_size ||
+       fwrite(blocks, BLOCK_SIZE, block_count, out) != block_count ||
+       fclose(out) != 0)
+    {
+        die("cannot write", output);
+    }
+
+    if(verify(output) == -1)
+    {
+        die("verification failed", output);
+    }
+
+    printf("%s: %d files, %d directories, %u data blocks (%u shared), %u block runs, "
+           "%u extent, %u indirect and %u compressed inodes (%u blocks saved), %zu bytes\n",
+           output, file_count, dir_count, block_count, blocks_shared, runs_total,
+           extent_inodes, indirect_inodes, compressed_inodes, blocks_saved, header_size + (size_t)block_count * BLOCK_SIZE);
+    return 0;
+}
@@ -0,0 +1,379 @@
+/*
+ * fsbench.c
+ * Runs the filesystem and lib.c hot paths as a Linux program, so they
+ * can be measured without booting QEMU.
+ *
+ *   fsbench [-t ms] [image]
+ *
+ * The image (student-distrib/filesys_img by default) is memory-mapped
+ * and handed to filesystem_init like the multiboot module would be.
+ * Each benchmark is repeated until it has run for at least the target
+ * time and reports ns/op, plus MB/s when it moves file data. Images
+ * built with createfs -z also show the decompressed-block cache at
+ * work: "make compare" runs the benchmarks on an image built each way.
+ *
+ * lib.c's memcpy and memset are 32-bit inline assembly, so every pointer
+ * the kernel code sees has to fit in 32 bits: the image and buffers are
+ * mapped with MAP_32BIT and the benchmarks run on a stack mapped the
+ * same way.
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "kfs.h"
+
+#define DEFAULT_IMAGE   "../student-distrib/filesys_img"
+#define DEFAULT_MS      200
+#define STACK_SIZE      (1 << 20)
+#define BUF_SIZE        (1 << 22)
+#define CHUNK_SIZE      1024
+#define COPY_SIZE       0x10000
+#define NS_PER_SEC      1000000000ULL
+#define NS_PER_MS       1000000ULL
+#define MAX_NAMES       63
+
+typedef void (*bench_fn)(uint32_t iters, void* arg);
+
+static uint64_t target_ns;
+static uint8_t* image;
+static off_t image_size;
+static uint8_t* buf;
+static uint8_t* copy_src;
+static volatile uint32_t sink;
+
+static kdentry_t names[MAX_NAMES];
+static char keys[MAX_NAMES][KFS_FILENAME_LEN + 1];
+static int name_count;
+
+static ucontext_t main_ctx, bench_ctx;
+
+/* now_ns
+ * 	Description: Reads the monotonic clock.
+ * 	Inputs: None
+ * 	Outputs: Nanoseconds
+ * 	Side Effects: None
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+/* map_low
+ * 	Description: Maps anonymous memory below 4 GB.
+ * 	Inputs: size
+ * 	Outputs: The mapping
+ * 	Side Effects: Exits if the mapping fails.
+ */
+static uint8_t* map_low(size_t size)
+{
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if(p == MAP_FAILED)
+    {
+        perror("fsbench: mmap");
+        exit(1);
+    }
+    return p;
+}
+
+/* measure
+ * 	Description: Doubles the iteration count until one batch runs for
+ *  the target time, then prints the time per operation.
+ * 	Inputs: label, fn, arg, bytes (moved per operation, 0 for none)
+ * 	Outputs: None
+ * 	Side Effects: Prints one line.
+ */
+static void measure(const char* label, bench_fn fn, void* arg, uint64_t bytes)
+{
+    uint32_t iters = 1;
+    uint64_t start, elapsed;
+
+    /* Warm up once so first-touch faults are not timed */
+    fn(1, arg);
+
+    for(;;)
+    {
+        start = now_ns();
+        fn(iters, arg);
+        elapsed = now_ns() - start;
+        if(elapsed >= target_ns || iters >= (1U << 30))
+        {
+            break;
+        }
+        iters *= 2;
+    }
+
+    printf("%-48s %10.1f ns/op", label, (double)elapsed / iters);
+    if(bytes)
+    {
+        printf(" %10.1f MB/s", (double)bytes * iters / ((double)elapsed / NS_PER_SEC) / 1e6);
+    }
+    printf("\n");
+}
+
+/* bench_lookup
+ * 	Description: Looks up every name in the directory in turn, using
+ *  terminated copies since a 32-byte name fills its dentry.
+ * 	Inputs: iters, arg (unused)
+ * 	Outputs: None
+ * 	Side Effects: None
+ */
+static void bench_lookup(uint32_t iters, void* arg)
+{
+    uint32_t i;
+    kdentry_t d;
+
+    for(i = 0; i < iters; i++)
+    {
+        sink += read_dentry_by_name((uint8_t*)keys[i % name_count], &d);
+    }
+}
+
+/* bench_lookup_miss
+ * 	Description: Looks up a name that is not in the directory.
+ * 	Inputs: iters, arg (unused)
+ * 	Outputs: None
+ * 	Side Effects: None
+ */
+static void bench_lookup_miss(uint32_t iters, void* arg)
+{
+    uint32_t i;
+    kdentry_t d;
+
+    for(i = 0; i < iters; i++)
+    {
+        sink += read_dentry_by_name((const uint8_t*)"nosuchfile", &d);
+    }
+}
+
+/* bench_read_file
+ * 	Description: Reads a whole file per operation.
+ * 	Inputs: iters, arg (dentry of the file)
+ * 	Outputs: None
+ * 	Side Effects: Fills buf.
+ */
+static void bench_read_file(uint32_t iters, void* arg)
+{
+    uint32_t i;
+    kdentry_t* d = arg;
+
+    for(i = 0; i < iters; i++)
+    {
+        sink += read_data(d->inode_num, 0, buf, BUF_SIZE);
+    }
+}
+
+/* bench_read_cold
+ * 	Description: Reads a whole file per operation with the decompressed
+ *  block cache emptied first, so compressed blocks are decoded every
+ *  time.
+ * 	Inputs: iters, arg (dentry of the file)
+ * 	Outputs: None
+ * 	Side Effects: Fills buf.
+ */
+static void bench_read_cold(uint32_t iters, void* arg)
+{
+    uint32_t i;
+    kdentry_t* d = arg;
+
+    for(i = 0; i < iters; i++)
+    {
+        zcache_reset();
+        sink += read_data(d->inode_num, 0, buf, BUF_SIZE);
+    }
+}
+
+/* bench_read_chunks
+ * 	Description: Reads a file front to back in CHUNK_SIZE calls, the way
+ *  cat does, wrapping around at the end. One operation is one call.
+ * 	Inputs: iters, arg (dentry of the file)
+ * 	Outputs: None
+ * 	Side Effects: Fills buf.
+ */
+static void bench_read_chunks(uint32_t iters, void* arg)
+{
+    uint32_t i, offset = 0;
+    int32_t cnt;
+    kdentry_t* d = arg;
+
+    for(i = 0; i < iters; i++)
+    {
+        cnt = read_data(d->inode_num, offset, buf, CHUNK_SIZE);
+        offset = (cnt == CHUNK_SIZE) ? offset + CHUNK_SIZE : 0;
+        sink += cnt;
+    }
+}
+
+/* bench_dir_read
+ * 	Description: Lists the directory one name per call like ls, wrapping
+ *  around at the end. One operation is one call.
+ * 	Inputs: iters, arg (unused)
+ * 	Outputs: None
+ * 	Side Effects: Fills buf.
+ */
+static void bench_dir_read(uint32_t iters, void* arg)
+{
+    uint32_t i, offset = 0;
+    int32_t cnt;
+
+    for(i = 0; i < iters; i++)
+    {
+        cnt = directory_read(0, offset, buf, KFS_FILENAME_LEN);
+        offset = (cnt == KFS_FILENAME_LEN) ? offset + KFS_FILENAME_LEN : 0;
+        sink += cnt;
+    }
+}
+
+/* bench_memcpy
+ * 	Description: Copies COPY_SIZE bytes with lib.c's memcpy.
+ * 	Inputs: iters, arg (unused)
+ * 	Outputs: None
+ * 	Side Effects: Fills buf.
+ */
+static void bench_memcpy(uint32_t iters, void* arg)
+{
+    uint32_t i;
+
+    for(i = 0; i < iters; i++)
+    {
+        kmemcpy(buf, copy_src, COPY_SIZE);
+        sink += buf[i % COPY_SIZE];
+    }
+}
+
+/* run_benchmarks
+ * 	Description: Collects the names in the image and runs every
+ *  benchmark. Runs on the low stack.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Prints the results.
+ */
+static void run_benchmarks(void)
+{
+    int i;
+    uint32_t length;
+    uint32_t largest = 0;
+    kdentry_t* big = NULL;
+    kboot_block_t* boot = (kboot_block_t*)image;
+    kzcache_stats_t warm;
+    char label[80];
+
+    filesystem_init(image);
+
+    for(i = 0; i < boot->dir_count && i < MAX_NAMES; i++)
+    {
+        read_dentry_by_index(i, &names[i]);
+        memcpy(keys[i], names[i].filename, KFS_FILENAME_LEN);
+        name_count++;
+    }
+    printf("%d dentries, %d inodes, %d data blocks, %lld bytes\n\n",
+           boot->dir_count, boot->inode_count, boot->data_count, (long long)image_size);
+
+    measure("read_dentry_by_name (hit, all names)", bench_lookup, NULL, 0);
+    measure("read_dentry_by_name (miss)", bench_lookup_miss, NULL, 0);
+    measure("directory_read (one name per call)", bench_dir_read, NULL, KFS_FILENAME_LEN);
+
+    /* Whole-file reads of every regular file */
+    for(i = 0; i < name_count; i++)
+    {
+        if(names[i].filetype != KFS_TYPE_REGULAR)
+        {
+            continue;
+        }
+        length = read_data(names[i].inode_num, 0, buf, BUF_SIZE);
+        if(length > largest)
+        {
+            largest = length;
+            big = &names[i];
+        }
+        snprintf(label, sizeof(label), "read_data whole %.32s", names[i].filename);
+        measure(label, bench_read_file, &names[i], length);
+    }
+
+    if(big != NULL)
+    {
+        snprintf(label, sizeof(label), "read_data %d B chunks %.32s", CHUNK_SIZE, big->filename);
+        measure(label, bench_read_chunks, big, CHUNK_SIZE);
+    }
+
+    /* The cold run empties the cache, counters included */
+    warm = zcache_stats;
+    if(big != NULL)
+    {
+        snprintf(label, sizeof(label), "read_data whole %.32s (cold cache)", big->filename);
+        measure(label, bench_read_cold, big, largest);
+    }
+
+    measure("lib memcpy 64 KB", bench_memcpy, NULL, COPY_SIZE);
+
+    printf("\nzcache before the cold run: %u hits, %u misses, %u evictions\n",
+           warm.hits, warm.misses, warm.evictions);
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = DEFAULT_IMAGE;
+    int opt, fd;
+    struct stat st;
+    uint8_t* stack;
+
+    target_ns = DEFAULT_MS * NS_PER_MS;
+    while((opt = getopt(argc, argv, "t:")) != -1)
+    {
+        if(opt != 't')
+        {
+            fprintf(stderr, "usage: fsbench [-t ms] [image]\n");
+            return 1;
+        }
+        target_ns = strtoull(optarg, NULL, 10) * NS_PER_MS;
+    }
+    if(optind < argc)
+    {
+        path = argv[optind];
+    }
+
+    /* Private mapping, so the kernel code may write without changing the file */
+    fd = open(path, O_RDONLY);
+    if(fd == -1 || fstat(fd, &st) == -1)
+    {
+        perror(path);
+        return 1;
+    }
+    image = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_32BIT, fd, 0);
+    if(image == MAP_FAILED)
+    {
+        perror("fsbench: mmap");
+        return 1;
+    }
+    close(fd);
+    image_size = st.st_size;
+
+    buf = map_low(BUF_SIZE);
+    copy_src = map_low(COPY_SIZE);
+    memset(copy_src, 0xA5, COPY_SIZE);
+    stack = map_low(STACK_SIZE);
+
+    printf("%s\n", path);
+
+    /* Switch to the low stack for everything that calls kernel code */
+    getcontext(&bench_ctx);
+    bench_ctx.uc_stack.ss_sp = stack;
+    bench_ctx.uc_stack.ss_size = STACK_SIZE;
+    bench_ctx.uc_link = &main_ctx;
+    makecontext(&bench_ctx, run_benchmarks, 0);
+    swapcontext(&main_ctx, &bench_ctx);
+
+    return 0;
+}
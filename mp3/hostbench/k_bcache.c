@@ -0,0 +1,3 @@
+/* bcache.c for the host, the data disk's buffer cache */
+#include "kshim.h"
+#include "bcache.c"
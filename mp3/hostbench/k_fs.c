@@ -0,0 +1,11 @@
+/* filesystem.c for the host, with the PCB pointer file_write uses and no
+ * running programs for write_data to refuse */
+#include "kshim.h"
+#include "filesystem.c"
+
+pcb_t* pcb_current;
+
+int32_t vfs_running(int32_t mount, uint32_t inode)
+{
+    return 0;
+}
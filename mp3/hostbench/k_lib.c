@@ -0,0 +1,7 @@
+/* lib.c for the host, with the scheduler state it refers to */
+#include "kshim.h"
+#include "lib.c"
+
+terminal_t term_arr[NUM_TERM];
+volatile uint8_t curr_terminal;
+volatile uint8_t curr_process;
@@ -0,0 +1,3 @@
+/* lz.c for the host, the decoder of compressed file blocks */
+#include "kshim.h"
+#include "lz.c"
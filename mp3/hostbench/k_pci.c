@@ -0,0 +1,3 @@
+/* pci.c for the host, linked in by filesystem.c but never called without a data disk */
+#include "kshim.h"
+#include "pci.c"
@@ -0,0 +1,3 @@
+/* zcache.c for the host, the cache of decompressed blocks */
+#include "kshim.h"
+#include "zcache.c"
@@ -0,0 +1,57 @@
+/*
+ * kfs.h
+ * The kernel entry points the benchmark calls, declared with host types.
+ * The kernel headers cannot be included next to libc's, since types.h
+ * redefines the stdint names.
+ */
+
+#ifndef _KFS_H
+#define _KFS_H
+
+#include <stdint.h>
+
+#define KFS_FILENAME_LEN 32
+#define KFS_BLOCK_SIZE 4096
+#define KFS_TYPE_REGULAR 2
+
+/* Same layout as dentry_t in filesystem.h */
+typedef struct kdentry
+{
+    char filename[KFS_FILENAME_LEN];
+    int32_t filetype;
+    int32_t inode_num;
+    char reserved[24];
+} kdentry_t;
+
+/* Same layout as the start of boot_block_t */
+typedef struct kboot_block
+{
+    int32_t dir_count;
+    int32_t inode_count;
+    int32_t data_count;
+} kboot_block_t;
+
+/* filesystem.c */
+extern void filesystem_init(void* boot_block);
+extern int32_t read_dentry_by_name(const uint8_t* fname, kdentry_t* dentry);
+extern int32_t read_dentry_by_index(uint32_t index, kdentry_t* dentry);
+extern int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+extern int32_t directory_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+
+/* Same layout as zcache_stats_t in zcache.h */
+typedef struct kzcache_stats
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+} kzcache_stats_t;
+
+/* zcache.c */
+extern kzcache_stats_t zcache_stats;
+extern void zcache_reset(void);
+
+/* lib.c, renamed by kshim.h */
+extern void* kmemcpy(void* dest, const void* src, uint32_t n);
+extern int32_t kstrncmp(const int8_t* s1, const int8_t* s2, uint32_t n);
+
+#endif /* _KFS_H */
@@ -0,0 +1,28 @@
+/*
+ * kshim.h
+ * Included in front of kernel sources built for the host. lib.c defines
+ * its own string and memory routines under libc names, so they are
+ * renamed here to keep the host libc out of the way; everything else
+ * comes from the kernel's own types.h and lib.h.
+ */
+
+#ifndef _KSHIM_H
+#define _KSHIM_H
+
+#define printf  kprintf
+#define putc    kputc
+#define puts    kputs
+#define itoa    kitoa
+#define strrev  kstrrev
+#define strlen  kstrlen
+#define memset  kmemset
+#define memcpy  kmemcpy
+#define memmove kmemmove
+#define strncmp kstrncmp
+#define strcpy  kstrcpy
+#define strncpy kstrncpy
+
+#include "types.h"
+#include "lib.h"
+
+#endif /* _KSHIM_H */
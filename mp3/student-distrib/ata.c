@@ -0,0 +1,336 @@
+#include "types.h"
+#include "lib.h"
+#include "i8259.h"
+#include "pci.h"
+#include "ata.h"
+
+/* Descriptor table for DMA, aligned so it never crosses a 64 KB boundary */
+static prd_t ata_prdt[ATA_MAX_PAGES] __attribute__((aligned(PRDT_ALIGN)));
+
+/* Disk size, bus master ports (0 without DMA) and the transfer mode */
+static uint32_t ata_sector_count;
+static uint32_t ata_bm_base;
+static int32_t ata_mode;
+
+/* Set by the IRQ 14 handler when a DMA transfer finishes */
+static volatile int32_t ata_irq_done;
+
+ata_stats_t ata_stats;
+
+/* ata_select
+ * 	Description: Selects the data disk with the top bits of an LBA and
+ *  waits the 400 ns the drive needs by reading the control port.
+ * 	Inputs: lba
+ * 	Outputs: None
+ * 	Side Effects: Writes the drive register.
+ */
+static void ata_select(uint32_t lba)
+{
+    int i;
+
+    outb(ATA_DRIVE_LBA | ATA_DRIVE | ((lba >> 24) & 0x0F), ATA_PRIMARY_IO + ATA_REG_DRIVE);
+    for(i = 0; i < ATA_SELECT_DELAY; i++)
+    {
+        inb(ATA_PRIMARY_CTRL);
+    }
+}
+
+/* ata_wait
+ * 	Description: Waits for the drive to finish a command, and for it to
+ *  have data ready when drq is set.
+ * 	Inputs: drq
+ * 	Outputs: Return 0, -1 on a drive error or a timeout
+ * 	Side Effects: None
+ */
+static int32_t ata_wait(int32_t drq)
+{
+    uint32_t i, status;
+
+    for(i = 0; i < ATA_TIMEOUT; i++)
+    {
+        status = inb(ATA_PRIMARY_IO + ATA_REG_STATUS);
+        if(status & ATA_SR_BSY)
+        {
+            continue;
+        }
+        if(status & (ATA_SR_ERR | ATA_SR_DF))
+        {
+            return -1;
+        }
+        if(!drq || (status & ATA_SR_DRQ))
+        {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/* ata_command
+ * 	Description: Loads the sector count and LBA into the task file and
+ *  issues a command.
+ * 	Inputs: lba, sectors (1 to 256), command
+ * 	Outputs: None
+ * 	Side Effects: Starts the command on the drive.
+ */
+static void ata_command(uint32_t lba, uint32_t sectors, uint32_t command)
+{
+    ata_select(lba);
+    outb(sectors & 0xFF, ATA_PRIMARY_IO + ATA_REG_COUNT);
+    outb(lba & 0xFF, ATA_PRIMARY_IO + ATA_REG_LBA0);
+    outb((lba >> 8) & 0xFF, ATA_PRIMARY_IO + ATA_REG_LBA1);
+    outb((lba >> 16) & 0xFF, ATA_PRIMARY_IO + ATA_REG_LBA2);
+    outb(command, ATA_PRIMARY_IO + ATA_REG_COMMAND);
+}
+
+/* ata_init
+ * 	Description: Identifies the data disk, then looks for the IDE
+ *  controller on the PCI bus and turns on bus mastering so transfers can
+ *  use DMA. A disk without a bus master still works in PIO mode.
+ * 	Inputs: None
+ * 	Outputs: Return 0, -1 if there is no usable data disk
+ * 	Side Effects: Enables IRQ 14.
+ */
+int32_t ata_init()
+{
+    int i;
+    int32_t device;
+    uint32_t status, bar;
+    uint16_t identify[ATA_IDENTIFY_WORDS];
+
+    ata_sector_count = 0;
+    ata_bm_base = 0;
+    ata_mode = ATA_MODE_PIO;
+
+    /* Interrupts on, then IDENTIFY; no drive answers 0 or a floating bus */
+    outb(0, ATA_PRIMARY_CTRL);
+    ata_command(0, 0, ATA_CMD_IDENTIFY);
+    status = inb(ATA_PRIMARY_IO + ATA_REG_STATUS);
+    if(status == 0 || status == ATA_SR_FLOATING)
+    {
+        return -1;
+    }
+
+    /* ATAPI devices set the signature in the LBA registers */
+    if(ata_wait(0) == -1 || inb(ATA_PRIMARY_IO + ATA_REG_LBA1) || inb(ATA_PRIMARY_IO + ATA_REG_LBA2) ||
+       ata_wait(1) == -1)
+    {
+        return -1;
+    }
+    insw(ATA_PRIMARY_IO + ATA_REG_DATA, identify, ATA_IDENTIFY_WORDS);
+
+    ata_sector_count = identify[ATA_IDENTIFY_LBA_LOW] | (identify[ATA_IDENTIFY_LBA_HIGH] << 16);
+    if(ata_sector_count > ATA_LBA28_LIMIT)
+    {
+        ata_sector_count = ATA_LBA28_LIMIT;
+    }
+
+    /* BAR4 of the IDE controller holds the bus master ports */
+    device = pci_find_class(PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE);
+    if(device != -1)
+    {
+        bar = pci_read(device, PCI_BAR4);
+        if(bar & PCI_BAR_IO)
+        {
+            pci_write(device, PCI_COMMAND, pci_read(device, PCI_COMMAND) | PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+            ata_bm_base = bar & PCI_BAR_IO_MASK;
+            ata_mode = ATA_MODE_DMA;
+        }
+    }
+
+    for(i = 0; i < ATA_MAX_PAGES; i++)
+    {
+        ata_prdt[i].bytes = ATA_PAGE_SIZE;
+    }
+    enable_irq(ATA_IRQ);
+    return 0;
+}
+
+/* ata_sectors
+ * 	Description: Gets the size of the data disk.
+ * 	Inputs: None
+ * 	Outputs: Return the number of sectors, 0 if there is no disk
+ * 	Side Effects: None
+ */
+uint32_t ata_sectors()
+{
+    return ata_sector_count;
+}
+
+/* ata_set_mode
+ * 	Description: Chooses PIO or DMA for the following transfers.
+ * 	Inputs: mode (ATA_MODE_PIO or ATA_MODE_DMA)
+ * 	Outputs: Return the previous mode, -1 if there is no disk or the
+ *  mode is not available
+ * 	Side Effects: None
+ */
+int32_t ata_set_mode(int32_t mode)
+{
+    int32_t old = ata_mode;
+
+    if(ata_sector_count == 0 || (mode != ATA_MODE_PIO && mode != ATA_MODE_DMA) ||
+       (mode == ATA_MODE_DMA && ata_bm_base == 0))
+    {
+        return -1;
+    }
+    ata_mode = mode;
+    return old;
+}
+
+/* ata_get_mode
+ * 	Description: Gets the current transfer mode.
+ * 	Inputs: None
+ * 	Outputs: Return ATA_MODE_PIO or ATA_MODE_DMA, -1 if there is no disk
+ * 	Side Effects: None
+ */
+int32_t ata_get_mode()
+{
+    return (ata_sector_count == 0) ? -1 : ata_mode;
+}
+
+/* ata_pio
+ * 	Description: Moves the sectors of a command through the data port,
+ *  waiting for the drive before each one.
+ * 	Inputs: lba, pages, count, write
+ * 	Outputs: Return 0, -1 on a drive error
+ * 	Side Effects: Reads or writes the disk.
+ */
+static int32_t ata_pio(uint32_t lba, uint8_t** pages, uint32_t count, int32_t write)
+{
+    uint32_t i, j;
+
+    ata_command(lba, count * ATA_SECTORS_PER_PAGE, write ? ATA_CMD_WRITE_PIO : ATA_CMD_READ_PIO);
+    for(i = 0; i < count; i++)
+    {
+        for(j = 0; j < ATA_SECTORS_PER_PAGE; j++)
+        {
+            if(ata_wait(1) == -1)
+            {
+                return -1;
+            }
+            if(write)
+            {
+                outsw(ATA_PRIMARY_IO + ATA_REG_DATA, pages[i] + j * ATA_SECTOR_SIZE, ATA_SECTOR_SIZE / 2);
+            }
+            else
+            {
+                insw(ATA_PRIMARY_IO + ATA_REG_DATA, pages[i] + j * ATA_SECTOR_SIZE, ATA_SECTOR_SIZE / 2);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* ata_dma
+ * 	Description: Moves the sectors of a command by bus master DMA. One
+ *  descriptor points at each page, which must be identity mapped
+ *  kernel memory. The transfer ends with IRQ 14; the bus master status
+ *  is polled as well, in case the caller runs with interrupts off.
+ * 	Inputs: lba, pages, count, write
+ * 	Outputs: Return 0, -1 on a drive error or a timeout
+ * 	Side Effects: Reads or writes the disk.
+ */
+static int32_t ata_dma(uint32_t lba, uint8_t** pages, uint32_t count, int32_t write)
+{
+    uint32_t i, status;
+    uint32_t direction = write ? 0 : BM_CMD_READ;
+
+    for(i = 0; i < count; i++)
+    {
+        ata_prdt[i].addr = (uint32_t)pages[i];
+        ata_prdt[i].flags = (i == count - 1) ? PRD_EOT : 0;
+    }
+
+    /* Stop the engine, load the table and clear the old status */
+    outb(direction, ata_bm_base + BM_COMMAND);
+    outl((uint32_t)ata_prdt, ata_bm_base + BM_PRDT);
+    outb(BM_STATUS_IRQ | BM_STATUS_ERROR, ata_bm_base + BM_STATUS);
+
+    ata_irq_done = 0;
+    ata_command(lba, count * ATA_SECTORS_PER_PAGE, write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA);
+    outb(direction | BM_CMD_START, ata_bm_base + BM_COMMAND);
+
+    for(i = 0; i < ATA_TIMEOUT; i++)
+    {
+        if(ata_irq_done || (inb(ata_bm_base + BM_STATUS) & BM_STATUS_IRQ))
+        {
+            break;
+        }
+    }
+
+    outb(direction, ata_bm_base + BM_COMMAND);
+    status = inb(ata_bm_base + BM_STATUS);
+    outb(BM_STATUS_IRQ | BM_STATUS_ERROR, ata_bm_base + BM_STATUS);
+    if(i == ATA_TIMEOUT || (status & BM_STATUS_ERROR))
+    {
+        return -1;
+    }
+    return ata_wait(0);
+}
+
+/* ata_rw
+ * 	Description: Reads or writes consecutive 4 KB pages of the data disk,
+ *  as one command of up to ATA_MAX_PAGES pages in the current mode.
+ *  Writes are flushed from the drive's cache before returning.
+ * 	Inputs: lba (first sector), pages, count (number of pages), write
+ * 	Outputs: Return 0, -1 on a bad range or a drive error
+ * 	Side Effects: Reads or writes the disk.
+ */
+int32_t ata_rw(uint32_t lba, uint8_t** pages, uint32_t count, int32_t write)
+{
+    int32_t result;
+
+    if(count == 0 || count > ATA_MAX_PAGES || lba >= ata_sector_count ||
+       count * ATA_SECTORS_PER_PAGE > ata_sector_count - lba)
+    {
+        return -1;
+    }
+
+    if(ata_mode == ATA_MODE_DMA)
+    {
+        result = ata_dma(lba, pages, count, write);
+    }
+    else
+    {
+        result = ata_pio(lba, pages, count, write);
+    }
+
+    if(result == 0 && write)
+    {
+        outb(ATA_CMD_CACHE_FLUSH, ATA_PRIMARY_IO + ATA_REG_COMMAND);
+        result = ata_wait(0);
+    }
+
+    if(result == -1)
+    {
+        ata_stats.errors++;
+    }
+    else if(write)
+    {
+        ata_stats.writes++;
+        ata_stats.pages_written += count;
+    }
+    else
+    {
+        ata_stats.reads++;
+        ata_stats.pages_read += count;
+    }
+    return result;
+}
+
+/* ata_interrupt_handler
+ * 	Description: Handles IRQ 14. Reading the status register
+ *  acknowledges the drive, and the flag tells ata_dma the transfer is
+ *  done.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Sets ata_irq_done and sends EOI.
+ */
+void ata_interrupt_handler()
+{
+    ata_stats.irqs++;
+    inb(ATA_PRIMARY_IO + ATA_REG_STATUS);
+    ata_irq_done = 1;
+    send_eoi(ATA_IRQ);
+}
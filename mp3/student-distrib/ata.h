@@ -0,0 +1,117 @@
+/*
+ * ata.h
+ * Driver for the data disk on the primary IDE channel. Transfers move
+ * whole 4 KB pages, with PIO through the data port or with PCI bus
+ * master DMA straight into the pages, finished by IRQ 14.
+ *
+ * QEMU's -hda is the boot disk, so the data disk is the slave on the
+ * same channel (-hdb). A filesystem image written to it as it is, e.g.
+ * "-hdb filesys_img", can be mounted by filesystem.c.
+ */
+
+#ifndef _ATA_H
+#define _ATA_H
+
+#include "types.h"
+
+/* Magic numbers */
+#define ATA_PRIMARY_IO          0x1F0
+#define ATA_PRIMARY_CTRL        0x3F6
+#define ATA_IRQ                 14
+#define ATA_SECTOR_SIZE         512
+#define ATA_PAGE_SIZE           4096
+#define ATA_SECTORS_PER_PAGE    (ATA_PAGE_SIZE / ATA_SECTOR_SIZE)
+#define ATA_MAX_PAGES           32
+#define ATA_LBA28_LIMIT         0x10000000
+#define ATA_IDENTIFY_WORDS      256
+#define ATA_IDENTIFY_LBA_LOW    60
+#define ATA_IDENTIFY_LBA_HIGH   61
+#define ATA_TIMEOUT             10000000
+#define ATA_SELECT_DELAY        4
+
+/* Task file registers, as offsets from ATA_PRIMARY_IO */
+#define ATA_REG_DATA            0
+#define ATA_REG_ERROR           1
+#define ATA_REG_COUNT           2
+#define ATA_REG_LBA0            3
+#define ATA_REG_LBA1            4
+#define ATA_REG_LBA2            5
+#define ATA_REG_DRIVE           6
+#define ATA_REG_STATUS          7
+#define ATA_REG_COMMAND         7
+
+/* Status bits */
+#define ATA_SR_BSY              0x80
+#define ATA_SR_DF               0x20
+#define ATA_SR_DRQ              0x08
+#define ATA_SR_ERR              0x01
+#define ATA_SR_FLOATING         0xFF
+
+/* Drive register: LBA addressing, and the slave bit for the data disk */
+#define ATA_DRIVE_LBA           0xE0
+#define ATA_DRIVE_SLAVE         0x10
+#define ATA_DRIVE               ATA_DRIVE_SLAVE
+
+/* Commands */
+#define ATA_CMD_READ_PIO        0x20
+#define ATA_CMD_WRITE_PIO       0x30
+#define ATA_CMD_READ_DMA        0xC8
+#define ATA_CMD_WRITE_DMA       0xCA
+#define ATA_CMD_CACHE_FLUSH     0xE7
+#define ATA_CMD_IDENTIFY        0xEC
+
+/* Bus master registers, as offsets from BAR4, and their bits */
+#define BM_COMMAND              0
+#define BM_STATUS               2
+#define BM_PRDT                 4
+#define BM_CMD_START            0x01
+#define BM_CMD_READ             0x08
+#define BM_STATUS_ERROR         0x02
+#define BM_STATUS_IRQ           0x04
+#define PRD_EOT                 0x8000
+#define PRDT_ALIGN              256
+
+/* Transfer modes */
+#define ATA_MODE_PIO            0
+#define ATA_MODE_DMA            1
+
+/* Physical region descriptor, one per page of a DMA transfer */
+typedef struct prd
+{
+    uint32_t addr;
+    uint16_t bytes;
+    uint16_t flags;
+} prd_t;
+
+/* Transfer counters */
+typedef struct ata_stats
+{
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t pages_read;
+    uint32_t pages_written;
+    uint32_t irqs;
+    uint32_t errors;
+} ata_stats_t;
+
+extern ata_stats_t ata_stats;
+
+/* Find the data disk and the bus master, 0 if the disk is there */
+int32_t ata_init();
+
+/* Number of sectors on the data disk, 0 if there is none */
+uint32_t ata_sectors();
+
+/* Switch between PIO and DMA, returning the old mode or -1 */
+int32_t ata_set_mode(int32_t mode);
+
+/* Current transfer mode */
+int32_t ata_get_mode();
+
+/* Read or write consecutive pages starting at a sector */
+int32_t ata_rw(uint32_t lba, uint8_t** pages, uint32_t count, int32_t write);
+
+/* IRQ 14 handler */
+void ata_interrupt_handler();
+
+#endif /* _ATA_H */
@@ -0,0 +1,266 @@
+#include "types.h"
+#include "lib.h"
+#include "ata.h"
+#include "bcache.h"
+
+/* Cached blocks, their data and the LRU clock */
+static bcache_entry_t bcache[BCACHE_ENTRIES];
+static uint8_t bcache_data[BCACHE_ENTRIES][BCACHE_BLOCK_SIZE] __attribute__((aligned(BCACHE_BLOCK_SIZE)));
+static uint32_t bcache_clock = 0;
+
+/* Size of the disk in blocks */
+static uint32_t bcache_blocks;
+
+bcache_stats_t bcache_stats;
+
+/* bcache_init
+ * 	Description: Marks every entry empty and sets the disk size.
+ * 	Inputs: blocks (number of blocks on the disk)
+ * 	Outputs: None
+ * 	Side Effects: Clears the cache and bcache_stats.
+ */
+void bcache_init(uint32_t blocks)
+{
+    int i;
+    for(i = 0; i < BCACHE_ENTRIES; i++)
+    {
+        bcache[i].block = BCACHE_EMPTY;
+        bcache[i].last_used = 0;
+        bcache[i].dirty = 0;
+    }
+    bcache_blocks = blocks;
+    bcache_clock = 0;
+    memset(&bcache_stats, 0, sizeof(bcache_stats));
+}
+
+/* bcache_find
+ * 	Description: Finds the entry holding a block.
+ * 	Inputs: block
+ * 	Outputs: Return the entry index, -1 if the block is not cached
+ * 	Side Effects: None
+ */
+static int32_t bcache_find(uint32_t block)
+{
+    int i;
+    for(i = 0; i < BCACHE_ENTRIES; i++)
+    {
+        if(bcache[i].block == (int32_t)block)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* bcache_flush
+ * 	Description: Writes a dirty entry back to the disk.
+ * 	Inputs: entry index
+ * 	Outputs: Return 0, -1 on a disk error
+ * 	Side Effects: Clears the dirty flag on success.
+ */
+static int32_t bcache_flush(int32_t i)
+{
+    uint8_t* page = bcache_data[i];
+
+    if(bcache[i].block == BCACHE_EMPTY || !bcache[i].dirty)
+    {
+        return 0;
+    }
+    if(ata_rw(bcache[i].block * (BCACHE_BLOCK_SIZE / ATA_SECTOR_SIZE), &page, 1, 1) == -1)
+    {
+        return -1;
+    }
+    bcache[i].dirty = 0;
+    bcache_stats.writebacks++;
+    return 0;
+}
+
+/* bcache_claim
+ * 	Description: Takes an empty entry, or the least recently used one
+ *  after writing it back, and gives it to a block. Entries claimed
+ *  earlier in the same request carry the current stamp, so they are
+ *  never chosen again.
+ * 	Inputs: block
+ * 	Outputs: Return the entry index, -1 if the write-back failed
+ * 	Side Effects: May write back and evict another block.
+ */
+static int32_t bcache_claim(uint32_t block)
+{
+    int i;
+    int32_t victim = 0;
+
+    for(i = 0; i < BCACHE_ENTRIES; i++)
+    {
+        if(bcache[i].block == BCACHE_EMPTY)
+        {
+            victim = i;
+            break;
+        }
+        if(bcache[i].last_used < bcache[victim].last_used)
+        {
+            victim = i;
+        }
+    }
+
+    if(bcache_flush(victim) == -1)
+    {
+        return -1;
+    }
+    bcache[victim].block = block;
+    bcache[victim].last_used = bcache_clock;
+    bcache[victim].dirty = 0;
+    return victim;
+}
+
+/* bcache_read
+ * 	Description: Gets a block's data. On a miss the block is read
+ *  together with the blocks after it that are not cached, up to
+ *  BCACHE_READAHEAD, in one disk command. The pointer stays valid until
+ *  the block is evicted, which takes BCACHE_ENTRIES - BCACHE_READAHEAD
+ *  other blocks at the least.
+ * 	Inputs: block
+ * 	Outputs: Return the data, NULL past the end of the disk or on a
+ *  disk error
+ * 	Side Effects: May evict blocks.
+ */
+uint8_t* bcache_read(uint32_t block)
+{
+    int32_t i, entry;
+    uint32_t count;
+    int32_t entries[BCACHE_READAHEAD];
+    uint8_t* pages[BCACHE_READAHEAD];
+
+    if(block >= bcache_blocks)
+    {
+        return NULL;
+    }
+
+    bcache_clock++;
+    entry = bcache_find(block);
+    if(entry != -1)
+    {
+        bcache[entry].last_used = bcache_clock;
+        bcache_stats.hits++;
+        return bcache_data[entry];
+    }
+    bcache_stats.misses++;
+
+    /* Run of uncached blocks starting at the one asked for */
+    for(count = 0; count < BCACHE_READAHEAD && block + count < bcache_blocks; count++)
+    {
+        if(count > 0 && bcache_find(block + count) != -1)
+        {
+            break;
+        }
+        entries[count] = bcache_claim(block + count);
+        if(entries[count] == -1)
+        {
+            break;
+        }
+        pages[count] = bcache_data[entries[count]];
+    }
+
+    if(count == 0 || ata_rw(block * (BCACHE_BLOCK_SIZE / ATA_SECTOR_SIZE), pages, count, 0) == -1)
+    {
+        for(i = 0; i < count; i++)
+        {
+            bcache[entries[i]].block = BCACHE_EMPTY;
+        }
+        return NULL;
+    }
+
+    bcache_stats.readahead += count - 1;
+    return pages[0];
+}
+
+/* bcache_write
+ * 	Description: Gets a buffer for a block the caller is about to
+ *  overwrite in full, without reading the old contents on a miss.
+ * 	Inputs: block
+ * 	Outputs: Return the data, NULL past the end of the disk or if a
+ *  write-back failed
+ * 	Side Effects: Marks the block dirty. May evict a block.
+ */
+uint8_t* bcache_write(uint32_t block)
+{
+    int32_t entry;
+
+    if(block >= bcache_blocks)
+    {
+        return NULL;
+    }
+
+    bcache_clock++;
+    entry = bcache_find(block);
+    if(entry == -1)
+    {
+        entry = bcache_claim(block);
+        if(entry == -1)
+        {
+            return NULL;
+        }
+    }
+    bcache[entry].last_used = bcache_clock;
+    bcache[entry].dirty = 1;
+    return bcache_data[entry];
+}
+
+/* bcache_dirty
+ * 	Description: Marks a cached block as changed, so it is written back
+ *  before it leaves the cache.
+ * 	Inputs: block
+ * 	Outputs: None
+ * 	Side Effects: Sets the dirty flag.
+ */
+void bcache_dirty(uint32_t block)
+{
+    int32_t entry = bcache_find(block);
+
+    if(entry != -1)
+    {
+        bcache[entry].dirty = 1;
+    }
+}
+
+/* bcache_sync
+ * 	Description: Writes every dirty block back to the disk.
+ * 	Inputs: None
+ * 	Outputs: Return 0, -1 if any write failed
+ * 	Side Effects: Writes the disk.
+ */
+int32_t bcache_sync()
+{
+    int i;
+    int32_t result = 0;
+
+    for(i = 0; i < BCACHE_ENTRIES; i++)
+    {
+        if(bcache_flush(i) == -1)
+        {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+/* bcache_drop
+ * 	Description: Writes back the dirty blocks and empties the cache, so
+ *  following reads go to the disk.
+ * 	Inputs: None
+ * 	Outputs: Return 0, -1 if a write failed; the cache is kept then
+ * 	Side Effects: Writes the disk.
+ */
+int32_t bcache_drop()
+{
+    int i;
+
+    if(bcache_sync() == -1)
+    {
+        return -1;
+    }
+    for(i = 0; i < BCACHE_ENTRIES; i++)
+    {
+        bcache[i].block = BCACHE_EMPTY;
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * bcache.h
+ * Buffer cache between the filesystem and the data disk. Blocks are
+ * 4 KB, kept in LRU order and written back when evicted or synced. A
+ * miss reads the following uncached blocks in the same disk command,
+ * so sequential reads move up to BCACHE_READAHEAD blocks per command.
+ */
+
+#ifndef _BCACHE_H
+#define _BCACHE_H
+
+#include "types.h"
+
+/* Magic numbers */
+#define BCACHE_ENTRIES      64
+#define BCACHE_BLOCK_SIZE   4096
+#define BCACHE_READAHEAD    16
+#define BCACHE_EMPTY        -1
+
+/* One cached block, its data is in a separate page-aligned array */
+typedef struct bcache_entry
+{
+    int32_t block;
+    uint32_t last_used;
+    int32_t dirty;
+} bcache_entry_t;
+
+/* Lookup and disk traffic counters */
+typedef struct bcache_stats
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t readahead;
+    uint32_t writebacks;
+} bcache_stats_t;
+
+extern bcache_stats_t bcache_stats;
+
+/* Empty the cache for a disk of a number of blocks */
+void bcache_init(uint32_t blocks);
+
+/* Get a block's data, reading it on a miss, NULL on a disk error */
+uint8_t* bcache_read(uint32_t block);
+
+/* Get a dirty buffer for a block the caller overwrites in full */
+uint8_t* bcache_write(uint32_t block);
+
+/* Mark a cached block as changed */
+void bcache_dirty(uint32_t block);
+
+/* Write every changed block back to the disk */
+int32_t bcache_sync();
+
+/* Write back, then empty the cache */
+int32_t bcache_drop();
+
+#endif /* _BCACHE_H */
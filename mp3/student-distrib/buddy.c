@@ -0,0 +1,194 @@
+#include "types.h"
+#include "lib.h"
+#include "buddy.h"
+
+buddy_stats_t buddy_stats;
+
+/* Head page of the free list of each order */
+static uint16_t buddy_head[BUDDY_ORDERS];
+
+/* Free list links of the head page of every free block */
+static uint16_t buddy_next[BUDDY_PAGES];
+static uint16_t buddy_prev[BUDDY_PAGES];
+
+/* Order of the free block a page heads, BUDDY_USED for every other page */
+static uint8_t buddy_order[BUDDY_PAGES];
+
+/* buddy_push
+ * 	Description: Puts a block at the head of the free list of its order.
+ * 	Inputs: page (index of the head page), order
+ * 	Outputs: None
+ * 	Side Effects: Counts the block as free.
+ */
+static void buddy_push(uint32_t page, uint32_t order)
+{
+    buddy_next[page] = buddy_head[order];
+    buddy_prev[page] = BUDDY_NIL;
+    if(buddy_head[order] != BUDDY_NIL)
+    {
+        buddy_prev[buddy_head[order]] = page;
+    }
+    buddy_head[order] = page;
+    buddy_order[page] = order;
+
+    buddy_stats.free_blocks[order]++;
+    buddy_stats.free_pages += 1 << order;
+}
+
+/* buddy_unlink
+ * 	Description: Takes a free block off the list of its order.
+ * 	Inputs: page (index of the head page), order
+ * 	Outputs: None
+ * 	Side Effects: Counts the block as used.
+ */
+static void buddy_unlink(uint32_t page, uint32_t order)
+{
+    if(buddy_prev[page] != BUDDY_NIL)
+    {
+        buddy_next[buddy_prev[page]] = buddy_next[page];
+    }
+    else
+    {
+        buddy_head[order] = buddy_next[page];
+    }
+    if(buddy_next[page] != BUDDY_NIL)
+    {
+        buddy_prev[buddy_next[page]] = buddy_prev[page];
+    }
+    buddy_order[page] = BUDDY_USED;
+
+    buddy_stats.free_blocks[order]--;
+    buddy_stats.free_pages -= 1 << order;
+}
+
+/* buddy_release
+ * 	Description: Frees a block, merging it with its buddy for as long
+ *  as the buddy is a free block of the same order.
+ * 	Inputs: page (index of the head page), order
+ * 	Outputs: None
+ * 	Side Effects: Changes the free lists.
+ */
+static void buddy_release(uint32_t page, uint32_t order)
+{
+    uint32_t buddy;
+
+    while(order < BUDDY_MAX_ORDER)
+    {
+        buddy = page ^ (1 << order);
+        if(buddy >= BUDDY_PAGES || buddy_order[buddy] != order)
+        {
+            break;
+        }
+        buddy_unlink(buddy, order);
+        page &= ~(1 << order);
+        order++;
+    }
+    buddy_push(page, order);
+}
+
+/* buddy_init
+ * 	Description: Empties every free list and marks every page used, so
+ *  only memory given with buddy_add_range is ever handed out.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Clears the counters.
+ */
+void buddy_init(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < BUDDY_ORDERS; i++)
+    {
+        buddy_head[i] = BUDDY_NIL;
+    }
+    memset(buddy_order, BUDDY_USED, sizeof(buddy_order));
+    memset(&buddy_stats, 0, sizeof(buddy_stats));
+}
+
+/* buddy_add_range
+ * 	Description: Adds the whole pages of a range of usable memory that
+ *  lie between BUDDY_BASE and BUDDY_LIMIT, each as the largest aligned
+ *  block that fits. Ranges must not overlap.
+ * 	Inputs: start, end (physical, end excluded)
+ * 	Outputs: None
+ * 	Side Effects: Grows the free lists.
+ */
+void buddy_add_range(uint32_t start, uint32_t end)
+{
+    uint32_t page, last, order;
+
+    start = (start < BUDDY_BASE) ? BUDDY_BASE : start;
+    end = (end > BUDDY_LIMIT) ? BUDDY_LIMIT : end;
+    if(end <= start)
+    {
+        return;
+    }
+
+    page = (start - BUDDY_BASE + BUDDY_PAGE_SIZE - 1) >> BUDDY_PAGE_SHIFT;
+    last = (end - BUDDY_BASE) >> BUDDY_PAGE_SHIFT;
+
+    while(page < last)
+    {
+        order = BUDDY_MAX_ORDER;
+        while(order > 0 && ((page & ((1 << order) - 1)) || page + (1 << order) > last))
+        {
+            order--;
+        }
+        buddy_stats.total_pages += 1 << order;
+        buddy_release(page, order);
+        page += 1 << order;
+    }
+}
+
+/* buddy_alloc
+ * 	Description: Takes the first block of the smallest order that is
+ *  large enough, splitting it down and freeing the upper halves.
+ * 	Inputs: order (0 for one page, BUDDY_MAX_ORDER for 4 MB)
+ * 	Outputs: Return the physical address of the block, 0 if none is left
+ * 	Side Effects: The memory is not cleared.
+ */
+uint32_t buddy_alloc(uint32_t order)
+{
+    uint32_t page, found;
+
+    if(order > BUDDY_MAX_ORDER)
+    {
+        buddy_stats.failures++;
+        return 0;
+    }
+
+    for(found = order; found <= BUDDY_MAX_ORDER && buddy_head[found] == BUDDY_NIL; found++);
+    if(found > BUDDY_MAX_ORDER)
+    {
+        buddy_stats.failures++;
+        return 0;
+    }
+
+    page = buddy_head[found];
+    buddy_unlink(page, found);
+    while(found > order)
+    {
+        found--;
+        buddy_push(page + (1 << found), found);
+    }
+
+    buddy_stats.allocs++;
+    return BUDDY_BASE + (page << BUDDY_PAGE_SHIFT);
+}
+
+/* buddy_free
+ * 	Description: Gives a block back.
+ * 	Inputs: addr (as returned by buddy_alloc), order (as passed to it)
+ * 	Outputs: None
+ * 	Side Effects: None for an address outside the allocator.
+ */
+void buddy_free(uint32_t addr, uint32_t order)
+{
+    if(addr < BUDDY_BASE || addr >= BUDDY_LIMIT || order > BUDDY_MAX_ORDER)
+    {
+        return;
+    }
+
+    buddy_stats.frees++;
+    buddy_release((addr - BUDDY_BASE) >> BUDDY_PAGE_SHIFT, order);
+}
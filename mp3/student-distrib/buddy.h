@@ -0,0 +1,55 @@
+/*
+ * buddy.h
+ * Physical page-frame allocator. The memory between the kernel page and
+ * the user window is handed out in blocks of 2^order 4 KB pages, from a
+ * single page up to a whole 4 MB frame. Each order keeps a free list; a
+ * block that is split leaves its upper half on the list below, and a
+ * freed block merges with its buddy whenever the buddy is free as well.
+ *
+ * The lists are linked through arrays indexed by page number rather
+ * than through the free pages themselves, so memory can be added before
+ * paging is on and a free frame is never touched.
+ */
+
+#ifndef _BUDDY_H
+#define _BUDDY_H
+
+#include "types.h"
+
+/* Magic numbers */
+#define BUDDY_PAGE_SIZE     4096
+#define BUDDY_PAGE_SHIFT    12
+#define BUDDY_MAX_ORDER     10          /* 2^10 pages, one 4 MB frame */
+#define BUDDY_ORDERS        (BUDDY_MAX_ORDER + 1)
+#define BUDDY_BASE          0x800000    /* first byte above the kernel page */
+#define BUDDY_LIMIT         0x8000000   /* the user window starts here */
+#define BUDDY_PAGES         ((BUDDY_LIMIT - BUDDY_BASE) >> BUDDY_PAGE_SHIFT)
+#define BUDDY_NIL           0xFFFF      /* end of a free list */
+#define BUDDY_USED          0xFF        /* page is not the head of a free block */
+
+/* Allocator counters, for /proc/mem */
+typedef struct buddy_stats
+{
+    uint32_t total_pages;
+    uint32_t free_pages;
+    uint32_t free_blocks[BUDDY_ORDERS];
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+} buddy_stats_t;
+
+extern buddy_stats_t buddy_stats;
+
+/* Forget every frame */
+void buddy_init(void);
+
+/* Give the allocator the usable memory in [start, end), clipped to its range */
+void buddy_add_range(uint32_t start, uint32_t end);
+
+/* Take a block of 2^order pages, return its physical address, 0 if none is left */
+uint32_t buddy_alloc(uint32_t order);
+
+/* Give back a block taken with the same order */
+void buddy_free(uint32_t addr, uint32_t order);
+
+#endif /* _BUDDY_H */
@@ -0,0 +1,171 @@
+#include "types.h"
+#include "lib.h"
+#include "filesystem.h"
+#include "rtc.h"
+#include "terminal.h"
+#include "memdev.h"
+#include "devfs.h"
+
+/* Driver operations */
+file_operations_table_pointer_t rtc_operations_table = {&rtc_read, &rtc_write, &rtc_open, &rtc_close, &rtc_stat, NULL};
+file_operations_table_pointer_t terminal_operations_table = {&terminal_read, &terminal_write, &terminal_open, &terminal_close, &terminal_stat, NULL};
+static file_operations_table_pointer_t null_operations_table = {&null_read, &null_write, &memdev_open, &memdev_close, &memdev_stat, NULL};
+static file_operations_table_pointer_t zero_operations_table = {&zero_read, &null_write, &memdev_open, &memdev_close, &memdev_stat, NULL};
+static file_operations_table_pointer_t random_operations_table = {&random_read, &null_write, &random_open, &memdev_close, &memdev_stat, NULL};
+
+/* Operations of the device directory */
+static file_operations_table_pointer_t devfs_dir_operations_table = {&devfs_dir_read, &devfs_dir_write, &devfs_dir_open, &devfs_dir_close, &devfs_dir_stat, &devfs_dir_getdents};
+
+/* The devices, in listing order */
+static devfs_node_t devfs_nodes[] =
+{
+    {"rtc", STAT_TYPE_RTC, &rtc_operations_table},
+    {"stdin", STAT_TYPE_TERMINAL, &terminal_operations_table},
+    {"stdout", STAT_TYPE_TERMINAL, &terminal_operations_table},
+    {"null", STAT_TYPE_CHARDEV, &null_operations_table},
+    {"zero", STAT_TYPE_CHARDEV, &zero_operations_table},
+    {"random", STAT_TYPE_CHARDEV, &random_operations_table},
+};
+
+#define DEVFS_COUNT (sizeof(devfs_nodes) / sizeof(devfs_node_t))
+
+/* Devices never go away */
+static uint32_t devfs_generation = 0;
+
+vfs_backend_t devfs_backend = {&devfs_lookup, NULL, &devfs_generation};
+
+/* devfs_lookup
+ * 	Description: Finds a device by its name.
+ * 	Inputs: path (relative to /dev), node
+ * 	Outputs: Return 0, -1 if there is no such device
+ * 	Side Effects: Fills node, except for the mount.
+ */
+int32_t devfs_lookup(const uint8_t* path, vnode_t* node)
+{
+    uint32_t i;
+
+    if(*path == '\0')
+    {
+        node->inode = VFS_ROOT_INODE;
+        node->type = STAT_TYPE_DIRECTORY;
+        node->ops = &devfs_dir_operations_table;
+        return 0;
+    }
+
+    for(i = 0; i < DEVFS_COUNT; i++)
+    {
+        if(strncmp((int8_t *)path, devfs_nodes[i].name, DEVFS_NAME_LEN) == 0)
+        {
+            node->inode = i + 1;
+            node->type = devfs_nodes[i].type;
+            node->ops = devfs_nodes[i].ops;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* devfs_dir_read
+ * 	Description: Reads the device names, one per FILENAME_LEN bytes,
+ *  like directory_read.
+ * 	Inputs: inode, offset, buf, length
+ * 	Outputs: Return number of bytes read
+ * 	Side Effects: Fills buf
+ */
+int32_t devfs_dir_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+{
+    uint32_t done = 0;
+    uint32_t span, data;
+    uint8_t name[DEVFS_NAME_LEN];
+
+    while(done < length && offset / FILENAME_LEN < DEVFS_COUNT)
+    {
+        memset(name, 0, DEVFS_NAME_LEN);
+        strncpy((int8_t *)name, devfs_nodes[offset / FILENAME_LEN].name, DEVFS_NAME_LEN);
+        data = offset % FILENAME_LEN;
+        span = FILENAME_LEN - data;
+        if(span > length - done)
+        {
+            span = length - done;
+        }
+        memcpy(buf + done, name + data, span);
+        done += span;
+        offset += span;
+    }
+
+    return done;
+}
+
+/* devfs_dir_write
+ * 	Description: Devices are fixed, so nothing can be created here.
+ * 	Inputs: fd, buf, nbytes
+ * 	Outputs: Return -1
+ * 	Side Effects: None
+ */
+int32_t devfs_dir_write(int32_t fd, const void* buf, int32_t nbytes)
+{
+    return -1;
+}
+
+/* devfs_dir_open
+ * 	Description: Opens the directory. It keeps no per-open state, so it
+ *  does nothing.
+ * 	Inputs: filename
+ * 	Outputs: Return 0
+ * 	Side Effects: None
+ */
+int32_t devfs_dir_open(const uint8_t* filename)
+{
+    return 0;
+}
+
+/* devfs_dir_close
+ * 	Description: Closes the directory. It keeps no per-open state, so
+ *  it does nothing.
+ * 	Inputs: fd
+ * 	Outputs: Return 0
+ * 	Side Effects: None
+ */
+int32_t devfs_dir_close(int32_t fd)
+{
+    return 0;
+}
+
+/* devfs_dir_stat
+ * 	Description: Reports the directory type and the size of its name
+ *  listing.
+ * 	Inputs: inode, buf
+ * 	Outputs: Return 0
+ * 	Side Effects: Fills buf
+ */
+int32_t devfs_dir_stat(uint32_t inode, stat_t* buf)
+{
+    buf->filetype = STAT_TYPE_DIRECTORY;
+    buf->inode = inode;
+    buf->size = DEVFS_COUNT * FILENAME_LEN;
+    buf->blocks = 0;
+    return 0;
+}
+
+/* devfs_dir_getdents
+ * 	Description: Fills records for the devices starting at an index.
+ *  Devices have no size.
+ * 	Inputs: inode, index, buf, count (records that fit in the buffer)
+ * 	Outputs: Return number of records filled
+ * 	Side Effects: Fills buf
+ */
+int32_t devfs_dir_getdents(uint32_t inode, uint32_t index, struct dirent* buf, uint32_t count)
+{
+    uint32_t i;
+
+    for(i = 0; i < count && index + i < DEVFS_COUNT; i++)
+    {
+        memset(buf[i].name, 0, FILENAME_LEN);
+        strncpy((int8_t *)buf[i].name, devfs_nodes[index + i].name, FILENAME_LEN);
+        buf[i].filetype = devfs_nodes[index + i].type;
+        buf[i].inode = index + i + 1;
+        buf[i].size = 0;
+    }
+
+    return i;
+}
@@ -0,0 +1,52 @@
+/*
+ * devfs.h
+ * Device filesystem, mounted on /dev. Its root directory lists a fixed
+ * table of devices, each a name, a file type and the operations table
+ * of its driver. Inode 0 is the directory, device i is inode i + 1.
+ */
+
+#ifndef _DEVFS_H
+#define _DEVFS_H
+
+#include "types.h"
+#include "vfs.h"
+
+/* Magic numbers */
+#define DEVFS_NAME_LEN      32
+
+/* One device file */
+typedef struct devfs_node
+{
+    const int8_t* name;
+    uint32_t type;
+    file_operations_table_pointer_t* ops;
+} devfs_node_t;
+
+/* Driver operations, also used for device entries in the image */
+extern file_operations_table_pointer_t rtc_operations_table;
+extern file_operations_table_pointer_t terminal_operations_table;
+
+extern vfs_backend_t devfs_backend;
+
+/* Find a device by name, "" for the directory */
+int32_t devfs_lookup(const uint8_t* path, vnode_t* node);
+
+/* List the device names, FILENAME_LEN bytes each */
+int32_t devfs_dir_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+
+/* The device directory cannot be written */
+int32_t devfs_dir_write(int32_t fd, const void* buf, int32_t nbytes);
+
+/* Does nothing but still returns a value */
+int32_t devfs_dir_open(const uint8_t* filename);
+
+/* Does nothing but still returns a value */
+int32_t devfs_dir_close(int32_t fd);
+
+/* Report the directory type and the size of its name listing */
+int32_t devfs_dir_stat(uint32_t inode, stat_t* buf);
+
+/* Fill records for the devices starting at an index */
+int32_t devfs_dir_getdents(uint32_t inode, uint32_t index, struct dirent* buf, uint32_t count);
+
+#endif /* _DEVFS_H */
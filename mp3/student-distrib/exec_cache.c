@@ -0,0 +1,191 @@
+#include "types.h"
+#include "lib.h"
+#include "filesystem.h"
+#include "exec_cache.h"
+
+/* Cached images and the LRU clock */
+static exec_cache_entry_t exec_cache[EXEC_CACHE_ENTRIES];
+static uint32_t exec_cache_clock = 0;
+static int32_t exec_cache_ready = 0;
+
+exec_stats_t exec_stats;
+uint32_t exec_start_tsc;
+
+/* exec_cache_init
+ * 	Description: Marks every entry empty on first use.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Clears the cache.
+ */
+static void exec_cache_init()
+{
+    int i;
+    for(i = 0; i < EXEC_CACHE_ENTRIES; i++)
+    {
+        exec_cache[i].inode = EXEC_CACHE_EMPTY;
+        exec_cache[i].last_used = 0;
+    }
+    exec_cache_ready = 1;
+}
+
+/* exec_cache_get
+ * 	Description: Returns the cache entry of an executable. On a miss the
+ *  ELF header is checked first, then the whole file is read once into
+ *  the least recently used entry.
+ * 	Inputs: inode, warm (set to 1 on a hit, 0 on a miss)
+ * 	Outputs: Return the entry, NULL if the file is not executable or does
+ *  not fit in an entry
+ * 	Side Effects: May evict another image.
+ */
+exec_cache_entry_t* exec_cache_get(uint32_t inode, int32_t* warm)
+{
+    int i;
+    uint32_t length;
+    uint8_t header[EXEC_HEADER_SIZE];
+    exec_cache_entry_t* victim;
+
+    if(!exec_cache_ready)
+    {
+        exec_cache_init();
+    }
+
+    *warm = 0;
+    exec_cache_clock++;
+
+    /* Hit: refresh the LRU stamp */
+    for(i = 0; i < EXEC_CACHE_ENTRIES; i++)
+    {
+        if(exec_cache[i].inode == (int32_t)inode)
+        {
+            exec_cache[i].last_used = exec_cache_clock;
+            *warm = 1;
+            return &exec_cache[i];
+        }
+    }
+
+    /* Only whole files that fit in an entry are cached */
+    if(inode >= boot_block_addr->inode_count)
+    {
+        return NULL;
+    }
+    length = (inode_addr + inode)->length;
+    if(length < EXEC_HEADER_SIZE || length > EXEC_CACHE_IMAGE_SIZE)
+    {
+        return NULL;
+    }
+
+    /* Checking for executable magic numbers before evicting anything */
+    if(read_data(inode, 0, header, EXEC_HEADER_SIZE) != EXEC_HEADER_SIZE)
+    {
+        return NULL;
+    }
+    if(header[0] != EXEC_MAGIC0 || header[1] != EXEC_MAGIC1 ||
+       header[2] != EXEC_MAGIC2 || header[3] != EXEC_MAGIC3)
+    {
+        return NULL;
+    }
+
+    /* Miss: take an empty entry, or the least recently used one */
+    victim = &exec_cache[0];
+    for(i = 0; i < EXEC_CACHE_ENTRIES; i++)
+    {
+        if(exec_cache[i].inode == EXEC_CACHE_EMPTY)
+        {
+            victim = &exec_cache[i];
+            break;
+        }
+        if(exec_cache[i].last_used < victim->last_used)
+        {
+            victim = &exec_cache[i];
+        }
+    }
+
+    /* Assemble the contiguous image */
+    victim->inode = EXEC_CACHE_EMPTY;
+    if(read_data(inode, 0, victim->image, length) != length)
+    {
+        return NULL;
+    }
+
+    /* Entry point is little endian at offset 24 */
+    victim->entry = 0;
+    for(i = 0; i < EXEC_MAGIC_SIZE; i++)
+    {
+        victim->entry |= header[EXEC_ENTRY_OFFSET + i] << (i * 8);
+    }
+
+    victim->inode = inode;
+    victim->length = length;
+    victim->last_used = exec_cache_clock;
+    return victim;
+}
+
+/* exec_cache_lookup
+ * 	Description: Finds the cached image of an inode without reading
+ *  anything on a miss, for page faults that want a single page.
+ * 	Inputs: inode
+ * 	Outputs: Return the entry, NULL if the inode is not cached
+ * 	Side Effects: None
+ */
+exec_cache_entry_t* exec_cache_lookup(uint32_t inode)
+{
+    int i;
+
+    if(!exec_cache_ready)
+    {
+        return NULL;
+    }
+
+    for(i = 0; i < EXEC_CACHE_ENTRIES; i++)
+    {
+        if(exec_cache[i].inode == (int32_t)inode)
+        {
+            return &exec_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/* exec_cache_invalidate
+ * 	Description: Drops the cached image of an inode so the next launch
+ *  reads the file again.
+ * 	Inputs: inode
+ * 	Outputs: None
+ * 	Side Effects: Empties the matching entry.
+ */
+void exec_cache_invalidate(uint32_t inode)
+{
+    int i;
+    for(i = 0; i < EXEC_CACHE_ENTRIES; i++)
+    {
+        if(exec_cache[i].inode == (int32_t)inode)
+        {
+            exec_cache[i].inode = EXEC_CACHE_EMPTY;
+        }
+    }
+}
+
+/* exec_stats_record
+ * 	Description: Adds the cycles since the execute trap to the cold or
+ *  warm launch counters.
+ * 	Inputs: warm
+ * 	Outputs: None
+ * 	Side Effects: Updates exec_stats.
+ */
+void exec_stats_record(int32_t warm)
+{
+    uint32_t cycles = rdtsc() - exec_start_tsc;
+
+    if(warm)
+    {
+        exec_stats.warm_count++;
+        exec_stats.warm_last = cycles;
+        exec_stats.warm_total += cycles;
+    }
+    else
+    {
+        exec_stats.cold_count++;
+        exec_stats.cold_last = cycles;
+        exec_stats.cold_total += cycles;
+    }
+}
@@ -0,0 +1,63 @@
+/*
+ * exec_cache.h
+ * Cache of validated executable images, keyed by inode. A cached entry
+ * holds the entry point and a contiguous copy of the file, so launching
+ * the same program again is a single memcpy into the user page.
+ */
+
+#ifndef _EXEC_CACHE_H
+#define _EXEC_CACHE_H
+
+#include "types.h"
+
+/* Magic numbers */
+#define EXEC_CACHE_ENTRIES      4
+#define EXEC_CACHE_IMAGE_SIZE   0x10000
+#define EXEC_CACHE_EMPTY        -1
+#define EXEC_MAGIC_SIZE         4
+#define EXEC_ENTRY_OFFSET       24
+#define EXEC_HEADER_SIZE        28
+#define EXEC_MAGIC0             0x7F
+#define EXEC_MAGIC1             0x45
+#define EXEC_MAGIC2             0x4C
+#define EXEC_MAGIC3             0x46
+
+/* One cached executable */
+typedef struct exec_cache_entry
+{
+    int32_t inode;
+    uint32_t length;
+    uint32_t entry;
+    uint32_t last_used;
+    uint8_t image[EXEC_CACHE_IMAGE_SIZE];
+} exec_cache_entry_t;
+
+/* Launch latency counters, in TSC cycles from int 0x80 to the user iret */
+typedef struct exec_stats
+{
+    uint32_t cold_count;
+    uint32_t cold_last;
+    uint32_t cold_total;
+    uint32_t warm_count;
+    uint32_t warm_last;
+    uint32_t warm_total;
+} exec_stats_t;
+
+extern exec_stats_t exec_stats;
+
+/* TSC value stamped by the syscall linkage when execute is entered */
+extern uint32_t exec_start_tsc;
+
+/* Find or fill the cache entry for an executable, NULL if not executable */
+exec_cache_entry_t* exec_cache_get(uint32_t inode, int32_t* warm);
+
+/* The cache entry of an inode if it is cached, NULL otherwise; never fills one */
+exec_cache_entry_t* exec_cache_lookup(uint32_t inode);
+
+/* Drop the cached image of an inode */
+void exec_cache_invalidate(uint32_t inode);
+
+/* Record the latency of a launch that is about to iret */
+void exec_stats_record(int32_t warm);
+
+#endif /* _EXEC_CACHE_H */
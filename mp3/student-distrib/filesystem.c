@@ -1,130 +1,1910 @@
 #include "types.h"
 #include "lib.h"
 #include "filesystem.h"
+#include "syscall.h"
+#include "exec_cache.h"
+#include "lz.h"
+#include "zcache.h"
+#include "ata.h"
+#include "bcache.h"
+#include "vfs.h"
+
+/* Blocks handed out once the image's own free blocks are used up */
+static data_t fs_extra_blocks[FS_EXTRA_BLOCKS] __attribute__((aligned(BLOCK_SIZE)));
+
+/* Free-block and free-inode bitmaps, a set bit means in use */
+static uint32_t fs_block_map[FS_MAX_BLOCKS / BITMAP_WORD_BITS];
+static uint32_t fs_inode_map[FS_MAX_INODES / BITMAP_WORD_BITS];
+
+/* 
+ * Number of file block slots pointing at each data block. Image
+ * builders may store identical blocks once, so a block can belong to
+ * several files; it is copied before a write and freed with its last user.
+ */
+static uint8_t fs_block_refs[FS_MAX_BLOCKS];
+
+/* Word where the last allocation succeeded */
+static uint32_t fs_block_hint;
+static uint32_t fs_inode_hint;
+
+/* Image blocks plus the extra blocks, or the disk's data blocks */
+static uint32_t fs_block_total;
+
+/* 
+ * Boot block and inodes of a filesystem mounted from the data disk.
+ * They stay in memory while mounted and are written back by fs_sync;
+ * data blocks go through the buffer cache.
+ */
+static data_t fs_disk_header[FS_DISK_HEADER_BLOCKS] __attribute__((aligned(BLOCK_SIZE)));
+
+/* Disk block holding data block 0, and the disk's size in blocks */
+static uint32_t fs_disk_first;
+static uint32_t fs_disk_blocks;
+
+/* 
+ * Old inode while fs_make_indirect rewrites it, block list of
+ * fs_inflate, and compressed bytes that straddle two disk blocks.
+ */
+static data_t fs_scratch __attribute__((aligned(BLOCK_SIZE)));
+static data_t fs_stream_buf __attribute__((aligned(BLOCK_SIZE)));
+
+static void fs_reset_maps();
+static void fs_claim_inode(uint32_t inode);
+static void fs_scan_dir(uint32_t dir, uint32_t depth);
+static dentry_t* fs_dir_entry(uint32_t dir, uint32_t index);
+static uint32_t fs_block_of(inode_t* inode, uint32_t idx);
+static uint32_t fs_layout(inode_t* inode);
+static int32_t fs_walk(uint32_t dir, const uint8_t* path, const uint8_t** name, uint32_t* length);
+static void fs_truncate(inode_t* inode, uint32_t length);
+static void dentry_hash_insert(uint32_t dir, int32_t index);
+static int32_t dentry_hash_find(uint32_t dir, const uint8_t* fname, uint32_t length);
+static void dentry_hash_remove(uint32_t dir, int32_t index);
 
 /* filesystem_init
  * 	Description: Initializes all the starting pointers for the 
- *  boot block, inode block, and the data block.
+ *  boot block, inode block, and the data block, and builds the
+ *  dentry name index.
  * 	Inputs: Address of the boot block
  * 	Outputs: None
- * 	Side Effects: Stores the starting address of the boot block,
- *  inode block, and the data block. These are used later for indexing.
+ * 	Side Effects: Stores the starting address of the boot block,
+ *  inode block, and the data block. These are used later for indexing.
+ *  Fills dentry_hash with one slot per used dentry of every directory
+ *  and builds the free-block and free-inode bitmaps.
+ */
+void filesystem_init(boot_block_t* boot_block)
+{
+    int i;
+
+    /* Initialize pointers */
+    boot_block_addr = boot_block;
+    inode_addr = (inode_t *) (boot_block + 1);
+    data_addr = (data_t *) (boot_block + boot_block->inode_count + 1);
+
+    /* Empty the name index */
+    for(i = 0; i < DENTRY_HASH_SIZE; i++)
+    {
+        dentry_hash[i].hash = 0;
+        dentry_hash[i].dir = ROOT_DIR;
+        dentry_hash[i].index = DENTRY_HASH_EMPTY;
+    }
+
+    /* Lookups remembered against the old image are stale */
+    fs_generation++;
+
+    /* Walk the tree from the root, indexing names and claiming inodes */
+    fs_writable = FS_WRITABLE_DEFAULT;
+    zcache_reset();
+    fs_reset_maps();
+    fs_scan_dir(ROOT_DIR, 0);
+}
+
+/* fs_mount_disk
+ * 	Description: Mounts the filesystem image written to the data disk.
+ *  The boot block and inodes are copied into memory, where the rest of
+ *  this file expects them, and data blocks are read through the buffer
+ *  cache. A disk without a valid image is left alone.
+ * 	Inputs: None
+ * 	Outputs: Return 0 on success, -1 if there is no usable image
+ * 	Side Effects: Replaces the mounted filesystem and rebuilds the
+ *  name index and bitmaps.
+ */
+int32_t fs_mount_disk()
+{
+    uint32_t i, header;
+    boot_block_t* boot;
+    uint8_t* block;
+
+    fs_disk_blocks = ata_sectors() / (BLOCK_SIZE / ATA_SECTOR_SIZE);
+    if(fs_disk_blocks == 0)
+    {
+        return -1;
+    }
+    bcache_init(fs_disk_blocks);
+
+    /* The header has to fit in fs_disk_header and the image on the disk */
+    boot = (boot_block_t *)bcache_read(0);
+    if(boot == NULL || boot->inode_count < 1 || boot->inode_count > FS_DISK_MAX_INODES ||
+       boot->dir_count < 0 || boot->dir_count > DENTRY_SIZE - 1 ||
+       boot->data_count < 0 || boot->data_count > FS_MAX_BLOCKS ||
+       1 + boot->inode_count + boot->data_count > fs_disk_blocks)
+    {
+        return -1;
+    }
+
+    header = 1 + boot->inode_count;
+    for(i = 0; i < header; i++)
+    {
+        block = bcache_read(i);
+        if(block == NULL)
+        {
+            return -1;
+        }
+        memcpy(&fs_disk_header[i], block, BLOCK_SIZE);
+    }
+
+    fs_disk_first = header;
+    fs_on_disk = 1;
+    filesystem_init((boot_block_t *)fs_disk_header);
+    return 0;
+}
+
+/* fs_sync
+ * 	Description: Makes the data disk match the mounted filesystem. The
+ *  image's data count grows to cover every block in use, so the disk
+ *  can also be loaded as a module, then the in-memory header and the
+ *  dirty cached blocks are written back.
+ * 	Inputs: None
+ * 	Outputs: Return 0, -1 on a disk error
+ * 	Side Effects: Writes the disk. Does nothing for the module.
+ */
+int32_t fs_sync()
+{
+    uint32_t i, used;
+    uint8_t* block;
+
+    if(!fs_on_disk)
+    {
+        return 0;
+    }
+
+    for(used = fs_block_total; used > 0; used--)
+    {
+        if(fs_block_map[(used - 1) / BITMAP_WORD_BITS] & (1 << ((used - 1) % BITMAP_WORD_BITS)))
+        {
+            break;
+        }
+    }
+    if(used > boot_block_addr->data_count)
+    {
+        boot_block_addr->data_count = used;
+    }
+
+    for(i = 0; i < fs_disk_first; i++)
+    {
+        block = bcache_write(i);
+        if(block == NULL)
+        {
+            return -1;
+        }
+        memcpy(block, &fs_disk_header[i], BLOCK_SIZE);
+    }
+    return bcache_sync();
+}
+
+/* fs_scan_dir
+ * 	Description: Indexes every dentry of a directory, claims the inodes
+ *  and blocks they use and descends into subdirectories. A directory
+ *  whose inode is already claimed is not entered again, so a corrupt
+ *  image cannot loop.
+ * 	Inputs: dir (inode of the directory), depth
+ * 	Outputs: None
+ * 	Side Effects: Fills dentry_hash and the bitmaps.
+ */
+static void fs_scan_dir(uint32_t dir, uint32_t depth)
+{
+    uint32_t i, count, inode;
+    int32_t seen, type;
+    dentry_t* dentry;
+
+    count = fs_dir_count(dir);
+    for(i = 0; i < count; i++)
+    {
+        dentry = fs_dir_entry(dir, i);
+        if(dentry == NULL)
+        {
+            return;
+        }
+        dentry_hash_insert(dir, i);
+
+        /* Claiming may push the dentry's block out of the buffer cache */
+        inode = dentry->inode_num;
+        type = dentry->filetype;
+        if((type != FILE_TYPE_REGULAR && type != FILE_TYPE_DIRECTORY) ||
+           inode == ROOT_DIR || inode >= boot_block_addr->inode_count || inode >= FS_MAX_INODES)
+        {
+            continue;
+        }
+
+        seen = fs_inode_map[inode / BITMAP_WORD_BITS] & (1 << (inode % BITMAP_WORD_BITS));
+        fs_claim_inode(inode);
+        if(type == FILE_TYPE_DIRECTORY && !seen && depth < FS_MAX_DEPTH)
+        {
+            fs_scan_dir(inode, depth + 1);
+        }
+    }
+}
+
+/* fs_dir_count
+ * 	Description: Gets the number of entries in a directory. The root
+ *  keeps its entries in the boot block, other directories keep packed
+ *  dentries in their data blocks.
+ * 	Inputs: dir (inode of the directory)
+ * 	Outputs: Return the number of entries
+ * 	Side Effects: None
+ */
+uint32_t fs_dir_count(uint32_t dir)
+{
+    if(dir == ROOT_DIR)
+    {
+        return (boot_block_addr->dir_count < DENTRY_SIZE - 1) ? boot_block_addr->dir_count : DENTRY_SIZE - 1;
+    }
+    if(dir >= boot_block_addr->inode_count)
+    {
+        return 0;
+    }
+    return (inode_addr + dir)->length / sizeof(dentry_t);
+}
+
+/* fs_dir_entry
+ * 	Description: Gets the address of a directory entry.
+ * 	Inputs: dir (inode of the directory), index
+ * 	Outputs: Return the dentry, NULL if out of range
+ * 	Side Effects: None
+ */
+static dentry_t* fs_dir_entry(uint32_t dir, uint32_t index)
+{
+    data_t* block;
+
+    if(index >= fs_dir_count(dir))
+    {
+        return NULL;
+    }
+    if(dir == ROOT_DIR)
+    {
+        return &(boot_block_addr->direntries[index]);
+    }
+
+    block = fs_data_block(fs_block_of(inode_addr + dir, index / DENTRIES_PER_BLOCK));
+    if(block == NULL)
+    {
+        return NULL;
+    }
+    return (dentry_t *)block->val + index % DENTRIES_PER_BLOCK;
+}
+
+/* filename_hash
+ * 	Description: FNV-1a hash of a file name, seeded with the inode of
+ *  the directory holding it. Stops at the first NUL or after length
+ *  bytes, since names that fill the dentry are not terminated.
+ * 	Inputs: dir, fname, length (at most FILENAME_LEN)
+ * 	Outputs: Return the hash
+ * 	Side Effects: None
+ */
+uint32_t filename_hash(uint32_t dir, const uint8_t* fname, uint32_t length)
+{
+    int i;
+    uint32_t hash = (FNV_OFFSET_BASIS ^ dir) * FNV_PRIME;
+
+    for(i = 0; i < length && i < FILENAME_LEN && fname[i] != '\0'; i++)
+    {
+        hash = (hash ^ fname[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/* fs_walk
+ * 	Description: Follows a '/' separated path up to its last component.
+ *  Every earlier component must name a directory. A leading '/' starts
+ *  from the root, and repeated or trailing separators are ignored.
+ * 	Inputs: dir (where relative paths start), path (terminated), name,
+ *  length
+ * 	Outputs: Return the inode of the directory holding the last
+ *  component, -1 on failure
+ * 	Side Effects: Stores the last component and its length in name and
+ *  length. The component is not terminated.
+ */
+static int32_t fs_walk(uint32_t dir, const uint8_t* path, const uint8_t** name, uint32_t* length)
+{
+    uint32_t len, next, depth;
+    int32_t index;
+    dentry_t* dentry;
+
+    if(*path == PATH_SEPARATOR)
+    {
+        dir = ROOT_DIR;
+    }
+    while(*path == PATH_SEPARATOR)
+    {
+        path++;
+    }
+
+    for(depth = 0; ; depth++)
+    {
+        /* Measure the component and skip the separators after it */
+        for(len = 0; path[len] != '\0' && path[len] != PATH_SEPARATOR; len++);
+        for(next = len; path[next] == PATH_SEPARATOR; next++);
+        if(len == 0 || len > FILENAME_LEN)
+        {
+            return -1;
+        }
+
+        /* Last component, hand it back */
+        if(path[next] == '\0')
+        {
+            *name = path;
+            *length = len;
+            return dir;
+        }
+
+        /* Intermediate components have to be directories */
+        index = dentry_hash_find(dir, path, len);
+        if(index == DENTRY_HASH_EMPTY || depth >= FS_MAX_DEPTH)
+        {
+            return -1;
+        }
+        dentry = fs_dir_entry(dir, index);
+        if(dentry->filetype != FILE_TYPE_DIRECTORY)
+        {
+            return -1;
+        }
+        dir = dentry->inode_num;
+        path += next;
+    }
+}
+
+/* read_dentry_by_name
+ * 	Description: Reads the dentry given a name, which may be a path
+ *  like "bin/grep". Each component is hashed once and looked up in the
+ *  index built by filesystem_init.
+ * 	Inputs: fname, dentry
+ * 	Outputs: Return -1 on failure, 0 on success
+ * 	Side Effects: Stores the dentry filetype and inode_num, given the 
+ *  file name.
+ */
+int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry)
+{
+    const uint8_t* name;
+    uint32_t length;
+    int32_t dir, index;
+    dentry_t* found;
+
+    /* Check if path length is invalid or if null and also check if dentry is null */
+    if(fname == NULL || dentry == NULL || strlen((int8_t *)fname) > PATH_MAX_LEN)
+    {
+        return -1;
+    }
+
+    /* One hash, then one compare per probe with a matching hash */
+    dir = fs_walk(ROOT_DIR, fname, &name, &length);
+    if(dir == -1)
+    {
+        return -1;
+    }
+    index = dentry_hash_find(dir, name, length);
+
+    /* Return -1 on failure */
+    if(index == DENTRY_HASH_EMPTY)
+    {
+        return -1;
+    }
+
+    /* Copy over the file name, the file type, and the inode num */
+    found = fs_dir_entry(dir, index);
+    memcpy((int8_t *)dentry->filename, (int8_t *)found->filename, FILENAME_LEN);
+    dentry->filetype = found->filetype;
+    dentry->inode_num = found->inode_num;
+
+    /* Return 0 on success */
+    return 0;
+}
+
+/* dentry_hash_insert
+ * 	Description: Adds a dentry to the name index, probing linearly on
+ *  collisions.
+ * 	Inputs: dir (inode of the directory), index of the dentry
+ * 	Outputs: None
+ * 	Side Effects: Fills one slot of dentry_hash.
+ */
+static void dentry_hash_insert(uint32_t dir, int32_t index)
+{
+    uint32_t hash = filename_hash(dir, (uint8_t *)fs_dir_entry(dir, index)->filename, FILENAME_LEN);
+    uint32_t slot = hash & (DENTRY_HASH_SIZE - 1);
+
+    while(dentry_hash[slot].index != DENTRY_HASH_EMPTY)
+    {
+        slot = (slot + 1) & (DENTRY_HASH_SIZE - 1);
+    }
+    dentry_hash[slot].hash = hash;
+    dentry_hash[slot].dir = dir;
+    dentry_hash[slot].index = index;
+}
+
+/* dentry_hash_find
+ * 	Description: Looks a name up in the index.
+ * 	Inputs: dir (inode of the directory), fname, length (bytes of the
+ *  name, which need not be terminated)
+ * 	Outputs: Return the dentry index, DENTRY_HASH_EMPTY if not found
+ * 	Side Effects: None
+ */
+static int32_t dentry_hash_find(uint32_t dir, const uint8_t* fname, uint32_t length)
+{
+    uint32_t hash = filename_hash(dir, fname, length);
+    uint32_t slot = hash & (DENTRY_HASH_SIZE - 1);
+    int32_t index;
+    dentry_t* dentry;
+
+    /* Probe from the home slot until the name or an empty slot is found */
+    while((index = dentry_hash[slot].index) != DENTRY_HASH_EMPTY)
+    {
+        if(dentry_hash[slot].hash == hash && dentry_hash[slot].dir == dir)
+        {
+            dentry = fs_dir_entry(dir, index);
+            if(!strncmp((int8_t *)dentry->filename, (int8_t *)fname, length) &&
+               (length == FILENAME_LEN || dentry->filename[length] == '\0'))
+            {
+                return index;
+            }
+        }
+        slot = (slot + 1) & (DENTRY_HASH_SIZE - 1);
+    }
+
+    return DENTRY_HASH_EMPTY;
+}
+
+/* dentry_hash_remove
+ * 	Description: Drops a dentry from the index. Later slots of the same
+ *  probe chain are shifted back so lookups never stop early.
+ * 	Inputs: dir (inode of the directory), index of the dentry
+ * 	Outputs: None
+ * 	Side Effects: Empties or refills slots of dentry_hash.
+ */
+static void dentry_hash_remove(uint32_t dir, int32_t index)
+{
+    uint32_t hole, next, home;
+
+    /* Find the slot holding the dentry */
+    hole = filename_hash(dir, (uint8_t *)fs_dir_entry(dir, index)->filename, FILENAME_LEN) & (DENTRY_HASH_SIZE - 1);
+    while(dentry_hash[hole].index != index || dentry_hash[hole].dir != dir)
+    {
+        if(dentry_hash[hole].index == DENTRY_HASH_EMPTY)
+        {
+            return;
+        }
+        hole = (hole + 1) & (DENTRY_HASH_SIZE - 1);
+    }
+
+    /* Move back every later entry whose home slot is not past the hole */
+    next = (hole + 1) & (DENTRY_HASH_SIZE - 1);
+    while(dentry_hash[next].index != DENTRY_HASH_EMPTY)
+    {
+        home = dentry_hash[next].hash & (DENTRY_HASH_SIZE - 1);
+        if(((next - home) & (DENTRY_HASH_SIZE - 1)) >= ((next - hole) & (DENTRY_HASH_SIZE - 1)))
+        {
+            dentry_hash[hole] = dentry_hash[next];
+            hole = next;
+        }
+        next = (next + 1) & (DENTRY_HASH_SIZE - 1);
+    }
+
+    dentry_hash[hole].hash = 0;
+    dentry_hash[hole].dir = ROOT_DIR;
+    dentry_hash[hole].index = DENTRY_HASH_EMPTY;
+}
+
+/* read_dentry_by_index
+ * 	Description: Reads the dentry given an index in the root directory.
+ * 	Inputs: index, dentry
+ * 	Outputs: Return -1 on failure, 0 on success
+ * 	Side Effects: Stores the dentry filetype and inode_num, given the 
+ *  file index.
+ */
+int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry)
+{
+    /* If an index is out of range or dentry is null, return -1 */
+    if(index > boot_block_addr->dir_count || dentry == NULL)
+    {
+        return -1;
+    }
+    
+    /* Otherwise, copy over the file name, file type, and the inode num */
+    memcpy((int8_t *)dentry->filename, (int8_t *)boot_block_addr->direntries[index].filename, FILENAME_LEN);
+    dentry->inode_num = boot_block_addr->direntries[index].inode_num;
+    dentry->filetype = boot_block_addr->direntries[index].filetype;
+
+    /* Return 0 on success */
+    return 0;
+}
+
+/* fs_data_block
+ * 	Description: Gets the address of a data block. Numbers past the
+ *  image's data blocks refer to the extra blocks kept in kernel memory.
+ *  On the data disk every block comes from the buffer cache, and the
+ *  address only stays valid until the next few block accesses.
+ * 	Inputs: block
+ * 	Outputs: Return the block, NULL if the number is out of range or
+ *  the disk failed
+ * 	Side Effects: May read the disk.
+ */
+data_t* fs_data_block(uint32_t block)
+{
+    if(fs_on_disk)
+    {
+        return (block < fs_block_total) ? (data_t *)bcache_read(fs_disk_first + block) : NULL;
+    }
+    if(block < boot_block_addr->data_count)
+    {
+        return data_addr + block;
+    }
+    if(block < fs_block_total)
+    {
+        return &fs_extra_blocks[block - boot_block_addr->data_count];
+    }
+    return NULL;
+}
+
+/* fs_data_dirty
+ * 	Description: Records that a data block was changed through the
+ *  address from fs_data_block, so the buffer cache writes it back.
+ *  Blocks in memory need nothing.
+ * 	Inputs: block
+ * 	Outputs: None
+ * 	Side Effects: Marks the cached block dirty.
+ */
+static void fs_data_dirty(uint32_t block)
+{
+    if(fs_on_disk && block < fs_block_total)
+    {
+        bcache_dirty(fs_disk_first + block);
+    }
+}
+
+/* fs_file_dirty
+ * 	Description: Marks the data block holding a file offset dirty. On
+ *  the data disk fs_span hands out one block at a time, so this covers
+ *  a whole span.
+ * 	Inputs: inode pointer, offset
+ * 	Outputs: None
+ * 	Side Effects: Marks the cached block dirty.
+ */
+static void fs_file_dirty(inode_t* inode, uint32_t offset)
+{
+    if(fs_on_disk)
+    {
+        fs_data_dirty(fs_block_of(inode, offset / BLOCK_SIZE));
+    }
+}
+
+/* fs_area_left
+ * 	Description: Counts the blocks from a block to the end of the area
+ *  holding it. The image's blocks and the extra blocks are two areas in
+ *  memory; the data disk is one.
+ * 	Inputs: block (less than fs_block_total)
+ * 	Outputs: Return the number of blocks
+ * 	Side Effects: None
+ */
+static uint32_t fs_area_left(uint32_t block)
+{
+    if(fs_on_disk || block >= boot_block_addr->data_count)
+    {
+        return fs_block_total - block;
+    }
+    return boot_block_addr->data_count - block;
+}
+
+/* fs_layout
+ * 	Description: Tells which of the inode layouts an inode uses.
+ *  Extent, indirect and compressed inodes keep a tag where a direct
+ *  inode keeps its first block number.
+ * 	Inputs: inode pointer
+ * 	Outputs: Return INODE_LAYOUT_DIRECT, INODE_LAYOUT_EXTENT,
+ *  INODE_LAYOUT_INDIRECT or INODE_LAYOUT_COMPRESSED
+ * 	Side Effects: None
+ */
+static uint32_t fs_layout(inode_t* inode)
+{
+    uint32_t tag = (uint32_t)inode->data_block_num[0];
+
+    if(tag == INODE_LAYOUT_EXTENT || tag == INODE_LAYOUT_INDIRECT || tag == INODE_LAYOUT_COMPRESSED)
+    {
+        return tag;
+    }
+    return INODE_LAYOUT_DIRECT;
+}
+
+/* fs_extent_find
+ * 	Description: Binary search for the extent holding a file block.
+ * 	Inputs: extent inode pointer, idx (file block)
+ * 	Outputs: Return the extent, NULL if no extent holds the block
+ * 	Side Effects: None
+ */
+static extent_t* fs_extent_find(inode_extent_t* inode, uint32_t idx)
+{
+    uint32_t low = 0;
+    uint32_t high = (inode->count < EXTENTS_PER_INODE) ? inode->count : EXTENTS_PER_INODE;
+    uint32_t mid;
+    extent_t* ext;
+
+    while(low < high)
+    {
+        mid = (low + high) / 2;
+        ext = &(inode->extents[mid]);
+        if(idx < ext->first)
+        {
+            high = mid;
+        }
+        else if(idx - ext->first >= ext->count)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            return ext;
+        }
+    }
+
+    return NULL;
+}
+
+/* fs_block_of
+ * 	Description: Gets the data block holding a block of a file, for any
+ *  inode layout. Blocks of a compressed inode have no data block of
+ *  their own.
+ * 	Inputs: inode pointer, idx (file block)
+ * 	Outputs: Return the block number, FS_BAD_BLOCK if there is none
+ * 	Side Effects: None
+ */
+static uint32_t fs_block_of(inode_t* inode, uint32_t idx)
+{
+    uint32_t layout = fs_layout(inode);
+    inode_indirect_t* indirect;
+    extent_t* ext;
+    data_t* table;
+
+    if(layout == INODE_LAYOUT_COMPRESSED)
+    {
+        return FS_BAD_BLOCK;
+    }
+    if(layout == INODE_LAYOUT_EXTENT)
+    {
+        ext = fs_extent_find((inode_extent_t *)inode, idx);
+        return (ext == NULL) ? FS_BAD_BLOCK : ext->start + (idx - ext->first);
+    }
+    if(layout == INODE_LAYOUT_INDIRECT)
+    {
+        indirect = (inode_indirect_t *)inode;
+        if(idx / BLOCKS_PER_INDIRECT >= INDIRECT_PER_INODE)
+        {
+            return FS_BAD_BLOCK;
+        }
+        table = fs_data_block(indirect->blocks[idx / BLOCKS_PER_INDIRECT]);
+        return (table == NULL) ? FS_BAD_BLOCK : ((uint32_t *)table->val)[idx % BLOCKS_PER_INDIRECT];
+    }
+
+    return (idx < DATA_BLOCK_NUM_SIZE) ? (uint32_t)inode->data_block_num[idx] : FS_BAD_BLOCK;
+}
+
+/* fs_bmap
+ * 	Description: Gets the data block holding a block of a file.
+ * 	Inputs: inode, index (file block)
+ * 	Outputs: Return the block number, -1 for a bad inode or a block
+ *  past the end of the file
+ * 	Side Effects: None
+ */
+int32_t fs_bmap(uint32_t inode, uint32_t index)
+{
+    uint32_t block;
+    inode_t* node;
+
+    if(inode >= boot_block_addr->inode_count)
+    {
+        return -1;
+    }
+    node = inode_addr + inode;
+    if(index >= (node->length + BLOCK_SIZE - 1) / BLOCK_SIZE)
+    {
+        return -1;
+    }
+
+    block = fs_block_of(node, index);
+    return (fs_data_block(block) == NULL) ? -1 : (int32_t)block;
+}
+
+/* fs_run
+ * 	Description: Finds how many file blocks starting at idx sit in
+ *  consecutive data blocks. An extent answers in one lookup, the other
+ *  layouts compare block numbers one at a time.
+ * 	Inputs: inode pointer, idx (file block), want (most blocks wanted),
+ *  block
+ * 	Outputs: Return the number of blocks in the run, 0 on a bad block
+ * 	Side Effects: Stores the first block number in block.
+ */
+static uint32_t fs_run(inode_t* inode, uint32_t idx, uint32_t want, uint32_t* block)
+{
+    uint32_t run;
+    extent_t* ext;
+
+    if(fs_layout(inode) == INODE_LAYOUT_EXTENT)
+    {
+        ext = fs_extent_find((inode_extent_t *)inode, idx);
+        if(ext == NULL)
+        {
+            return 0;
+        }
+        *block = ext->start + (idx - ext->first);
+        run = ext->count - (idx - ext->first);
+        return (run < want) ? run : want;
+    }
+
+    *block = fs_block_of(inode, idx);
+    if(*block == FS_BAD_BLOCK)
+    {
+        return 0;
+    }
+    for(run = 1; run < want && fs_block_of(inode, idx + run) == *block + run; run++);
+    return run;
+}
+
+/* fs_stream_blocks
+ * 	Description: Counts the data blocks holding a compressed inode's
+ *  stream.
+ * 	Inputs: compressed inode pointer
+ * 	Outputs: Return the number of blocks
+ * 	Side Effects: None
+ */
+static uint32_t fs_stream_blocks(inode_compressed_t* inode)
+{
+    return (inode->size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+/* fs_stream_bytes
+ * 	Description: Gets bytes of a compressed stream as one contiguous
+ *  piece. In memory the stream is contiguous already; on the data disk
+ *  a piece that straddles two blocks is copied into fs_stream_buf.
+ * 	Inputs: compressed inode pointer, from (stream offset), size
+ * 	Outputs: Return the bytes, NULL if a block is missing
+ * 	Side Effects: May overwrite fs_stream_buf.
+ */
+static uint8_t* fs_stream_bytes(inode_compressed_t* node, uint32_t from, uint32_t size)
+{
+    uint32_t block = node->start + from / BLOCK_SIZE;
+    uint32_t data = from % BLOCK_SIZE;
+    uint32_t done, span;
+    data_t* src;
+
+    if(!fs_on_disk)
+    {
+        src = fs_data_block(node->start);
+        return (src == NULL) ? NULL : (uint8_t *)src->val + from;
+    }
+
+    src = fs_data_block(block);
+    if(src == NULL || data + size <= BLOCK_SIZE)
+    {
+        return (src == NULL) ? NULL : (uint8_t *)src->val + data;
+    }
+    if(size > BLOCK_SIZE)
+    {
+        return NULL;
+    }
+
+    for(done = 0; done < size; done += span, data = 0)
+    {
+        src = fs_data_block(block++);
+        if(src == NULL)
+        {
+            return NULL;
+        }
+        span = BLOCK_SIZE - data;
+        if(span > size - done)
+        {
+            span = size - done;
+        }
+        memcpy(fs_stream_buf.val + done, src->val + data, span);
+    }
+    return (uint8_t *)fs_stream_buf.val;
+}
+
+/* fs_compressed_block
+ * 	Description: Gets the contents of one block of a compressed file. A
+ *  block stored as it is comes straight from the stream, any other is
+ *  decoded into the block cache on a miss.
+ * 	Inputs: inode pointer, idx (file block)
+ * 	Outputs: Return the block's data, NULL if the stream is corrupt
+ * 	Side Effects: May decode a block, evicting another from the cache.
+ */
+static uint8_t* fs_compressed_block(inode_t* inode, uint32_t idx)
+{
+    inode_compressed_t* node = (inode_compressed_t *)inode;
+    uint32_t inode_num = inode - inode_addr;
+    uint32_t from, to, size, limit;
+    data_t* base = fs_data_block(node->start);
+    uint8_t* src;
+    uint8_t* dst;
+
+    /* The stream must not cross from the image's blocks into the extra blocks */
+    if(base == NULL)
+    {
+        return NULL;
+    }
+    limit = fs_area_left(node->start);
+    if(idx >= COMPRESSED_PER_INODE || fs_stream_blocks(node) > limit)
+    {
+        return NULL;
+    }
+    from = node->offsets[idx];
+    to = node->offsets[idx + 1];
+    if(from > to || to > node->size)
+    {
+        return NULL;
+    }
+
+    /* Every block but the last decodes to a whole block */
+    size = node->length - idx * BLOCK_SIZE;
+    if(size > BLOCK_SIZE)
+    {
+        size = BLOCK_SIZE;
+    }
+
+    if(to - from == size)
+    {
+        return fs_stream_bytes(node, from, size);
+    }
+
+    dst = zcache_lookup(inode_num, idx);
+    if(dst != NULL)
+    {
+        return dst;
+    }
+    src = fs_stream_bytes(node, from, to - from);
+    if(src == NULL)
+    {
+        return NULL;
+    }
+    dst = zcache_claim(inode_num, idx);
+    if(lz_decompress(src, to - from, dst, size) != size)
+    {
+        zcache_invalidate(inode_num);
+        return NULL;
+    }
+    return dst;
+}
+
+/* fs_span
+ * 	Description: Finds the longest physically contiguous run of file
+ *  data starting at offset. The run of consecutive block numbers comes
+ *  from fs_run, then it is cut where the image's blocks end and the
+ *  extra blocks begin, since those are not next to each other in memory.
+ *  A compressed file yields one decoded block at a time.
+ * 	Inputs: inode pointer, offset, remaining (most bytes wanted), ptr
+ * 	Outputs: Return the number of bytes in the run, 0 on a bad block
+ * 	Side Effects: Stores the address of the data at offset in ptr.
+ */
+static uint32_t fs_span(inode_t* inode, uint32_t offset, uint32_t remaining, uint8_t** ptr)
+{
+    uint32_t idx = offset / BLOCK_SIZE;
+    uint32_t data = offset % BLOCK_SIZE;
+    uint32_t block, run, limit, span;
+    data_t* base;
+    uint8_t* decoded;
+
+    if(fs_layout(inode) == INODE_LAYOUT_COMPRESSED)
+    {
+        decoded = fs_compressed_block(inode, idx);
+        if(decoded == NULL)
+        {
+            return 0;
+        }
+        span = BLOCK_SIZE - data;
+        *ptr = decoded + data;
+        return (span < remaining) ? span : remaining;
+    }
+
+    run = fs_run(inode, idx, (data + remaining + BLOCK_SIZE - 1) / BLOCK_SIZE, &block);
+    base = fs_data_block(block);
+
+    /* Bad block number means the image is corrupt */
+    if(run == 0 || base == NULL)
+    {
+        return 0;
+    }
+
+    /* Stay inside the area holding the first block, cached disk blocks are not adjacent */
+    limit = fs_on_disk ? 1 : fs_area_left(block);
+    if(run > limit)
+    {
+        run = limit;
+    }
+
+    /* Last span may end in the middle of a block */
+    span = run * BLOCK_SIZE - data;
+    if(span > remaining)
+    {
+        span = remaining;
+    }
+
+    *ptr = (uint8_t *)base->val + data;
+    return span;
+}
+
+/* read_data
+ * 	Description: Reads the data inside the inode. The file is walked one
+ *  block run at a time: each data block number is resolved once, physically
+ *  consecutive blocks are merged into a single span, and every span is
+ *  copied with memcpy. Reading stops at the end of the file.
+ *  Inputs: inode, offset, buffer, length.
+ * 	Outputs: Return number of bytes read, -1 on failure
+ * 	Side Effects: Stores the data inside the buffer, given an inode.
+ */
+int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+{
+    /* If inode is out of range or if the buffer is empty, return -1 */
+    if(inode >= boot_block_addr->inode_count || buf == NULL)
+    {
+        return -1;
+    }
+
+    /* Intialize variables */
+    uint32_t span;
+    uint32_t read_counter = 0;
+    uint8_t* src;
+    inode_t* cur_inode_ptr = (inode_t *) (inode + inode_addr);
+    uint32_t file_length = cur_inode_ptr->length;
+
+    /* Nothing to read at or past the end of the file */
+    if(offset >= file_length)
+    {
+        return 0;
+    }
+
+    /* Clamp the request to the end of the file */
+    if(length > file_length - offset)
+    {
+        length = file_length - offset;
+    }
+
+    /* Copy one run of consecutive data blocks per iteration */
+    while(read_counter < length)
+    {
+        span = fs_span(cur_inode_ptr, offset, length - read_counter, &src);
+        if(span == 0)
+        {
+            return -1;
+        }
+
+        memcpy(buf + read_counter, src, span);
+
+        /* Advance the file offset and the number of bytes read */
+        offset += span;
+        read_counter += span;
+    }
+
+    /* Return number of bytes read */
+    return read_counter;
+}
+
+/* send_data
+ * 	Description: Hands the data of a file to a write function one span
+ *  at a time, straight from the data blocks (or the decoded block of a
+ *  compressed file) with no copy in between. Spans are the runs
+ *  read_data copies. Stops at the end of the file, when the write
+ *  function fails, or after a short write.
+ * 	Inputs: inode, offset, length, write (a write hook), fd (passed to it)
+ * 	Outputs: Return number of file bytes written, -1 on failure before any
+ * 	Side Effects: Whatever the write function does
+ */
+int32_t send_data(uint32_t inode, uint32_t offset, uint32_t length,
+                  int32_t (* write)(int32_t fd, const void* buf, int32_t nbytes), int32_t fd)
+{
+    uint32_t span;
+    uint32_t sent = 0;
+    int32_t written;
+    uint8_t* src;
+    inode_t* cur_inode_ptr;
+
+    if(inode >= boot_block_addr->inode_count || write == NULL)
+    {
+        return -1;
+    }
+    cur_inode_ptr = inode_addr + inode;
+
+    if(offset >= cur_inode_ptr->length)
+    {
+        return 0;
+    }
+    if(length > cur_inode_ptr->length - offset)
+    {
+        length = cur_inode_ptr->length - offset;
+    }
+
+    while(sent < length)
+    {
+        span = fs_span(cur_inode_ptr, offset, length - sent, &src);
+        written = (span == 0) ? -1 : write(fd, src, span);
+        if(written <= 0)
+        {
+            return (sent == 0) ? -1 : (int32_t)sent;
+        }
+        offset += written;
+        sent += written;
+        if((uint32_t)written < span)
+        {
+            break;
+        }
+    }
+
+    return sent;
+}
+
+/* bitmap_alloc
+ * 	Description: Takes the first clear bit at or after the hint word.
+ *  The hint moves to the word that satisfied the request, so repeated
+ *  allocations skip the full words in front of it.
+ * 	Inputs: map, number of words, hint
+ * 	Outputs: Return the bit number, -1 if every bit is set
+ * 	Side Effects: Sets the bit and updates the hint.
+ */
+static int32_t bitmap_alloc(uint32_t* map, uint32_t words, uint32_t* hint)
+{
+    uint32_t i, word, bit;
+
+    for(i = 0; i < words; i++)
+    {
+        word = (*hint + i) % words;
+        if(map[word] == BITMAP_FULL)
+        {
+            continue;
+        }
+        for(bit = 0; bit < BITMAP_WORD_BITS; bit++)
+        {
+            if(!(map[word] & (1 << bit)))
+            {
+                map[word] |= (1 << bit);
+                *hint = word;
+                return word * BITMAP_WORD_BITS + bit;
+            }
+        }
+    }
+
+    return -1;
+}
+
+/* bitmap_set
+ * 	Description: Marks a bit used or free.
+ * 	Inputs: map, bit, used
+ * 	Outputs: None
+ * 	Side Effects: Changes the bit.
+ */
+static void bitmap_set(uint32_t* map, uint32_t bit, int32_t used)
+{
+    if(used)
+    {
+        map[bit / BITMAP_WORD_BITS] |= (1 << (bit % BITMAP_WORD_BITS));
+    }
+    else
+    {
+        map[bit / BITMAP_WORD_BITS] &= ~(1 << (bit % BITMAP_WORD_BITS));
+    }
+}
+
+/* fs_reset_maps
+ * 	Description: Clears the free-block and free-inode bitmaps and the
+ *  block reference counts before fs_scan_dir claims what the tree
+ *  uses. Inode 0 stays reserved since the rtc and root directory
+ *  dentries point at it. Bits past the end of the image and the extra
+ *  blocks are set so they are never handed out.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Fills fs_block_map, fs_block_refs and fs_inode_map.
+ */
+static void fs_reset_maps()
+{
+    int i;
+
+    /* The data disk's free space is limited by the bitmap instead */
+    fs_block_total = boot_block_addr->data_count + FS_EXTRA_BLOCKS;
+    if(fs_on_disk)
+    {
+        fs_block_total = fs_disk_blocks - fs_disk_first;
+        if(fs_block_total > FS_MAX_BLOCKS)
+        {
+            fs_block_total = FS_MAX_BLOCKS;
+        }
+    }
+    fs_block_hint = 0;
+    fs_inode_hint = 0;
+
+    for(i = 0; i < FS_MAX_BLOCKS; i++)
+    {
+        bitmap_set(fs_block_map, i, i >= fs_block_total);
+        fs_block_refs[i] = 0;
+    }
+    for(i = 0; i < FS_MAX_INODES; i++)
+    {
+        bitmap_set(fs_inode_map, i, i == 0 || i >= boot_block_addr->inode_count);
+    }
+}
+
+/* fs_claim_block
+ * 	Description: Marks a data block used and counts one more reference
+ *  to it.
+ * 	Inputs: block
+ * 	Outputs: None
+ * 	Side Effects: Changes fs_block_map and fs_block_refs.
+ */
+static void fs_claim_block(uint32_t block)
+{
+    if(block >= FS_MAX_BLOCKS)
+    {
+        return;
+    }
+    bitmap_set(fs_block_map, block, 1);
+    if(fs_block_refs[block] < FS_BLOCK_REFS_MAX)
+    {
+        fs_block_refs[block]++;
+    }
+}
+
+/* fs_claim_inode
+ * 	Description: Marks an inode used and claims each of its data
+ *  blocks, plus the block tables of an indirect inode or the stream of
+ *  a compressed one.
+ * 	Inputs: inode
+ * 	Outputs: None
+ * 	Side Effects: Changes fs_inode_map, fs_block_map and fs_block_refs.
+ */
+static void fs_claim_inode(uint32_t inode)
+{
+    uint32_t j, blocks;
+    inode_t* node = inode_addr + inode;
+    inode_indirect_t* indirect = (inode_indirect_t *)node;
+    inode_compressed_t* compressed = (inode_compressed_t *)node;
+
+    bitmap_set(fs_inode_map, inode, 1);
+
+    if(fs_layout(node) == INODE_LAYOUT_COMPRESSED)
+    {
+        for(j = 0; j < fs_stream_blocks(compressed) && j < fs_block_total; j++)
+        {
+            fs_claim_block(compressed->start + j);
+        }
+        return;
+    }
+
+    blocks = (node->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for(j = 0; j < blocks; j++)
+    {
+        fs_claim_block(fs_block_of(node, j));
+    }
+    if(fs_layout(node) == INODE_LAYOUT_INDIRECT)
+    {
+        for(j = 0; j < (blocks + BLOCKS_PER_INDIRECT - 1) / BLOCKS_PER_INDIRECT && j < INDIRECT_PER_INODE; j++)
+        {
+            fs_claim_block(indirect->blocks[j]);
+        }
+    }
+}
+
+/* fs_alloc_block
+ * 	Description: Takes a free data block from the bitmap and zeroes it.
+ *  A block on the data disk gets a buffer without being read first.
+ * 	Inputs: None
+ * 	Outputs: Return the block number, -1 if the filesystem is full or
+ *  the disk failed
+ * 	Side Effects: Marks the block used with one reference.
+ */
+static int32_t fs_alloc_block()
+{
+    int32_t block = bitmap_alloc(fs_block_map, FS_MAX_BLOCKS / BITMAP_WORD_BITS, &fs_block_hint);
+    uint8_t* data;
+
+    if(block == -1)
+    {
+        return -1;
+    }
+    data = fs_on_disk ? bcache_write(fs_disk_first + block) : (uint8_t *)fs_data_block(block);
+    if(data == NULL)
+    {
+        bitmap_set(fs_block_map, block, 0);
+        return -1;
+    }
+    memset(data, 0, BLOCK_SIZE);
+    fs_block_refs[block] = 1;
+    return block;
+}
+
+/* fs_block_release
+ * 	Description: Drops one reference to a data block and frees it when
+ *  no file uses it any more. Saturated counts are never freed.
+ * 	Inputs: block
+ * 	Outputs: None
+ * 	Side Effects: May free the block.
+ */
+static void fs_block_release(uint32_t block)
+{
+    if(block >= FS_MAX_BLOCKS || fs_block_refs[block] == FS_BLOCK_REFS_MAX)
+    {
+        return;
+    }
+    if(fs_block_refs[block] > 0)
+    {
+        fs_block_refs[block]--;
+    }
+    if(fs_block_refs[block] == 0)
+    {
+        bitmap_set(fs_block_map, block, 0);
+    }
+}
+
+/* fs_block_hold
+ * 	Description: Counts one more reference to a data block in use, for
+ *  a user page that points at it. A write to a file copies a held block
+ *  away instead of changing it, and unlink cannot free it.
+ * 	Inputs: block
+ * 	Outputs: Return 0, -1 if the block is not in use
+ * 	Side Effects: Changes fs_block_refs.
+ */
+int32_t fs_block_hold(uint32_t block)
+{
+    if(block >= FS_MAX_BLOCKS || !(fs_block_map[block / BITMAP_WORD_BITS] & (1 << (block % BITMAP_WORD_BITS))))
+    {
+        return -1;
+    }
+    fs_claim_block(block);
+    return 0;
+}
+
+/* fs_block_drop
+ * 	Description: Gives back a reference taken by fs_block_hold.
+ * 	Inputs: block
+ * 	Outputs: None
+ * 	Side Effects: Frees the block if no file uses it any more.
+ */
+void fs_block_drop(uint32_t block)
+{
+    fs_block_release(block);
+}
+
+/* fs_make_indirect
+ * 	Description: Rewrites a direct or extent inode as an indirect inode
+ *  so any block of it can be replaced. The old inode is copied to
+ *  fs_scratch first, since the new layout overwrites it in place.
+ * 	Inputs: inode pointer, keep (file blocks to carry over)
+ * 	Outputs: Return 0, -1 if the filesystem ran out of blocks
+ * 	Side Effects: Allocates block tables. The inode is unchanged on
+ *  failure.
+ */
+static int32_t fs_make_indirect(inode_t* inode, uint32_t keep)
+{
+    uint32_t i;
+    int32_t table;
+    inode_t* old = (inode_t *)&fs_scratch;
+    inode_indirect_t* indirect = (inode_indirect_t *)inode;
+
+    memcpy(old, inode, sizeof(inode_t));
+
+    indirect->layout = INODE_LAYOUT_INDIRECT;
+    for(i = 0; i < INDIRECT_PER_INODE; i++)
+    {
+        indirect->blocks[i] = FS_BAD_BLOCK;
+    }
+
+    /* Copy the block numbers into new tables, one table per BLOCKS_PER_INDIRECT */
+    for(i = 0; i < keep; i++)
+    {
+        if(i % BLOCKS_PER_INDIRECT == 0)
+        {
+            table = fs_alloc_block();
+            if(table == -1)
+            {
+                for(i = 0; i < INDIRECT_PER_INODE; i++)
+                {
+                    fs_block_release(indirect->blocks[i]);
+                }
+                memcpy(inode, old, sizeof(inode_t));
+                return -1;
+            }
+            indirect->blocks[i / BLOCKS_PER_INDIRECT] = table;
+        }
+        ((uint32_t *)fs_data_block(indirect->blocks[i / BLOCKS_PER_INDIRECT])->val)[i % BLOCKS_PER_INDIRECT] = fs_block_of(old, i);
+        fs_data_dirty(indirect->blocks[i / BLOCKS_PER_INDIRECT]);
+    }
+
+    return 0;
+}
+
+/* fs_bmap_set
+ * 	Description: Points a file block at a data block. A direct inode
+ *  that needs a block past its last slot, or an extent inode, becomes
+ *  an indirect inode first.
+ * 	Inputs: inode pointer, idx (file block), block
+ * 	Outputs: Return 0, -1 if the file is too large or the filesystem
+ *  ran out of blocks
+ * 	Side Effects: May allocate block tables and change the layout.
+ */
+static int32_t fs_bmap_set(inode_t* inode, uint32_t idx, uint32_t block)
+{
+    uint32_t layout = fs_layout(inode);
+    uint32_t keep = (inode->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    inode_indirect_t* indirect = (inode_indirect_t *)inode;
+    int32_t table;
+
+    if(layout == INODE_LAYOUT_DIRECT && idx < DATA_BLOCK_NUM_SIZE)
+    {
+        inode->data_block_num[idx] = block;
+        return 0;
+    }
+    if(idx / BLOCKS_PER_INDIRECT >= INDIRECT_PER_INODE)
+    {
+        return -1;
+    }
+
+    /* Blocks below idx may already be reserved past the old length */
+    if(layout != INODE_LAYOUT_INDIRECT && fs_make_indirect(inode, (idx > keep) ? idx : keep) == -1)
+    {
+        return -1;
+    }
+
+    if(indirect->blocks[idx / BLOCKS_PER_INDIRECT] == FS_BAD_BLOCK)
+    {
+        table = fs_alloc_block();
+        if(table == -1)
+        {
+            return -1;
+        }
+        indirect->blocks[idx / BLOCKS_PER_INDIRECT] = table;
+    }
+    ((uint32_t *)fs_data_block(indirect->blocks[idx / BLOCKS_PER_INDIRECT])->val)[idx % BLOCKS_PER_INDIRECT] = block;
+    fs_data_dirty(indirect->blocks[idx / BLOCKS_PER_INDIRECT]);
+    return 0;
+}
+
+/* fs_reserve
+ * 	Description: Makes sure the inode has data blocks up to a byte
+ *  offset. New blocks come from the bitmap and are zeroed.
+ * 	Inputs: inode pointer, end (byte offset the blocks must cover)
+ * 	Outputs: Return the byte offset the blocks cover, less than end if
+ *  the filesystem ran out of blocks
+ * 	Side Effects: Allocates blocks and stores them in the inode.
+ */
+static uint32_t fs_reserve(inode_t* inode, uint32_t end)
+{
+    uint32_t have = (inode->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t need = (end + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int32_t block;
+
+    for(; have < need; have++)
+    {
+        block = fs_alloc_block();
+        if(block == -1)
+        {
+            return have * BLOCK_SIZE;
+        }
+        if(fs_bmap_set(inode, have, block) == -1)
+        {
+            fs_block_release(block);
+            return have * BLOCK_SIZE;
+        }
+    }
+
+    return end;
+}
+
+/* fs_unshare
+ * 	Description: Gives the inode its own copy of every shared block
+ *  covering a byte range, so a write cannot show through another file.
+ * 	Inputs: inode pointer, start, end (byte offsets, end exclusive)
+ * 	Outputs: Return 0, -1 if the filesystem ran out of blocks
+ * 	Side Effects: Allocates and copies blocks, updating the inode.
+ */
+static int32_t fs_unshare(inode_t* inode, uint32_t start, uint32_t end)
+{
+    uint32_t idx, old;
+    int32_t block;
+
+    for(idx = start / BLOCK_SIZE; start < end && idx <= (end - 1) / BLOCK_SIZE; idx++)
+    {
+        old = fs_block_of(inode, idx);
+        if(old >= FS_MAX_BLOCKS || fs_block_refs[old] <= 1)
+        {
+            continue;
+        }
+
+        block = fs_alloc_block();
+        if(block == -1)
+        {
+            return -1;
+        }
+        memcpy(fs_data_block(block), fs_data_block(old), BLOCK_SIZE);
+        fs_data_dirty(block);
+        if(fs_bmap_set(inode, idx, block) == -1)
+        {
+            fs_block_release(block);
+            return -1;
+        }
+        fs_block_release(old);
+    }
+
+    return 0;
+}
+
+/* fs_inflate
+ * 	Description: Rewrites a compressed inode as a direct inode holding
+ *  the decoded blocks, so it can be written like any other file. The new
+ *  block numbers are gathered in fs_scratch until every block has been
+ *  decoded, then the stream is freed.
+ * 	Inputs: inode pointer
+ * 	Outputs: Return 0, -1 on a corrupt stream or a full filesystem
+ * 	Side Effects: Allocates blocks and drops the inode's cached blocks.
+ *  The inode is unchanged on failure.
+ */
+static int32_t fs_inflate(inode_t* inode)
+{
+    inode_compressed_t* node = (inode_compressed_t *)inode;
+    uint32_t blocks = (inode->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t i, span, start, count;
+    int32_t block;
+    uint32_t* list = (uint32_t *)fs_scratch.val;
+    uint8_t* src;
+
+    /* Decode every block into a block of its own, allocated first so src stays valid */
+    for(i = 0; i < blocks; i++)
+    {
+        block = fs_alloc_block();
+        span = (block == -1) ? 0 : fs_span(inode, i * BLOCK_SIZE, inode->length - i * BLOCK_SIZE, &src);
+        if(span == 0)
+        {
+            if(block != -1)
+            {
+                fs_block_release(block);
+            }
+            while(i > 0)
+            {
+                fs_block_release(list[--i]);
+            }
+            return -1;
+        }
+        memcpy(fs_data_block(block), src, span);
+        fs_data_dirty(block);
+        list[i] = block;
+    }
+
+    /* Free the stream, then store the new blocks over the compressed fields */
+    start = node->start;
+    count = fs_stream_blocks(node);
+    for(i = 0; i < count; i++)
+    {
+        fs_block_release(start + i);
+    }
+    inode->data_block_num[0] = 0;
+    for(i = 0; i < blocks; i++)
+    {
+        inode->data_block_num[i] = list[i];
+    }
+
+    zcache_invalidate(inode - inode_addr);
+    return 0;
+}
+
+/* fs_unreserve
+ * 	Description: Gives back the blocks fs_reserve stored past the end of
+ *  the file when the write that needed them fails. Their slots are
+ *  cleared as well, so the file is left as it was before the write.
+ * 	Inputs: inode pointer, end (byte offset fs_reserve covered)
+ * 	Outputs: None
+ * 	Side Effects: Frees blocks and block tables.
  */
-void filesystem_init(boot_block_t* boot_block)
+static void fs_unreserve(inode_t* inode, uint32_t end)
 {
-    /* Initialize pointers */
-    boot_block_addr = boot_block;
-    inode_addr = (inode_t *) (boot_block + 1);
-    data_addr = (data_t *) (boot_block + boot_block->inode_count + 1);
+    uint32_t i, length = inode->length;
+    uint32_t keep = (length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t blocks = (end + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    inode_indirect_t* indirect = (inode_indirect_t *)inode;
+    data_t* table;
+
+    if(blocks <= keep)
+    {
+        return;
+    }
+
+    /* fs_truncate frees everything past the length it is given */
+    inode->length = end;
+    fs_truncate(inode, length);
+
+    for(i = keep; i < blocks; i++)
+    {
+        if(fs_layout(inode) == INODE_LAYOUT_INDIRECT)
+        {
+            table = fs_data_block(indirect->blocks[i / BLOCKS_PER_INDIRECT]);
+            if(table != NULL)
+            {
+                ((uint32_t *)table->val)[i % BLOCKS_PER_INDIRECT] = 0;
+                fs_data_dirty(indirect->blocks[i / BLOCKS_PER_INDIRECT]);
+            }
+        }
+        else if(i > 0 && i < DATA_BLOCK_NUM_SIZE)
+        {
+            inode->data_block_num[i] = 0;
+        }
+    }
 }
 
-/* read_dentry_by_name
- * 	Description: Reads the dentry given a name.
- * 	Inputs: fname, dentry
- * 	Outputs: Return -1 on failure, 0 on success
- * 	Side Effects: Stores the dentry filetype and inode_num, given the 
- *  file name.
+/* write_data
+ * 	Description: Writes data into the inode. Blocks needed past the end
+ *  of the file are allocated first, a gap between the old end and the
+ *  offset is zero filled, then the data is copied one block run at a
+ *  time like read_data.
+ *  Inputs: inode, offset, buffer, length.
+ * 	Outputs: Return number of bytes written, -1 on failure or if a
+ *  process is running the file
+ * 	Side Effects: Changes the file data and may grow the file.
  */
-int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry)
+int32_t write_data(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length)
 {
-    /* Check if name length is invalid or if null and also check if dentry is null */
-    if(strlen((int8_t *)fname) > FILENAME_LEN || fname == NULL || dentry == NULL)
+    uint32_t span, end, start, done;
+    uint8_t* dst;
+    inode_t* cur_inode_ptr;
+
+    /* Only regular files in use can be written */
+    if(!fs_writable || buf == NULL || inode >= boot_block_addr->inode_count ||
+       inode >= FS_MAX_INODES || !(fs_inode_map[inode / BITMAP_WORD_BITS] & (1 << (inode % BITMAP_WORD_BITS))))
     {
         return -1;
     }
 
-    /* Loop through all the dentries and check for the file name */
-    int i;
-    for(i = 0; i < DENTRY_SIZE; i++)
+    /* A running program loads its pages from the file as they fault in */
+    if(vfs_running(VFS_IMAGE_MOUNT, inode))
+    {
+        return -1;
+    }
+
+    /* Files are limited to what the length field can hold */
+    if(offset > FS_MAX_FILE_SIZE)
+    {
+        return -1;
+    }
+    if(length > FS_MAX_FILE_SIZE - offset)
+    {
+        length = FS_MAX_FILE_SIZE - offset;
+    }
+
+    /* A compressed file is decoded into plain blocks on its first write */
+    cur_inode_ptr = inode_addr + inode;
+    if(fs_layout(cur_inode_ptr) == INODE_LAYOUT_COMPRESSED && fs_inflate(cur_inode_ptr) == -1)
+    {
+        return -1;
+    }
+
+    /* Allocate every block the write touches, trimming on a full disk */
+    end = fs_reserve(cur_inode_ptr, offset + length);
+    if(end <= offset)
+    {
+        fs_unreserve(cur_inode_ptr, end);
+        return (length == 0) ? 0 : -1;
+    }
+    length = end - offset;
+
+    /* Copy shared blocks the gap fill or the write would touch */
+    start = cur_inode_ptr->length;
+    if(fs_unshare(cur_inode_ptr, (start < offset) ? start : offset, offset + length) == -1)
+    {
+        fs_unreserve(cur_inode_ptr, end);
+        return -1;
+    }
+
+    /* Zero the gap between the old end of file and the offset */
+    while(start < offset)
     {
-        /* If file name found */
-        if(!strncmp((int8_t *) &(boot_block_addr->direntries[i]), (int8_t *)fname, FILENAME_LEN))
+        span = fs_span(cur_inode_ptr, start, offset - start, &dst);
+        if(span == 0)
         {
-            /* Copy over the file name, the file type, and the inode num */
-            memcpy((int8_t *)dentry->filename, (int8_t *)boot_block_addr->direntries[i].filename, FILENAME_LEN);
-            dentry->filetype = boot_block_addr->direntries[i].filetype;
-            dentry->inode_num = boot_block_addr->direntries[i].inode_num;
+            fs_unreserve(cur_inode_ptr, end);
+            return -1;
+        }
+        memset(dst, 0, span);
+        fs_file_dirty(cur_inode_ptr, start);
+        start += span;
+    }
 
-            /* Return 0 on success */
-            return 0;
+    /* Copy one run of consecutive data blocks per iteration */
+    for(done = 0; done < length; done += span)
+    {
+        span = fs_span(cur_inode_ptr, offset + done, length - done, &dst);
+        if(span == 0)
+        {
+            fs_unreserve(cur_inode_ptr, end);
+            return -1;
         }
+        memcpy(dst, buf + done, span);
+        fs_file_dirty(cur_inode_ptr, offset + done);
     }
 
-    /* Return -1 on failure */
-    return -1;
+    /* Grow the file and drop any cached executable image of it */
+    if(offset + length > cur_inode_ptr->length)
+    {
+        cur_inode_ptr->length = offset + length;
+    }
+    exec_cache_invalidate(inode);
+
+    return length;
 }
 
-/* read_dentry_by_index
- * 	Description: Reads the dentry given an index.
- * 	Inputs: index, dentry
- * 	Outputs: Return -1 on failure, 0 on success
- * 	Side Effects: Stores the dentry filetype and inode_num, given the 
- *  file index.
+/* fs_truncate
+ * 	Description: Shortens an inode, releasing the blocks past the new
+ *  end and the block tables an indirect inode no longer needs. An empty
+ *  inode goes back to the direct layout. A compressed inode frees its
+ *  whole stream when emptied and is decoded first otherwise.
+ * 	Inputs: inode pointer, length (the new length, at most the old one)
+ * 	Outputs: None
+ * 	Side Effects: Frees blocks and changes the inode length.
  */
-int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry)
+static void fs_truncate(inode_t* inode, uint32_t length)
 {
-    /* If an index is out of range or dentry is null, return -1 */
-    if(index > boot_block_addr->dir_count || dentry == NULL)
+    uint32_t i;
+    uint32_t keep = (length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t blocks = (inode->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    inode_indirect_t* indirect = (inode_indirect_t *)inode;
+    inode_compressed_t* compressed = (inode_compressed_t *)inode;
+
+    if(fs_layout(inode) == INODE_LAYOUT_COMPRESSED)
+    {
+        if(length > 0)
+        {
+            if(fs_inflate(inode) == -1)
+            {
+                return;
+            }
+        }
+        else
+        {
+            for(i = 0; i < fs_stream_blocks(compressed); i++)
+            {
+                fs_block_release(compressed->start + i);
+            }
+            zcache_invalidate(inode - inode_addr);
+            blocks = 0;
+        }
+    }
+
+    for(i = keep; i < blocks; i++)
+    {
+        fs_block_release(fs_block_of(inode, i));
+    }
+    if(fs_layout(inode) == INODE_LAYOUT_INDIRECT)
+    {
+        for(i = (keep + BLOCKS_PER_INDIRECT - 1) / BLOCKS_PER_INDIRECT; i < INDIRECT_PER_INODE; i++)
+        {
+            fs_block_release(indirect->blocks[i]);
+            indirect->blocks[i] = FS_BAD_BLOCK;
+        }
+    }
+    if(length == 0)
+    {
+        inode->data_block_num[0] = 0;
+    }
+    inode->length = length;
+}
+
+/* fs_link
+ * 	Description: Adds an entry for a new empty inode to a directory.
+ *  The root's entries go in the boot block, other directories grow by
+ *  one dentry through write_data.
+ * 	Inputs: dir (inode of the directory), name (not terminated),
+ *  length of the name, type (FILE_TYPE_REGULAR or FILE_TYPE_DIRECTORY)
+ * 	Outputs: Return the new inode number, -1 on failure
+ * 	Side Effects: Takes a free inode and the next free dentry.
+ */
+static int32_t fs_link(uint32_t dir, const uint8_t* name, uint32_t length, int32_t type)
+{
+    uint32_t count = fs_dir_count(dir);
+    int32_t inode;
+    dentry_t entry;
+
+    /* The name must be new, and the boot block has a fixed size */
+    if(length == 0 || length > FILENAME_LEN || dentry_hash_find(dir, name, length) != DENTRY_HASH_EMPTY ||
+       (dir == ROOT_DIR && count >= DENTRY_SIZE - 1))
     {
         return -1;
     }
-    
-    /* Otherwise, copy over the file name, file type, and the inode num */
-    memcpy((int8_t *)dentry->filename, (int8_t *)boot_block_addr->direntries[index].filename, FILENAME_LEN);
-    dentry->inode_num = boot_block_addr->direntries[index].inode_num;
-    dentry->filetype = boot_block_addr->direntries[index].filetype;
 
-    /* Return 0 on success */
-    return 0;
+    inode = bitmap_alloc(fs_inode_map, FS_MAX_INODES / BITMAP_WORD_BITS, &fs_inode_hint);
+    if(inode == -1)
+    {
+        return -1;
+    }
+    (inode_addr + inode)->length = 0;
+    (inode_addr + inode)->data_block_num[0] = 0;
+
+    memset(&entry, 0, sizeof(dentry_t));
+    memcpy(entry.filename, name, length);
+    entry.filetype = type;
+    entry.inode_num = inode;
+
+    /* Store the dentry at the end of the directory and index it */
+    if(dir == ROOT_DIR)
+    {
+        boot_block_addr->direntries[count] = entry;
+        boot_block_addr->dir_count++;
+    }
+    else if(write_data(dir, count * sizeof(dentry_t), (uint8_t *)&entry, sizeof(dentry_t)) != sizeof(dentry_t))
+    {
+        bitmap_set(fs_inode_map, inode, 0);
+        return -1;
+    }
+    dentry_hash_insert(dir, count);
+
+    return inode;
 }
 
-/* read_data
- * 	Description: Reads the data inside the inode
- *  Inputs: inode, offset, buffer, length.
- * 	Outputs: Return number of bytes read
- * 	Side Effects: Stores the data inside the buffer, given an inode.
+/* fs_make
+ * 	Description: Creates an empty file or directory at a path.
+ * 	Inputs: dir (where relative paths start), fname (not necessarily
+ *  terminated), length of the path, type
+ * 	Outputs: Return the new inode number, -1 on failure
+ * 	Side Effects: Takes a free inode and the next free dentry of the
+ *  parent directory.
  */
-int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+static int32_t fs_make(uint32_t dir, const uint8_t* fname, uint32_t length, int32_t type)
 {
-    /* If inode is greater the inode count in the boot block or if the buffer is empty, return -1 */
-    if(inode > boot_block_addr->inode_count || buf == NULL)
+    uint8_t path[PATH_MAX_LEN + 1];
+    const uint8_t* name;
+    uint32_t name_len;
+    int32_t parent;
+
+    if(!fs_writable || fname == NULL || length == 0 || length > PATH_MAX_LEN)
     {
         return -1;
     }
 
-    /* Intialize variables */
-    int i, data, idx;
-    int read_counter = 0;
-    int cur_pos = offset;
-    data_t* cur_data_block_ptr;
-    inode_t* cur_inode_ptr = (inode_t *) (inode + inode_addr);
+    /* Terminated copy of the path, then find the parent directory */
+    memset(path, 0, PATH_MAX_LEN + 1);
+    memcpy(path, fname, length);
+    parent = fs_walk(dir, path, &name, &name_len);
+    if(parent == -1)
+    {
+        return -1;
+    }
+
+    return fs_link(parent, name, name_len, type);
+}
+
+/* fs_create
+ * 	Description: Creates an empty regular file. The name may be a path
+ *  from the root.
+ * 	Inputs: fname (not necessarily terminated), length of the name
+ * 	Outputs: Return the new inode number, -1 on failure
+ * 	Side Effects: Takes a free inode and the next free dentry.
+ */
+int32_t fs_create(const uint8_t* fname, uint32_t length)
+{
+    return fs_make(ROOT_DIR, fname, length, FILE_TYPE_REGULAR);
+}
+
+/* fs_mkdir
+ * 	Description: Creates an empty directory. The name may be a path
+ *  from the root.
+ * 	Inputs: fname (not necessarily terminated), length of the name
+ * 	Outputs: Return the new inode number, -1 on failure
+ * 	Side Effects: Takes a free inode and the next free dentry.
+ */
+int32_t fs_mkdir(const uint8_t* fname, uint32_t length)
+{
+    return fs_make(ROOT_DIR, fname, length, FILE_TYPE_DIRECTORY);
+}
+
+/* fs_unlink
+ * 	Description: Removes a regular file or an empty directory. Its inode
+ *  and the blocks no other file shares go back to the bitmaps, and the
+ *  last dentry of the parent moves into the freed slot so the dentries
+ *  stay packed for directory_read.
+ * 	Inputs: fname (may be a path)
+ * 	Outputs: Return 0 on success, -1 on failure
+ * 	Side Effects: Frees the file's blocks, inode and dentry.
+ */
+int32_t fs_unlink(const uint8_t* fname)
+{
+    const uint8_t* name;
+    uint32_t name_len, inode;
+    int32_t dir, index, last;
+    dentry_t* dentry;
+    dentry_t moved;
+    inode_t* parent;
+
+    if(!fs_writable || fname == NULL || strlen((int8_t *)fname) > PATH_MAX_LEN)
+    {
+        return -1;
+    }
+
+    dir = fs_walk(ROOT_DIR, fname, &name, &name_len);
+    if(dir == -1)
+    {
+        return -1;
+    }
+    index = dentry_hash_find(dir, name, name_len);
+    if(index == DENTRY_HASH_EMPTY)
+    {
+        return -1;
+    }
+
+    /* Only regular files and empty directories other than the root */
+    dentry = fs_dir_entry(dir, index);
+    inode = dentry->inode_num;
+    if(dentry->filetype == FILE_TYPE_DIRECTORY)
+    {
+        if(inode == ROOT_DIR || inode >= boot_block_addr->inode_count || fs_dir_count(inode) != 0)
+        {
+            return -1;
+        }
+    }
+    else if(dentry->filetype != FILE_TYPE_REGULAR)
+    {
+        return -1;
+    }
 
-    /* Loop through length */
-    for(i = 0; i < length; i++)
+    /* The parent's block is about to change, so it must not be shared */
+    if(dir != ROOT_DIR)
     {
-        /* If the length of the data is greater than the offset + read_counter, then we can copy over the data */
-        if(cur_inode_ptr->length >= offset + read_counter)
+        parent = inode_addr + dir;
+        if(fs_unshare(parent, index * sizeof(dentry_t), (index + 1) * sizeof(dentry_t)) == -1)
         {
-            idx = cur_pos / BLOCK_SIZE;
-            data = cur_pos % BLOCK_SIZE;
-            /* Get the data block pointer and copy the value to the buffer */
-            cur_data_block_ptr = (data_t *)(data_addr + cur_inode_ptr->data_block_num[idx]);
-            buf[i] = cur_data_block_ptr->val[data];
+            return -1;
+        }
+    }
+
+    /* Release the data blocks and the inode */
+    fs_truncate(inode_addr + inode, 0);
+    if(inode < FS_MAX_INODES)
+    {
+        bitmap_set(fs_inode_map, inode, 0);
+    }
+    exec_cache_invalidate(inode);
+    zcache_invalidate(inode);
 
-            /* Increment current position and also the number of bytes read */
-            cur_pos++;
-            read_counter++;
+    /* Take the dentry out of the index, then fill its slot with the last one */
+    dentry_hash_remove(dir, index);
+    last = fs_dir_count(dir) - 1;
+    if(index != last)
+    {
+        dentry_hash_remove(dir, last);
+        moved = *fs_dir_entry(dir, last);
+        *fs_dir_entry(dir, index) = moved;
+        if(dir != ROOT_DIR)
+        {
+            fs_file_dirty(inode_addr + dir, index * sizeof(dentry_t));
         }
+        dentry_hash_insert(dir, index);
     }
 
-    /* Return number of bytes read */
-    return read_counter;
+    /* Shrink the directory by one dentry */
+    if(dir == ROOT_DIR)
+    {
+        memset(&(boot_block_addr->direntries[last]), 0, sizeof(dentry_t));
+        boot_block_addr->dir_count--;
+    }
+    else
+    {
+        fs_truncate(inode_addr + dir, last * sizeof(dentry_t));
+    }
 
+    /* Paths looked up before may now name nothing */
+    fs_generation++;
+
+    return 0;
 }
 
 /* file_open
- * 	Description: Opens the file but since we only have a read only system,
- *  it does nothing.
+ * 	Description: Opens the file. Files keep no per-open state, so it
+ *  does nothing.
  * 	Inputs: None
  * 	Outputs: Return 0
  * 	Side Effects: None
@@ -135,8 +1915,8 @@ int32_t file_open(const uint8_t* filename)
 }
 
 /* file_close
- * 	Description: Closes the file but since we only have a read only system,
- *  it does nothing.
+ * 	Description: Closes the file. Files keep no per-open state, so it
+ *  does nothing.
  * 	Inputs: None
  * 	Outputs: Return 0
  * 	Side Effects: None
@@ -146,16 +1926,52 @@ int32_t file_close(int32_t fd)
     return 0;
 }
 
+/* file_stat
+ * 	Description: Reports the type, length and block count of a file.
+ * 	Inputs: inode, buf
+ * 	Outputs: Return 0, -1 on a bad inode
+ * 	Side Effects: Fills buf
+ */
+int32_t file_stat(uint32_t inode, stat_t* buf)
+{
+    if(inode >= boot_block_addr->inode_count)
+    {
+        return -1;
+    }
+
+    buf->filetype = STAT_TYPE_REGULAR;
+    buf->inode = inode;
+    buf->size = (inode_addr + inode)->length;
+    buf->blocks = (buf->size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    return 0;
+}
+
 /* file_write
- * 	Description: Writes to the file but since we only have a read only system,
- *  it does nothing.
- * 	Inputs: None
- * 	Outputs: Return -1
- * 	Side Effects: None
+ * 	Description: Writes to the file at the descriptor's position.
+ *  Writing at the end of the file appends to it, writing before the
+ *  end overwrites.
+ * 	Inputs: fd, buf, nbytes
+ * 	Outputs: Return number of bytes written, -1 on failure
+ * 	Side Effects: Changes the file and advances the file position.
  */
 int32_t file_write(int32_t fd, const void* buf, int32_t nbytes)
 {
-    return -1;
+    int32_t ret;
+    file_descriptor_t* file;
+
+    if(pcb_current == NULL || nbytes < 0)
+    {
+        return -1;
+    }
+
+    file = pcb_current->pcb_arr[fd];
+    ret = write_data(file->inode, file->file_position, (const uint8_t *)buf, (uint32_t)nbytes);
+    if(ret > 0)
+    {
+        file->file_position += ret;
+    }
+
+    return ret;
 }
 
 /* file_read
@@ -170,8 +1986,8 @@ int32_t file_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length
 }
 
 /* directory_open
- * 	Description: Opens the file but since we only have a read only system,
- *  it does nothing.
+ * 	Description: Opens the file. Files keep no per-open state, so it
+ *  does nothing.
  * 	Inputs: None
  * 	Outputs: Return 0
  * 	Side Effects: None
@@ -182,8 +1998,8 @@ int32_t directory_open(const uint8_t* filename)
 }
 
 /* directory_close
- * 	Description: Closes the file but since we only have a read only system,
- *  it does nothing.
+ * 	Description: Closes the file. Files keep no per-open state, so it
+ *  does nothing.
  * 	Inputs: None
  * 	Outputs: Return 0
  * 	Side Effects: None
@@ -193,40 +2009,117 @@ int32_t directory_close(int32_t fd)
     return 0;
 }
 
-/* directory_write
- * 	Description: Writes to the file but since we only have a read only system,
- *  it does nothing.
- * 	Inputs: None
+/* directory_stat
+ * 	Description: Reports the directory type. Its size is the bytes
+ *  directory_read returns for the whole listing. The root's only
+ *  block is the boot block, other directories count their data blocks.
+ * 	Inputs: inode, buf
  * 	Outputs: Return 0
- * 	Side Effects: None
+ * 	Side Effects: Fills buf
+ */
+int32_t directory_stat(uint32_t inode, stat_t* buf)
+{
+    buf->filetype = STAT_TYPE_DIRECTORY;
+    buf->inode = inode;
+    buf->size = fs_dir_count(inode) * FILENAME_LEN;
+    buf->blocks = 1;
+    if(inode != ROOT_DIR && inode < boot_block_addr->inode_count)
+    {
+        buf->blocks = ((inode_addr + inode)->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+    return 0;
+}
+
+/* directory_write
+ * 	Description: Writing a name to the directory creates an empty
+ *  regular file with that name, or an empty directory when the name
+ *  ends in '/'. The name may be a path relative to the directory.
+ * 	Inputs: fd, buf (the name), nbytes (length of the name)
+ * 	Outputs: Return nbytes on success, -1 on failure
+ * 	Side Effects: Adds a dentry to the directory.
  */
 int32_t directory_write(int32_t fd, const void* buf, int32_t nbytes)
 {
-    return -1;
+    uint32_t dir = ROOT_DIR;
+    int32_t type = FILE_TYPE_REGULAR;
+
+    if(nbytes <= 0 || buf == NULL)
+    {
+        return -1;
+    }
+    if(pcb_current != NULL)
+    {
+        dir = pcb_current->pcb_arr[fd]->inode;
+    }
+    if(((const uint8_t *)buf)[nbytes - 1] == PATH_SEPARATOR)
+    {
+        type = FILE_TYPE_DIRECTORY;
+    }
+
+    if(fs_make(dir, (const uint8_t *)buf, (uint32_t)nbytes, type) == -1)
+    {
+        return -1;
+    }
+
+    return nbytes;
 }
 
 /* directory_read
- * 	Description: Reads the directory given an inode.
+ * 	Description: Reads the directory given an inode, one file name per
+ *  FILENAME_LEN bytes.
  *  Inputs: inode, offset, buffer, length.
  * 	Outputs: Return number of bytes read.
  * 	Side Effects: Stores the data read inside the buffer.
  */
 int32_t directory_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
 {
-    int i, data, idx;
-    int cur_pos = offset;
-    idx = cur_pos / FILENAME_LEN;
+    uint32_t done = 0;
+    uint32_t span, data;
+    dentry_t* dentry;
 
-    /* Loop through the length and also make sure to stay within the directory count */
-    for(i = 0; i < length && idx < boot_block_addr->dir_count; i++)
+    /* Copy the rest of one name per iteration until the directory ends */
+    while(done < length)
     {
-        idx = cur_pos / FILENAME_LEN;
-        data = cur_pos % FILENAME_LEN;
-        /* Copy over the directory name */
-        buf[i] = boot_block_addr->direntries[idx].filename[data];
-        cur_pos++;
+        dentry = fs_dir_entry(inode, offset / FILENAME_LEN);
+        if(dentry == NULL)
+        {
+            break;
+        }
+        data = offset % FILENAME_LEN;
+        span = FILENAME_LEN - data;
+        if(span > length - done)
+        {
+            span = length - done;
+        }
+        memcpy(buf + done, (uint8_t *)dentry->filename + data, span);
+        done += span;
+        offset += span;
     }
 
     /* Return number of bytes read */
+    return done;
+}
+
+/* directory_getdents
+ * 	Description: Fills records for the directory entries starting at an
+ *  index. Sizes are only reported for regular files.
+ *  Inputs: dir (inode of the directory), index, buffer, count (records
+ *  that fit in the buffer).
+ * 	Outputs: Return number of records filled.
+ * 	Side Effects: Stores the records inside the buffer.
+ */
+int32_t directory_getdents(uint32_t dir, uint32_t index, dirent_t* buf, uint32_t count)
+{
+    int i;
+    dentry_t* dentry;
+
+    for(i = 0; i < count && (dentry = fs_dir_entry(dir, index + i)) != NULL; i++)
+    {
+        memcpy(buf[i].name, dentry->filename, FILENAME_LEN);
+        buf[i].filetype = dentry->filetype;
+        buf[i].inode = dentry->inode_num;
+        buf[i].size = (dentry->filetype == FILE_TYPE_REGULAR) ? (inode_addr + dentry->inode_num)->length : 0;
+    }
+
     return i;
 }
@@ -7,6 +7,7 @@
  * i.e. file data, directory name, file name, file type, file size, etc.
  */
 #include "lib.h"
+#include "stat.h"
 
 /* Magic numbers */
 #define FILENAME_LEN 32
@@ -15,6 +16,37 @@
 #define DATA_BLOCK_NUM_SIZE 1023
 #define RESERVED_DENTRY 24
 #define RESERVED_BOOT_BLOCK 52
+#define DENTRY_HASH_SIZE 8192
+#define DENTRY_HASH_EMPTY -1
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+#define FILE_TYPE_RTC 0
+#define FILE_TYPE_DIRECTORY 1
+#define FILE_TYPE_REGULAR 2
+#define FS_EXTRA_BLOCKS 128
+#define FS_MAX_BLOCKS 8192
+#define FS_MAX_INODES 4096
+#define BITMAP_WORD_BITS 32
+#define BITMAP_FULL 0xFFFFFFFF
+#define FS_BLOCK_REFS_MAX 255
+#define FS_WRITABLE_DEFAULT 1
+#define ROOT_DIR 0
+#define DENTRIES_PER_BLOCK (BLOCK_SIZE / sizeof(dentry_t))
+#define FS_MAX_DEPTH 16
+#define PATH_MAX_LEN 128
+#define PATH_SEPARATOR '/'
+#define INODE_LAYOUT_DIRECT 0
+#define INODE_LAYOUT_EXTENT 0xFFFFFFFE
+#define INODE_LAYOUT_INDIRECT 0xFFFFFFFD
+#define INODE_LAYOUT_COMPRESSED 0xFFFFFFFC
+#define EXTENTS_PER_INODE 340
+#define INDIRECT_PER_INODE 1022
+#define BLOCKS_PER_INDIRECT 1024
+#define COMPRESSED_PER_INODE 1019
+#define FS_MAX_FILE_SIZE 0x7FFFF000
+#define FS_BAD_BLOCK 0xFFFFFFFF
+#define FS_DISK_MAX_INODES 64
+#define FS_DISK_HEADER_BLOCKS (FS_DISK_MAX_INODES + 1)
 
 /* Structure definitions taken from lecture */
 
@@ -44,6 +76,61 @@ typedef struct inode
     int32_t data_block_num[DATA_BLOCK_NUM_SIZE];
 } inode_t;
 
+/* 
+ * Run of consecutive data blocks holding file blocks first to
+ * first + count - 1.
+ */
+typedef struct extent
+{
+    uint32_t first;
+    uint32_t start;
+    uint32_t count;
+} extent_t;
+
+/* 
+ * Extent inode, written by the image builder for large or contiguous
+ * files. The slot of the first direct block number holds
+ * INODE_LAYOUT_EXTENT, which is never a valid block number, and the
+ * extents are sorted by first.
+ */
+typedef struct inode_extent
+{
+    int32_t length;
+    uint32_t layout;
+    uint32_t count;
+    extent_t extents[EXTENTS_PER_INODE];
+} inode_extent_t;
+
+/* 
+ * Indirect inode, the fallback for files with too many blocks for the
+ * direct inode and too many runs for the extent inode. Each entry is a
+ * data block holding BLOCKS_PER_INDIRECT block numbers, FS_BAD_BLOCK
+ * when unused.
+ */
+typedef struct inode_indirect
+{
+    int32_t length;
+    uint32_t layout;
+    uint32_t blocks[INDIRECT_PER_INODE];
+} inode_indirect_t;
+
+/* 
+ * Compressed inode, written by the image builder. The file's blocks are
+ * compressed one at a time and stored back to back in a stream filling
+ * consecutive data blocks from start. Block i is the stream bytes from
+ * offsets[i] to offsets[i + 1]; a block that did not shrink is stored
+ * as it is. The file is read only through the decompressed-block cache
+ * and turned back into a direct inode on its first write.
+ */
+typedef struct inode_compressed
+{
+    int32_t length;
+    uint32_t layout;
+    uint32_t start;
+    uint32_t size;
+    uint32_t offsets[COMPRESSED_PER_INODE + 1];
+} inode_compressed_t;
+
 /* 
  * Data structure (not referenced in lecture but needed
  * to index data correctly. There is 4096 values in the data block
@@ -54,6 +141,31 @@ typedef struct data
     int8_t val[BLOCK_SIZE];
 } data_t;
 
+/* 
+ * Slot of the dentry name index. Entries of every directory share the
+ * table, keyed by the directory's inode and the name. The full hash is
+ * kept next to the dentry position so probes only compare names on a
+ * hash match.
+ */
+typedef struct dentry_hash_slot
+{
+    uint32_t hash;
+    int32_t dir;
+    int32_t index;
+} dentry_hash_slot_t;
+
+/* 
+ * Record filled in by getdents, one per directory entry. The name is
+ * not NUL terminated when it uses all FILENAME_LEN bytes.
+ */
+typedef struct dirent
+{
+    uint8_t name[FILENAME_LEN];
+    uint32_t filetype;
+    uint32_t inode;
+    uint32_t size;
+} dirent_t;
+
 /* 
  * Define variables to store the beginning address for the
  * boot block, inode block, and data block.
@@ -62,38 +174,99 @@ boot_block_t* boot_block_addr;
 inode_t* inode_addr;
 data_t* data_addr;
 
+/* Open-addressing index over the dentry names of every directory */
+dentry_hash_slot_t dentry_hash[DENTRY_HASH_SIZE];
+
+/* Set when file_write, directory_write and fs_unlink may modify the image */
+int32_t fs_writable;
+
+/* Set when the filesystem was mounted from the data disk */
+int32_t fs_on_disk;
+
+/* Bumped whenever a name is removed or the image is replaced */
+uint32_t fs_generation;
+
 /* Init file system */
 void filesystem_init(boot_block_t* boot_block);
 
-/* Read the dentry by name */
+/* Mount the filesystem image on the data disk in place of the module */
+int32_t fs_mount_disk();
+
+/* Write the header and every changed block back to the data disk */
+int32_t fs_sync();
+
+/* Hash a name of at most FILENAME_LEN bytes inside a directory */
+uint32_t filename_hash(uint32_t dir, const uint8_t* fname, uint32_t length);
+
+/* Read the dentry by name, following '/' separated paths */
 int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry);
 
-/* Read the dentry by index */
+/* Read the dentry by index in the root directory */
 int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry);
 
+/* Number of entries in a directory */
+uint32_t fs_dir_count(uint32_t dir);
+
 /* Read the data inside the inode */
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
 
+/* Hand the data inside the inode to a write function without copying it */
+int32_t send_data(uint32_t inode, uint32_t offset, uint32_t length,
+                  int32_t (* write)(int32_t fd, const void* buf, int32_t nbytes), int32_t fd);
+
+/* Write data into the inode, growing the file as needed */
+int32_t write_data(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length);
+
+/* Get the address of a data block, NULL if out of range */
+data_t* fs_data_block(uint32_t block);
+
+/* Get the data block holding a block of a file, -1 if there is none */
+int32_t fs_bmap(uint32_t inode, uint32_t index);
+
+/* Keep a data block from being changed or freed while a page maps it */
+int32_t fs_block_hold(uint32_t block);
+
+/* Give back a reference taken by fs_block_hold */
+void fs_block_drop(uint32_t block);
+
+/* Create an empty regular file, the name may be a path */
+int32_t fs_create(const uint8_t* fname, uint32_t length);
+
+/* Create an empty directory, the name may be a path */
+int32_t fs_mkdir(const uint8_t* fname, uint32_t length);
+
+/* Remove a regular file or an empty directory and free its blocks */
+int32_t fs_unlink(const uint8_t* fname);
+
 /* Does nothing but still returns a value */
 int32_t file_open(const uint8_t* filename);
 
 /* Does nothing but still returns a value */
 int32_t file_close(int32_t fd);
 
-/* Does nothing but still returns a value */
+/* Write to the file at the descriptor's position */
 int32_t file_write(int32_t fd, const void* buf, int32_t nbytes);
 
 /* Read the data inside the inode and store it in a buffer */
 int32_t file_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
 
+/* Report the type, length and blocks of a file */
+int32_t file_stat(uint32_t inode, stat_t* buf);
+
 /* Does nothing but still returns a value */
 int32_t directory_open(const uint8_t* filename);
 
 /* Does nothing but still returns a value */
 int32_t directory_close(int32_t fd);
 
-/* Does nothing but still returns a value */
+/* Create a file or directory named by the buffer */
 int32_t directory_write(int32_t fd, const void* buf, int32_t nbytes);
 
 /* Read the directory data and store it in a buffer */
 int32_t directory_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+
+/* Report the directory type and the size of its name listing */
+int32_t directory_stat(uint32_t inode, stat_t* buf);
+
+/* Fill records for the directory entries starting at an index */
+int32_t directory_getdents(uint32_t dir, uint32_t index, dirent_t* buf, uint32_t count);
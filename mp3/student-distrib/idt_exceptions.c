@@ -14,6 +14,7 @@
 #include "rtc.h"
 #include "syscall.h"
 #include "scheduler.h"
+#include "ata.h"
 
 /* 
  * This is the handler table. It will be called upon when
@@ -22,11 +23,15 @@
 */
 void (*handler_table[NUM_VEC])();
 
+/* Times do_irq dispatched each vector, read through /proc/irq */
+uint32_t irq_counts[NUM_VEC];
+
 /* These are the linkage file functions. For more details check link.S */
 extern void rtc();
 extern void keyboard();
 extern void sysc();
 extern void pit();
+extern void ata();
 
 /* array size is 32 since there are 0-31 intel defined interrupts */
 extern void * linkage_array[interruptCount];
@@ -82,6 +87,7 @@ void idt_init()
       SET_IDT_ENTRY(idt[rtcHex], &rtc);                     //rtc (0x28)
       SET_IDT_ENTRY(idt[syscallHex], &sysc);                //syscall (0x80)
       SET_IDT_ENTRY(idt[pitHex], &pit);
+      SET_IDT_ENTRY(idt[ataHex], &ata);                     //primary ATA channel (0x2E)
 
       /* filling up the handler table */
       handler_table[0] = exception_0;
@@ -121,6 +127,7 @@ void idt_init()
       handler_table[keyboardHex] = keyboard_inter_handler;
       handler_table[rtcHex] = rtc_interrupt_handler;
       handler_table[pitHex] = pit_interrupt_handler;
+      handler_table[ataHex] = ata_interrupt_handler;
 }
 
 /* 
@@ -141,7 +148,8 @@ void do_irq(unsigned long EBX,
             unsigned long EAX,
             unsigned long vector_num)
 {
-      /* use the jump table */
+      /* count it, then use the jump table */
+      irq_counts[vector_num]++;
       handler_table[vector_num]();
 }
 
@@ -259,6 +267,27 @@ extern void exception_14()
       while(1);
 }
 
+/* 
+ *  page_fault_handler
+ *   DESCRIPTION: Called by the page fault linkage. A page of the user
+ *                window that is not present yet is filled in and the
+ *                access retried; anything else is reported as before.
+ *   INPUTS: addr (from cr2), error (the code the processor pushed)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: Counts the fault for /proc/irq
+ */
+extern void page_fault_handler(uint32_t addr, uint32_t error)
+{
+      irq_counts[pageFaultVec]++;
+
+      if(!(error & pageFaultPresent) && page_fault_load(addr) == 0)
+      {
+            return;
+      }
+      exception_14();
+}
+
 extern void exception_15()
 {
       clear();
@@ -18,8 +18,14 @@
 #define keyboardHex 0x21
 #define rtcHex 0x28
 #define pitHex 0x20
+#define ataHex 0x2E
+#define pageFaultVec 14
+#define pageFaultPresent 0x1     // error code bit: the page was present
 
 
+/* Times do_irq dispatched each vector */
+extern uint32_t irq_counts[];
+
 /* IDT initalizing function */
 void idt_init();
 
@@ -56,6 +62,9 @@ extern void exception_13();
 
 extern void exception_14();
 
+/* Page fault entry from the linkage, with the address and error code */
+extern void page_fault_handler(uint32_t addr, uint32_t error);
+
 extern void exception_15();
 
 extern void exception_16();
@@ -15,6 +15,10 @@
 #include "filesystem.h"
 #include "scheduler.h"
 #include "syscall.h"
+#include "ata.h"
+#include "vfs.h"
+#include "process.h"
+#include "buddy.h"
 
 extern int32_t execute(const uint8_t* command);
 
@@ -22,6 +26,33 @@ extern int32_t execute(const uint8_t* command);
 /* Check if the bit BIT in FLAGS is set. */
 #define CHECK_FLAG(flags, bit)   ((flags) & (1 << (bit)))
 
+/* Memory map type of usable RAM, and where mem_upper counts from */
+#define MMAP_TYPE_RAM   1
+#define MEM_UPPER_BASE  0x100000
+#define MEM_KB          1024
+#define MEM_DEFAULT_TOP 0x2000000   /* assumed when the loader reports no memory */
+
+/* Give [START, END) to the frame allocator, less every boot module in it.
+   The filesystem image is used in place, so its pages must never be
+   handed out, even when it reaches past BUDDY_BASE. */
+static void add_usable_range(multiboot_info_t *mbi, uint32_t start, uint32_t end) {
+    module_t *mod;
+    uint32_t i;
+
+    if (end <= start)
+        return;
+    if (CHECK_FLAG(mbi->flags, 3)) {
+        for (i = 0, mod = (module_t *)mbi->mods_addr; i < mbi->mods_count; i++, mod++) {
+            if (mod->mod_start < end && mod->mod_end > start) {
+                add_usable_range(mbi, start, mod->mod_start);
+                add_usable_range(mbi, mod->mod_end, end);
+                return;
+            }
+        }
+    }
+    buddy_add_range(start, end);
+}
+
 /* Check if MAGIC is valid and print the Multiboot information structure
    pointed by ADDR. */
 void entry(unsigned long magic, unsigned long addr) {
@@ -106,6 +137,27 @@ void entry(unsigned long magic, unsigned long addr) {
                     (unsigned)mmap->length_low);
     }
 
+    /* Give the usable memory to the frame allocator while the loader's tables are still mapped */
+    buddy_init();
+    if (CHECK_FLAG(mbi->flags, 6)) {
+        memory_map_t *mmap;
+        uint32_t end;
+        for (mmap = (memory_map_t *)mbi->mmap_addr;
+                (unsigned long)mmap < mbi->mmap_addr + mbi->mmap_length;
+                mmap = (memory_map_t *)((unsigned long)mmap + mmap->size + sizeof (mmap->size))) {
+            if (mmap->type != MMAP_TYPE_RAM || mmap->base_addr_high != 0)
+                continue;
+            end = mmap->base_addr_low + mmap->length_low;
+            if (mmap->length_high != 0 || end < mmap->base_addr_low)
+                end = BUDDY_LIMIT;
+            add_usable_range(mbi, mmap->base_addr_low, end);
+        }
+    } else if (CHECK_FLAG(mbi->flags, 0)) {
+        add_usable_range(mbi, MEM_UPPER_BASE, MEM_UPPER_BASE + mbi->mem_upper * MEM_KB);
+    } else {
+        add_usable_range(mbi, BUDDY_BASE, MEM_DEFAULT_TOP);
+    }
+
     /* Construct an LDT entry in the GDT */
     {
         seg_desc_t the_ldt_desc;
@@ -163,12 +215,24 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Initialize paging */
     paging_initialize();
 
+    /* Set up the process table */
+    proc_init();
+
     /* initialize terminal */
     init_terminal();
 
     /* Initialize PIT */
     pit_init();
 
+    /* Mount the data disk in place of the module if it holds an image */
+    if(ata_init() == 0)
+    {
+        fs_mount_disk();
+    }
+
+    /* Mount the image, the devices, /tmp and /proc */
+    vfs_init();
+
 
 #ifdef RUN_TESTS
     /* Run tests */
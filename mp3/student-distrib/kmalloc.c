@@ -0,0 +1,271 @@
+#include "types.h"
+#include "lib.h"
+#include "buddy.h"
+#include "kmalloc.h"
+
+kmem_large_stats_t kmem_large_stats;
+kmem_cache_t* kmem_caches = NULL;
+
+/* The general caches behind kmalloc, smallest first */
+static kmem_cache_t kmalloc_caches[KMEM_CLASSES] =
+{
+    KMEM_CACHE("kmalloc-16", 16),
+    KMEM_CACHE("kmalloc-32", 32),
+    KMEM_CACHE("kmalloc-64", 64),
+    KMEM_CACHE("kmalloc-128", 128),
+    KMEM_CACHE("kmalloc-256", 256),
+    KMEM_CACHE("kmalloc-512", 512),
+    KMEM_CACHE("kmalloc-1024", 1024),
+};
+
+/* Objects start this far into a slab */
+#define KMEM_SLAB_HEADER    ((sizeof(kmem_slab_t) + KMEM_ALIGN - 1) & ~(KMEM_ALIGN - 1))
+#define KMEM_LARGE_HEADER   ((sizeof(kmem_large_t) + KMEM_ALIGN - 1) & ~(KMEM_ALIGN - 1))
+
+/* kmem_link
+ * 	Description: Puts a slab at the head of its cache's partial list.
+ * 	Inputs: cache, slab
+ * 	Outputs: None
+ * 	Side Effects: None
+ */
+static void kmem_link(kmem_cache_t* cache, kmem_slab_t* slab)
+{
+    slab->prev = NULL;
+    slab->next = cache->partial;
+    if(cache->partial != NULL)
+    {
+        cache->partial->prev = slab;
+    }
+    cache->partial = slab;
+}
+
+/* kmem_unlink
+ * 	Description: Takes a slab off its cache's partial list.
+ * 	Inputs: cache, slab
+ * 	Outputs: None
+ * 	Side Effects: None
+ */
+static void kmem_unlink(kmem_cache_t* cache, kmem_slab_t* slab)
+{
+    if(slab->prev != NULL)
+    {
+        slab->prev->next = slab->next;
+    }
+    else
+    {
+        cache->partial = slab->next;
+    }
+    if(slab->next != NULL)
+    {
+        slab->next->prev = slab->prev;
+    }
+    slab->next = NULL;
+    slab->prev = NULL;
+}
+
+/* kmem_grow
+ * 	Description: Takes a page from the frame allocator and cuts it into
+ *  free objects. The first time a cache grows it works out its object
+ *  layout and joins kmem_caches.
+ * 	Inputs: cache
+ * 	Outputs: Return 0 on success, -1 if memory ran out or the objects
+ *  do not fit in a slab
+ * 	Side Effects: Adds the slab to the partial list.
+ */
+static int32_t kmem_grow(kmem_cache_t* cache)
+{
+    kmem_slab_t* slab;
+    uint8_t* obj;
+    uint32_t i;
+
+    if(cache->stride == 0)
+    {
+        cache->stride = (cache->size + KMEM_ALIGN - 1) & ~(KMEM_ALIGN - 1);
+        if(cache->stride < sizeof(void*))
+        {
+            cache->stride = sizeof(void*);
+        }
+        cache->per_slab = (KMEM_SLAB_SIZE - KMEM_SLAB_HEADER) / cache->stride;
+        cache->next_cache = kmem_caches;
+        kmem_caches = cache;
+    }
+    if(cache->per_slab == 0)
+    {
+        return -1;
+    }
+
+    slab = (kmem_slab_t*)buddy_alloc(0);
+    if(slab == NULL)
+    {
+        return -1;
+    }
+
+    slab->magic = KMEM_SLAB_MAGIC;
+    slab->cache = cache;
+    slab->in_use = 0;
+    slab->free = NULL;
+
+    /* chain the objects so the lowest is handed out first */
+    obj = (uint8_t*)slab + KMEM_SLAB_HEADER + (cache->per_slab - 1) * cache->stride;
+    for(i = 0; i < cache->per_slab; i++, obj -= cache->stride)
+    {
+        *(void**)obj = slab->free;
+        slab->free = obj;
+    }
+
+    kmem_link(cache, slab);
+    cache->slabs++;
+    return 0;
+}
+
+/* kmem_cache_alloc
+ * 	Description: Pops the first free object of the first slab with
+ *  room, growing the cache when none has any.
+ * 	Inputs: cache
+ * 	Outputs: Return the object, NULL if memory ran out
+ * 	Side Effects: The object is not cleared. A slab that fills up
+ *  leaves the partial list.
+ */
+void* kmem_cache_alloc(kmem_cache_t* cache)
+{
+    kmem_slab_t* slab;
+    void* obj;
+
+    if(cache->partial == NULL && kmem_grow(cache) == -1)
+    {
+        cache->failures++;
+        return NULL;
+    }
+
+    slab = cache->partial;
+    obj = slab->free;
+    slab->free = *(void**)obj;
+    slab->in_use++;
+    if(slab->free == NULL)
+    {
+        kmem_unlink(cache, slab);
+    }
+
+    cache->active++;
+    cache->allocs++;
+    return obj;
+}
+
+/* kmem_cache_free
+ * 	Description: Pushes an object back on the free list of its slab. A
+ *  slab that was full rejoins the partial list; one that empties goes
+ *  back to the frame allocator if the cache has room elsewhere.
+ * 	Inputs: cache, obj
+ * 	Outputs: None
+ * 	Side Effects: None for NULL.
+ */
+void kmem_cache_free(kmem_cache_t* cache, void* obj)
+{
+    kmem_slab_t* slab;
+
+    if(obj == NULL)
+    {
+        return;
+    }
+    slab = (kmem_slab_t*)((uint32_t)obj & ~(KMEM_SLAB_SIZE - 1));
+
+    if(slab->free == NULL)
+    {
+        kmem_link(cache, slab);
+    }
+    *(void**)obj = slab->free;
+    slab->free = obj;
+    slab->in_use--;
+
+    cache->active--;
+    cache->frees++;
+
+    if(slab->in_use == 0 && (slab->prev != NULL || slab->next != NULL))
+    {
+        kmem_unlink(cache, slab);
+        slab->magic = 0;
+        buddy_free((uint32_t)slab, 0);
+        cache->slabs--;
+    }
+}
+
+/* kmalloc
+ * 	Description: Takes a block from the smallest general cache that
+ *  fits, or a block of whole pages with a header in front for requests
+ *  above KMEM_MAX_CLASS.
+ * 	Inputs: size
+ * 	Outputs: Return the block, NULL if memory ran out or size is 0
+ * 	Side Effects: The block is not cleared.
+ */
+void* kmalloc(uint32_t size)
+{
+    uint32_t i, class, order, block;
+    kmem_large_t* large;
+
+    if(size == 0)
+    {
+        return NULL;
+    }
+
+    for(i = 0, class = KMEM_MIN_CLASS; i < KMEM_CLASSES; i++, class <<= 1)
+    {
+        if(size <= class)
+        {
+            return kmem_cache_alloc(&kmalloc_caches[i]);
+        }
+    }
+
+    for(order = 0; order <= BUDDY_MAX_ORDER && (BUDDY_PAGE_SIZE << order) < size + KMEM_LARGE_HEADER; order++);
+    if(order > BUDDY_MAX_ORDER || (block = buddy_alloc(order)) == 0)
+    {
+        kmem_large_stats.failures++;
+        return NULL;
+    }
+
+    large = (kmem_large_t*)block;
+    large->magic = KMEM_LARGE_MAGIC;
+    large->order = order;
+    kmem_large_stats.allocs++;
+    kmem_large_stats.pages += 1 << order;
+    return (void*)(block + KMEM_LARGE_HEADER);
+}
+
+/* kfree
+ * 	Description: Gives a block back to the slab cache or the frame
+ *  allocator it came from, telling them apart by the header at the
+ *  start of its page.
+ * 	Inputs: ptr
+ * 	Outputs: None
+ * 	Side Effects: Pointers that are neither are counted and ignored.
+ */
+void kfree(void* ptr)
+{
+    uint32_t page;
+    kmem_slab_t* slab;
+    kmem_large_t* large;
+
+    if(ptr == NULL)
+    {
+        return;
+    }
+    page = (uint32_t)ptr & ~(BUDDY_PAGE_SIZE - 1);
+
+    slab = (kmem_slab_t*)page;
+    if(slab->magic == KMEM_SLAB_MAGIC)
+    {
+        kmem_cache_free(slab->cache, ptr);
+        return;
+    }
+
+    large = (kmem_large_t*)page;
+    if(large->magic == KMEM_LARGE_MAGIC && (uint32_t)ptr == page + KMEM_LARGE_HEADER)
+    {
+        large->magic = 0;
+        kmem_large_stats.frees++;
+        kmem_large_stats.pages -= 1 << large->order;
+        buddy_free(page, large->order);
+        return;
+    }
+
+    kmem_large_stats.bad_frees++;
+}
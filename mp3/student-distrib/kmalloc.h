@@ -0,0 +1,95 @@
+/*
+ * kmalloc.h
+ * Kernel heap. Objects of one kind come from a slab cache, which cuts
+ * 4 KB pages from the frame allocator into equal objects. The slabs of
+ * a cache that still have room sit on a list, each with a free list
+ * threaded through its free objects, so taking or giving back an object
+ * never searches. A slab that empties goes back to the frame allocator
+ * unless it is the only one the cache has room in.
+ *
+ * kmalloc rounds a request up to one of the general caches, or takes
+ * whole pages from the frame allocator for anything larger; kfree finds
+ * which from the header at the start of the page.
+ */
+
+#ifndef _KMALLOC_H
+#define _KMALLOC_H
+
+#include "types.h"
+
+/* Magic numbers */
+#define KMEM_SLAB_SIZE      4096        /* one page per slab */
+#define KMEM_ALIGN          8
+#define KMEM_SLAB_MAGIC     0x51AB0001
+#define KMEM_LARGE_MAGIC    0x51AB0002
+#define KMEM_MIN_CLASS      16
+#define KMEM_MAX_CLASS      1024        /* larger requests take whole pages */
+#define KMEM_CLASSES        7           /* 16, 32, ... 1024 */
+
+struct kmem_cache;
+
+/* Header at the start of every slab page */
+typedef struct kmem_slab
+{
+    uint32_t magic;
+    struct kmem_cache* cache;
+    struct kmem_slab* next;     /* slabs of the cache with a free object */
+    struct kmem_slab* prev;
+    void* free;                 /* first free object */
+    uint32_t in_use;
+} kmem_slab_t;
+
+/* Header in front of a kmalloc block too large for the general caches */
+typedef struct kmem_large
+{
+    uint32_t magic;
+    uint32_t order;
+} kmem_large_t;
+
+/* A cache of equal objects, with its counters for /proc/slab */
+typedef struct kmem_cache
+{
+    const int8_t* name;
+    uint32_t size;
+    uint32_t stride;            /* object size with alignment, 0 until first grown */
+    uint32_t per_slab;
+    kmem_slab_t* partial;
+    struct kmem_cache* next_cache;
+    uint32_t slabs;
+    uint32_t active;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+} kmem_cache_t;
+
+/* Static initializer of a cache; it joins kmem_caches when it first grows */
+#define KMEM_CACHE(name, size)  {(name), (size), 0, 0, NULL, NULL, 0, 0, 0, 0, 0}
+
+/* Counters of the blocks kmalloc takes straight from the frame allocator */
+typedef struct kmem_large_stats
+{
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t pages;
+    uint32_t failures;
+    uint32_t bad_frees;
+} kmem_large_stats_t;
+
+extern kmem_large_stats_t kmem_large_stats;
+
+/* Every cache that has grown at least once, newest first */
+extern kmem_cache_t* kmem_caches;
+
+/* Take an object from a cache, NULL if memory ran out */
+void* kmem_cache_alloc(kmem_cache_t* cache);
+
+/* Give an object back to the cache it came from */
+void kmem_cache_free(kmem_cache_t* cache, void* obj);
+
+/* Take size bytes from the heap, NULL if memory ran out */
+void* kmalloc(uint32_t size);
+
+/* Give back anything kmalloc or kmem_cache_alloc returned; NULL is ignored */
+void kfree(void* ptr);
+
+#endif /* _KMALLOC_H */
@@ -9,6 +9,7 @@ static int screen_y;
 char* video_mem = (char *)VIDEO;
 
 static int scrollFlag = 0;
+static int cursorHeld = 0;
 volatile int enterFlag = 0;
 
 /* void clear(void);
@@ -45,6 +46,12 @@ void update_cursor(void)
 {
     /* Taken from osdev */
 
+    /* a batch of writes moves the cursor once, when it is released */
+    if (cursorHeld)
+    {
+        return;
+    }
+
     int temp_x, temp_y;
     temp_x = screen_x;
     temp_y = screen_y;
@@ -62,6 +69,27 @@ void update_cursor(void)
     screen_y = temp_y;
 }
 
+/* hold_cursor
+ * Inputs: none
+ * Return Value: none
+ * Function: Stops update_cursor from touching the hardware until
+ * release_cursor, so a long write costs one cursor move. */
+void hold_cursor(void)
+{
+    cursorHeld = 1;
+}
+
+/* release_cursor
+ * Inputs: none
+ * Return Value: none
+ * Function: Lets update_cursor through again and moves the cursor to
+ * where the held writes left it. */
+void release_cursor(void)
+{
+    cursorHeld = 0;
+    update_cursor();
+}
+
 /* void reset(void);
  * Inputs: void
  * Return Value: none
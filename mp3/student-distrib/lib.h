@@ -52,6 +52,8 @@ int8_t* strcpy(int8_t* dest, const int8_t*src);
 int8_t* strncpy(int8_t* dest, const int8_t*src, uint32_t n);
 void enable_cursor(uint8_t cursor_start, uint8_t cursor_end);
 void update_cursor(void);
+void hold_cursor(void);
+void release_cursor(void);
 
 /* Userspace address-check functions */
 int32_t bad_userspace_addr(const void* addr, int32_t len);
@@ -102,6 +104,34 @@ static inline uint32_t inl(port) {
     return val;
 }
 
+/* Reads count two-byte words from a port into a buffer */
+static inline void insw(uint32_t port, void* buf, uint32_t count) {
+    asm volatile ("rep insw"
+            : "+D"(buf), "+c"(count)
+            : "d"(port)
+            : "memory"
+    );
+}
+
+/* Writes count two-byte words from a buffer to a port */
+static inline void outsw(uint32_t port, const void* buf, uint32_t count) {
+    asm volatile ("rep outsw"
+            : "+S"(buf), "+c"(count)
+            : "d"(port)
+            : "memory"
+    );
+}
+
+/* Reads the low 32 bits of the time-stamp counter. The difference of two
+ * reads is the elapsed cycle count for intervals under 2^32 cycles */
+static inline uint32_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc"
+            : "=a"(lo), "=d"(hi)
+    );
+    return lo;
+}
+
 /* Writes a byte to a port */
 #define outb(data, port)                \
 do {                                    \
@@ -125,7 +155,7 @@ do {                                    \
 /* Writes four bytes to four consecutive ports */
 #define outl(data, port)                \
 do {                                    \
-    asm volatile ("outl %l1, (%w0)"     \
+    asm volatile ("outl %k1, (%w0)"     \
             :                           \
             : "d"(port), "a"(data)      \
             : "memory", "cc"            \
@@ -0,0 +1,90 @@
+#include "types.h"
+#include "lz.h"
+
+/* lz_length
+ * 	Description: Adds the extra length bytes that follow a saturated
+ *  token nibble.
+ * 	Inputs: src, src_len, pos (read position), length (the nibble)
+ * 	Outputs: Return the full length, -1 if the input ends first
+ * 	Side Effects: Advances pos past the extra bytes.
+ */
+static int32_t lz_length(const uint8_t* src, uint32_t src_len, uint32_t* pos, uint32_t length)
+{
+    uint8_t more;
+
+    if(length != LZ_RUN_MASK)
+    {
+        return length;
+    }
+    do
+    {
+        if(*pos >= src_len)
+        {
+            return -1;
+        }
+        more = src[(*pos)++];
+        length += more;
+    } while(more == LZ_LENGTH_MORE);
+
+    return length;
+}
+
+/* lz_decompress
+ * 	Description: Decodes one compressed block. Every length and offset
+ *  is checked against both buffers, so a corrupt block fails instead of
+ *  reading or writing out of bounds.
+ * 	Inputs: src, src_len, dst, dst_len (size of dst)
+ * 	Outputs: Return the number of bytes decoded, -1 on a corrupt block
+ * 	Side Effects: Fills dst.
+ */
+int32_t lz_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len)
+{
+    uint32_t pos = 0;
+    uint32_t out = 0;
+    uint32_t offset, i;
+    int32_t literals, match;
+    uint8_t token;
+
+    while(pos < src_len)
+    {
+        token = src[pos++];
+
+        /* Literals are copied as they are */
+        literals = lz_length(src, src_len, &pos, token >> LZ_TOKEN_SHIFT);
+        if(literals == -1 || literals > src_len - pos || literals > dst_len - out)
+        {
+            return -1;
+        }
+        for(i = 0; i < literals; i++)
+        {
+            dst[out++] = src[pos++];
+        }
+
+        /* The last sequence has no match */
+        if(pos == src_len)
+        {
+            break;
+        }
+
+        if(src_len - pos < LZ_OFFSET_SIZE)
+        {
+            return -1;
+        }
+        offset = src[pos] | (src[pos + 1] << 8);
+        pos += LZ_OFFSET_SIZE;
+
+        match = lz_length(src, src_len, &pos, token & LZ_RUN_MASK);
+        if(match == -1 || offset == 0 || offset > out || match + LZ_MIN_MATCH > dst_len - out)
+        {
+            return -1;
+        }
+
+        /* Byte by byte, since a match may overlap its own output */
+        for(i = 0; i < match + LZ_MIN_MATCH; i++, out++)
+        {
+            dst[out] = dst[out - offset];
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,31 @@
+/*
+ * lz.h
+ * Decoder for the LZ block format the image builder uses for compressed
+ * files. Each block of a file is compressed on its own, so any block can
+ * be decoded without the ones before it.
+ *
+ * A compressed block is a list of sequences. Each sequence starts with a
+ * token byte: the high nibble is the number of literals, the low nibble
+ * the match length minus LZ_MIN_MATCH. A nibble of LZ_RUN_MASK is
+ * followed by extra length bytes, added up until one is below
+ * LZ_LENGTH_MORE. The literals come next, then a 2-byte little-endian
+ * offset back into the output. The last sequence may stop after its
+ * literals.
+ */
+
+#ifndef _LZ_H
+#define _LZ_H
+
+#include "types.h"
+
+/* Magic numbers */
+#define LZ_MIN_MATCH    4
+#define LZ_RUN_MASK     15
+#define LZ_LENGTH_MORE  255
+#define LZ_TOKEN_SHIFT  4
+#define LZ_OFFSET_SIZE  2
+
+/* Decode one compressed block, returning the decoded size or -1 */
+int32_t lz_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len);
+
+#endif /* _LZ_H */
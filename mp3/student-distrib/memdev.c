@@ -0,0 +1,155 @@
+#include "types.h"
+#include "lib.h"
+#include "memdev.h"
+
+/* xorshift32 state, never zero once seeded */
+static uint32_t random_state = 0;
+
+/* xorshift32
+ * 	Description: Steps the generator.
+ * 	Inputs: None
+ * 	Outputs: Return the next 32 bits
+ * 	Side Effects: Advances random_state
+ */
+static uint32_t xorshift32()
+{
+    uint32_t x = random_state;
+
+    x ^= x << XORSHIFT_A;
+    x ^= x >> XORSHIFT_B;
+    x ^= x << XORSHIFT_C;
+    random_state = x;
+    return x;
+}
+
+/* null_read
+ * 	Description: Reads from /dev/null, which is always at its end.
+ * 	Inputs: inode, offset, buf, length
+ * 	Outputs: Return 0
+ * 	Side Effects: None
+ */
+int32_t null_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+{
+    return 0;
+}
+
+/* null_write
+ * 	Description: Accepts and drops the bytes. Every memory device
+ *  writes this way.
+ * 	Inputs: fd, buf, nbytes
+ * 	Outputs: Return nbytes, -1 if it is negative
+ * 	Side Effects: None
+ */
+int32_t null_write(int32_t fd, const void* buf, int32_t nbytes)
+{
+    if(nbytes < 0)
+    {
+        return -1;
+    }
+    return nbytes;
+}
+
+/* zero_read
+ * 	Description: Fills the buffer with zero bytes.
+ * 	Inputs: inode, offset, buf, length
+ * 	Outputs: Return length, -1 if it does not fit an int32_t
+ * 	Side Effects: Fills buf
+ */
+int32_t zero_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+{
+    if((int32_t)length < 0)
+    {
+        return -1;
+    }
+    memset(buf, 0, length);
+    return length;
+}
+
+/* random_read
+ * 	Description: Fills the buffer with xorshift32 output, a word at a
+ *  time. Not for anything that needs secrecy.
+ * 	Inputs: inode, offset, buf, length
+ * 	Outputs: Return length, -1 if it does not fit an int32_t
+ * 	Side Effects: Fills buf, advances the generator
+ */
+int32_t random_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+{
+    uint32_t i, word;
+
+    if((int32_t)length < 0)
+    {
+        return -1;
+    }
+
+    /* x86 allows the unaligned stores */
+    for(i = 0; i + sizeof(uint32_t) <= length; i += sizeof(uint32_t))
+    {
+        *(uint32_t *)(buf + i) = xorshift32();
+    }
+    if(i < length)
+    {
+        word = xorshift32();
+        memcpy(buf + i, &word, length - i);
+    }
+
+    return length;
+}
+
+/* random_open
+ * 	Description: Seeds the generator from the time-stamp counter the
+ *  first time the device is opened.
+ * 	Inputs: filename
+ * 	Outputs: Return 0
+ * 	Side Effects: May set random_state
+ */
+int32_t random_open(const uint8_t* filename)
+{
+    if(random_state == 0)
+    {
+        random_state = rdtsc() ^ XORSHIFT_SEED;
+        if(random_state == 0)
+        {
+            random_state = XORSHIFT_SEED;
+        }
+    }
+    return 0;
+}
+
+/* memdev_open
+ * 	Description: Opens a memory device. They keep no per-open state,
+ *  so it does nothing.
+ * 	Inputs: filename
+ * 	Outputs: Return 0
+ * 	Side Effects: None
+ */
+int32_t memdev_open(const uint8_t* filename)
+{
+    return 0;
+}
+
+/* memdev_close
+ * 	Description: Closes a memory device. They keep no per-open state,
+ *  so it does nothing.
+ * 	Inputs: fd
+ * 	Outputs: Return 0
+ * 	Side Effects: None
+ */
+int32_t memdev_close(int32_t fd)
+{
+    return 0;
+}
+
+/* memdev_stat
+ * 	Description: Reports a character device with no size.
+ * 	Inputs: inode, buf
+ * 	Outputs: Return 0
+ * 	Side Effects: Fills buf
+ */
+int32_t memdev_stat(uint32_t inode, stat_t* buf)
+{
+    buf->filetype = STAT_TYPE_CHARDEV;
+    buf->inode = inode;
+    buf->size = 0;
+    buf->blocks = 0;
+    return 0;
+}
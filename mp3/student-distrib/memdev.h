@@ -0,0 +1,46 @@
+/*
+ * memdev.h
+ * Memory devices for /dev. null reads nothing and discards writes,
+ * zero reads zero bytes and random reads xorshift32 output. None of
+ * them touches hardware or the filesystem, so reads and writes on them
+ * cost only the system call and the descriptor dispatch plus a memory
+ * fill.
+ */
+
+#ifndef _MEMDEV_H
+#define _MEMDEV_H
+
+#include "types.h"
+#include "stat.h"
+
+/* Magic numbers */
+#define XORSHIFT_A      13
+#define XORSHIFT_B      17
+#define XORSHIFT_C      5
+#define XORSHIFT_SEED   0x2545F491
+
+/* Reads nothing */
+int32_t null_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+
+/* Discards the bytes, shared by every memory device */
+int32_t null_write(int32_t fd, const void* buf, int32_t nbytes);
+
+/* Fills the buffer with zero bytes */
+int32_t zero_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+
+/* Fills the buffer with pseudo-random bytes */
+int32_t random_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+
+/* Seeds the generator on first use */
+int32_t random_open(const uint8_t* filename);
+
+/* Does nothing but still returns a value */
+int32_t memdev_open(const uint8_t* filename);
+
+/* Does nothing but still returns a value */
+int32_t memdev_close(int32_t fd);
+
+/* Reports a device with no size */
+int32_t memdev_stat(uint32_t inode, stat_t* buf);
+
+#endif /* _MEMDEV_H */
@@ -0,0 +1,199 @@
+#include "types.h"
+#include "lib.h"
+#include "paging.h"
+#include "filesystem.h"
+#include "vfs.h"
+#include "mmap.h"
+
+/* One page table per process slot for the mapping window */
+static pte_t mmap_tables[MMAP_SLOTS][MMAP_PAGES] __attribute__((aligned(four_kb)));
+
+/* Inode behind each mapped page, to unpin when the page goes */
+static uint16_t mmap_inodes[MMAP_SLOTS][MMAP_PAGES];
+
+/* Data block each mapped page holds a reference to */
+static uint16_t mmap_blocks[MMAP_SLOTS][MMAP_PAGES];
+
+/* mmap_find_run
+ * 	Description: Finds the first run of unmapped pages long enough for
+ *  a mapping.
+ * 	Inputs: table, pages
+ * 	Outputs: Return the index of the first page, -1 if none fits
+ * 	Side Effects: None
+ */
+static int32_t mmap_find_run(pte_t* table, uint32_t pages)
+{
+    uint32_t i, run = 0;
+
+    for(i = 0; i < MMAP_PAGES; i++)
+    {
+        run = table[i].present_pte ? 0 : run + 1;
+        if(run == pages)
+        {
+            return i + 1 - pages;
+        }
+    }
+    return -1;
+}
+
+/* mmap_clear
+ * 	Description: Unmaps one page of a slot and drops the pin and the
+ *  block reference it held.
+ * 	Inputs: slot, page (index in the window)
+ * 	Outputs: None
+ * 	Side Effects: None for a page that is not mapped. The caller
+ *  flushes the TLB.
+ */
+static void mmap_clear(uint32_t slot, uint32_t page)
+{
+    if(mmap_tables[slot][page].present_pte)
+    {
+        fs_block_drop(mmap_blocks[slot][page]);
+        vfs_unpin(VFS_IMAGE_MOUNT, mmap_inodes[slot][page]);
+    }
+    mmap_tables[slot][page].hex = 0;
+}
+
+/* mmap_map
+ * 	Description: Maps the blocks of a file in order onto a run of free
+ *  pages in the slot's window. The pages are user, read-only and point
+ *  at the data blocks themselves, so files on the data disk, whose
+ *  blocks only pass through the buffer cache, cannot be mapped.
+ * 	Inputs: slot, inode, length (bytes, at most the file length)
+ * 	Outputs: Return the user address of the mapping, -1 on failure
+ * 	Side Effects: Changes the slot's page table and flushes the TLB.
+ *  Each page pins the file and holds its data block until it is
+ *  unmapped, so a later write to the file copies the block away.
+ */
+int32_t mmap_map(uint32_t slot, uint32_t inode, uint32_t length)
+{
+    int32_t first;
+    uint32_t i, pages;
+    data_t* block;
+    inode_t* node;
+    pte_t* table;
+
+    if(fs_on_disk || slot >= MMAP_SLOTS || inode >= boot_block_addr->inode_count || length == 0)
+    {
+        return -1;
+    }
+    node = inode_addr + inode;
+    if(length > node->length)
+    {
+        return -1;
+    }
+
+    table = mmap_tables[slot];
+    pages = (length + MMAP_PAGE_SIZE - 1) / MMAP_PAGE_SIZE;
+    first = mmap_find_run(table, pages);
+    if(first == -1)
+    {
+        return -1;
+    }
+
+    /* Every block has to be a whole page of its own before any is mapped */
+    for(i = 0; i < pages; i++)
+    {
+        block = fs_data_block(fs_bmap(inode, i));
+        if(block == NULL || ((uint32_t)block & MMAP_PAGE_MASK))
+        {
+            return -1;
+        }
+    }
+
+    if(vfs_pin(VFS_IMAGE_MOUNT, inode) == -1)
+    {
+        return -1;
+    }
+    for(i = 0; i < pages; i++)
+    {
+        /* the first pin found a free entry, the rest only count */
+        if(i > 0)
+        {
+            vfs_pin(VFS_IMAGE_MOUNT, inode);
+        }
+        mmap_inodes[slot][first + i] = inode;
+        mmap_blocks[slot][first + i] = fs_bmap(inode, i);
+        fs_block_hold(mmap_blocks[slot][first + i]);
+        block = fs_data_block(mmap_blocks[slot][first + i]);
+        table[first + i].hex = 0;
+        table[first + i].page_table_base_addr_pte = (uint32_t)block >> SHIFT1;
+        table[first + i].user_pte = 1;
+        table[first + i].present_pte = 1;
+    }
+
+    flush_tlb();
+    return MMAP_BASE + first * MMAP_PAGE_SIZE;
+}
+
+/* mmap_unmap
+ * 	Description: Clears the pages covering a range of the window and
+ *  drops their pins.
+ * 	Inputs: slot, addr (page aligned), length
+ * 	Outputs: Return 0, -1 if the range is outside the window
+ * 	Side Effects: Changes the slot's page table and flushes the TLB.
+ */
+int32_t mmap_unmap(uint32_t slot, uint32_t addr, uint32_t length)
+{
+    uint32_t i, first, pages;
+
+    if(slot >= MMAP_SLOTS || length == 0 || addr < MMAP_BASE || (addr & MMAP_PAGE_MASK))
+    {
+        return -1;
+    }
+
+    first = (addr - MMAP_BASE) / MMAP_PAGE_SIZE;
+    pages = (length + MMAP_PAGE_SIZE - 1) / MMAP_PAGE_SIZE;
+    if(first >= MMAP_PAGES || pages > MMAP_PAGES - first)
+    {
+        return -1;
+    }
+
+    for(i = 0; i < pages; i++)
+    {
+        mmap_clear(slot, first + i);
+    }
+
+    flush_tlb();
+    return 0;
+}
+
+/* mmap_release
+ * 	Description: Drops every mapping of a slot, when its process halts.
+ * 	Inputs: slot
+ * 	Outputs: None
+ * 	Side Effects: Clears the slot's page table and unpins its files.
+ */
+void mmap_release(uint32_t slot)
+{
+    uint32_t i;
+
+    if(slot < MMAP_SLOTS)
+    {
+        for(i = 0; i < MMAP_PAGES; i++)
+        {
+            mmap_clear(slot, i);
+        }
+    }
+}
+
+/* mmap_install
+ * 	Description: Points the mapping window of the page directory at the
+ *  slot's page table. The caller reloads the page directory.
+ * 	Inputs: slot
+ * 	Outputs: None
+ * 	Side Effects: Changes the page directory.
+ */
+void mmap_install(uint32_t slot)
+{
+    page_dir[MMAP_PDE_IDX].hex = 0;
+    if(slot >= MMAP_SLOTS)
+    {
+        return;
+    }
+
+    page_dir[MMAP_PDE_IDX].page_table_base_addr_pte = (uint32_t)mmap_tables[slot] >> SHIFT1;
+    page_dir[MMAP_PDE_IDX].read_write_pte = 1;
+    page_dir[MMAP_PDE_IDX].user_pte = 1;
+    page_dir[MMAP_PDE_IDX].present_pte = 1;
+}
@@ -0,0 +1,38 @@
+/*
+ * mmap.h
+ * Read-only file mappings. The filesystem image stays in memory, so a
+ * mapping points user PTEs straight at the file's data blocks. Every
+ * mapped page pins its file and holds a reference to its block, so
+ * neither unlink nor a write that copies a shared block away can free
+ * a block while a mapping still shows it. Each process slot owns one
+ * page table, installed in a fixed 4 MB window of the page directory
+ * whenever that process is running.
+ */
+
+#ifndef _MMAP_H
+#define _MMAP_H
+
+#include "types.h"
+#include "process.h"
+
+/* Magic numbers */
+#define MMAP_BASE       0x0C000000
+#define MMAP_PDE_IDX    (MMAP_BASE >> 22)
+#define MMAP_PAGES      1024
+#define MMAP_PAGE_SIZE  4096
+#define MMAP_PAGE_MASK  0xFFF
+#define MMAP_SLOTS      PROC_MAX   /* slot is pid - 1 */
+
+/* Map the first length bytes of a file for a process slot */
+int32_t mmap_map(uint32_t slot, uint32_t inode, uint32_t length);
+
+/* Remove the pages of a mapping */
+int32_t mmap_unmap(uint32_t slot, uint32_t addr, uint32_t length);
+
+/* Drop every mapping of a process slot */
+void mmap_release(uint32_t slot);
+
+/* Point the mapping window at the page table of a process slot */
+void mmap_install(uint32_t slot);
+
+#endif /* _MMAP_H */
@@ -1,5 +1,6 @@
 #include "paging.h"
 #include "x86_desc.h"
+#include "buddy.h"
 
 // initialize paging struct
 pde_t page_dir[PAGING_SIZE] __attribute__((aligned(four_kb)));
@@ -39,6 +40,15 @@ void paging_initialize()
     page_dir[1].present_entry = 1;
     page_dir[1].ps_entry = 1;
 
+    // map the memory the frame allocator hands out one to one, for the kernel only
+    for (i = PHYS_MAP_FIRST; i < PHYS_MAP_END; i++)
+    {
+        page_dir[i].page_table_base_addr_entry = i;
+        page_dir[i].read_write_entry = 1;
+        page_dir[i].present_entry = 1;
+        page_dir[i].ps_entry = 1;
+    }
+
     // initialize virtual memory in page table
     page_table[VIRUTAL_MEM >> SHIFT1].page_table_base_addr_pte = VIDEO_MEM >> SHIFT1;
     page_table[VIRUTAL_MEM >> SHIFT1].read_write_pte = 1;
@@ -48,6 +58,84 @@ void paging_initialize()
     load_pde((uint32_t)page_dir);
 }
 
+/* 
+ *  paging_map_user
+ *   DESCRIPTION: points the user window at a process's page table
+ *   INPUTS: table (physical address of the page table)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: the caller still has to flush the tlb
+ */
+void paging_map_user(uint32_t table)
+{
+    page_dir[USER_PDE].hex = 0;
+    page_dir[USER_PDE].page_table_base_addr_pte = table >> SHIFT1;
+    page_dir[USER_PDE].present_pte = 1;
+    page_dir[USER_PDE].read_write_pte = 1;
+    page_dir[USER_PDE].user_pte = 1;
+    page_dir[USER_PDE].ps_pte = 0;
+}
+
+/* 
+ *  paging_user_alloc
+ *   DESCRIPTION: backs a run of pages of the user window with zeroed
+ *                4 KB frames from the frame allocator, skipping pages
+ *                that are already present
+ *   INPUTS: table (physical address of the page table), first, count
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, -1 if memory ran out
+ *   SIDE EFFECTS: pages mapped before running out stay mapped
+ */
+int32_t paging_user_alloc(uint32_t table, uint32_t first, uint32_t count)
+{
+    pte_t* pages = (pte_t*)table;
+    uint32_t i, frame;
+
+    for (i = first; i < first + count && i < PAGING_SIZE; i++)
+    {
+        if (pages[i].present_pte)
+        {
+            continue;
+        }
+        if ((frame = buddy_alloc(0)) == 0)
+        {
+            return -1;
+        }
+        memset((void*)frame, 0, four_kb);
+
+        pages[i].hex = 0;
+        pages[i].page_table_base_addr_pte = frame >> SHIFT1;
+        pages[i].present_pte = 1;
+        pages[i].read_write_pte = 1;
+        pages[i].user_pte = 1;
+    }
+    return 0;
+}
+
+/* 
+ *  paging_user_free
+ *   DESCRIPTION: gives every frame a user page table maps back to the
+ *                frame allocator
+ *   INPUTS: table (physical address of the page table)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: clears the table; the table itself is not freed
+ */
+void paging_user_free(uint32_t table)
+{
+    pte_t* pages = (pte_t*)table;
+    uint32_t i;
+
+    for (i = 0; i < PAGING_SIZE; i++)
+    {
+        if (pages[i].present_pte)
+        {
+            buddy_free(pages[i].page_table_base_addr_pte << SHIFT1, 0);
+        }
+        pages[i].hex = 0;
+    }
+}
+
 /* 
  *  Loads the page address
  *   DESCRIPTION: Loads the page address
@@ -13,6 +13,9 @@
 #define KERNEL_MEM 0x400000                // kernel memory address
 #define VIDEO_MEM 0xB8000                  // virstual video memory address
 #define VIRUTAL_MEM (VIDEO_MEM & 0x3FF000) // video memory address for array
+#define PHYS_MAP_FIRST 2                   // pdes 2 to 31 map 8 MB - 128 MB one to one for the kernel
+#define PHYS_MAP_END   32
+#define USER_PDE       32                  // the 4 MB user window at 128 MB, one page table per process
 
 /* Adding structs*/
 
@@ -86,6 +89,15 @@ extern pde_t page_virtual_mem[PAGING_SIZE] __attribute__((aligned(four_kb)));
 /* Initializing paging function */
 extern void paging_initialize();
 
+/* Point the user window at a process's page table */
+extern void paging_map_user(uint32_t table);
+
+/* Back user pages first to first + count - 1 of a page table with zeroed frames */
+extern int32_t paging_user_alloc(uint32_t table, uint32_t first, uint32_t count);
+
+/* Free every frame a user page table maps */
+extern void paging_user_free(uint32_t table);
+
 /* Load pde function */
 extern inline void load_pde(uint32_t page_dir);
 
@@ -0,0 +1,86 @@
+#include "types.h"
+#include "lib.h"
+#include "pci.h"
+
+/* pci_address
+ * 	Description: Builds the CONFIG_ADDRESS value for a register.
+ * 	Inputs: device (bus << 8 | device << 3 | function), offset
+ * 	Outputs: Return the address
+ * 	Side Effects: None
+ */
+static uint32_t pci_address(uint32_t device, uint32_t offset)
+{
+    return PCI_ENABLE | (device << 8) | (offset & PCI_OFFSET_MASK);
+}
+
+/* pci_read
+ * 	Description: Reads a 32-bit configuration register.
+ * 	Inputs: device (bus << 8 | device << 3 | function), offset (dword
+ *  aligned)
+ * 	Outputs: Return the register
+ * 	Side Effects: None
+ */
+uint32_t pci_read(uint32_t device, uint32_t offset)
+{
+    outl(pci_address(device, offset), PCI_CONFIG_ADDRESS);
+    return inl(PCI_CONFIG_DATA);
+}
+
+/* pci_write
+ * 	Description: Writes a 32-bit configuration register.
+ * 	Inputs: device (bus << 8 | device << 3 | function), offset (dword
+ *  aligned), value
+ * 	Outputs: None
+ * 	Side Effects: Changes the device's configuration.
+ */
+void pci_write(uint32_t device, uint32_t offset, uint32_t value)
+{
+    outl(pci_address(device, offset), PCI_CONFIG_ADDRESS);
+    outl(value, PCI_CONFIG_DATA);
+}
+
+/* pci_find_class
+ * 	Description: Scans every bus, device and function for the first
+ *  device with a class and subclass. Functions past 0 are only probed
+ *  on multifunction devices.
+ * 	Inputs: class, subclass
+ * 	Outputs: Return the device (bus << 8 | device << 3 | function), -1
+ *  if there is none
+ * 	Side Effects: None
+ */
+int32_t pci_find_class(uint32_t class, uint32_t subclass)
+{
+    uint32_t bus, dev, func, device, reg;
+
+    for(bus = 0; bus < PCI_MAX_BUS; bus++)
+    {
+        for(dev = 0; dev < PCI_MAX_DEVICE; dev++)
+        {
+            for(func = 0; func < PCI_MAX_FUNCTION; func++)
+            {
+                device = (bus << 8) | (dev << 3) | func;
+                if((pci_read(device, PCI_VENDOR_ID) & 0xFFFF) == PCI_NO_DEVICE)
+                {
+                    if(func == 0)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+
+                reg = pci_read(device, PCI_CLASS);
+                if((reg >> 24) == class && ((reg >> 16) & 0xFF) == subclass)
+                {
+                    return device;
+                }
+
+                if(func == 0 && !((pci_read(device, PCI_HEADER_TYPE) >> 16) & PCI_MULTIFUNCTION))
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,51 @@
+/*
+ * pci.h
+ * PCI configuration space access through the legacy 0xCF8/0xCFC ports,
+ * enough to find a device by class and read or change its registers.
+ */
+
+#ifndef _PCI_H
+#define _PCI_H
+
+#include "types.h"
+
+/* Magic numbers */
+#define PCI_CONFIG_ADDRESS  0xCF8
+#define PCI_CONFIG_DATA     0xCFC
+#define PCI_ENABLE          0x80000000
+#define PCI_MAX_BUS         256
+#define PCI_MAX_DEVICE      32
+#define PCI_MAX_FUNCTION    8
+#define PCI_NO_DEVICE       0xFFFF
+#define PCI_MULTIFUNCTION   0x80
+
+/* Configuration register offsets */
+#define PCI_VENDOR_ID       0x00
+#define PCI_COMMAND         0x04
+#define PCI_CLASS           0x08
+#define PCI_HEADER_TYPE     0x0C
+#define PCI_BAR4            0x20
+
+/* Command register bits */
+#define PCI_COMMAND_IO      0x0001
+#define PCI_COMMAND_MASTER  0x0004
+
+/* Class codes */
+#define PCI_CLASS_STORAGE   0x01
+#define PCI_SUBCLASS_IDE    0x01
+
+/* Register offsets are dword aligned, I/O BARs keep flags in the low bits */
+#define PCI_OFFSET_MASK     0xFC
+#define PCI_BAR_IO          0x00000001
+#define PCI_BAR_IO_MASK     0xFFFFFFFC
+
+/* Read a 32-bit configuration register */
+uint32_t pci_read(uint32_t device, uint32_t offset);
+
+/* Write a 32-bit configuration register */
+void pci_write(uint32_t device, uint32_t offset, uint32_t value);
+
+/* Find the first device of a class and subclass, -1 if there is none */
+int32_t pci_find_class(uint32_t class, uint32_t subclass);
+
+#endif /* _PCI_H */
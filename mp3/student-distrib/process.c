@@ -0,0 +1,225 @@
+#include "types.h"
+#include "lib.h"
+#include "paging.h"
+#include "buddy.h"
+#include "kmalloc.h"
+#include "process.h"
+
+/* The table, indexed by pid; entry 0 is never handed out */
+static proc_entry_t proc_table[PROC_MAX + 1];
+
+/* Kernel stacks, one block per pid */
+static uint8_t proc_kstacks[PROC_MAX][PROC_KSTACK_SIZE] __attribute__((aligned(PROC_KSTACK_SIZE)));
+
+static uint32_t proc_free_head = PROC_NONE;
+static uint32_t proc_live = 0;
+
+/* proc_init
+ * 	Description: Chains every pid into the free list, lowest first.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Forgets every process.
+ */
+void proc_init(void)
+{
+    uint32_t pid;
+
+    for(pid = PROC_MAX; pid > 0; pid--)
+    {
+        proc_table[pid].state = PROC_STATE_FREE;
+        proc_table[pid].page_table = 0;
+        proc_table[pid].next_free = (pid == PROC_MAX) ? PROC_NONE : pid + 1;
+    }
+    proc_free_head = 1;
+    proc_live = 0;
+}
+
+/* proc_alloc
+ * 	Description: Takes the pid at the head of the free list and a
+ *  cleared page from the frame allocator for its user page table.
+ * 	Inputs: None
+ * 	Outputs: Return the pid, PROC_NONE if pids or memory have run out
+ * 	Side Effects: Marks the pid live, NEW, on no terminal and with no
+ *  spawning parent.
+ */
+uint32_t proc_alloc(void)
+{
+    uint32_t pid = proc_free_head;
+    uint32_t table;
+
+    if(pid == PROC_NONE || (table = buddy_alloc(0)) == 0)
+    {
+        return PROC_NONE;
+    }
+    memset((void*)table, 0, BUDDY_PAGE_SIZE);
+
+    proc_free_head = proc_table[pid].next_free;
+    proc_table[pid].page_table = table;
+    proc_table[pid].pcb = NULL;
+    proc_table[pid].state = PROC_STATE_NEW;
+    proc_table[pid].next_free = PROC_NONE;
+    proc_table[pid].status = 0;
+    proc_table[pid].terminal = 0;
+    proc_table[pid].spawned = 0;
+    proc_table[pid].parent = PROC_NONE;
+    proc_live++;
+
+    return pid;
+}
+
+/* proc_free
+ * 	Description: Puts a pid back at the head of the free list, so the
+ *  stack that was used last is used next, returns its user pages and
+ *  page table to the frame allocator and frees its PCB.
+ * 	Inputs: pid
+ * 	Outputs: None
+ * 	Side Effects: None for a pid that is not live. The table may still
+ *  be mapped; nothing may allocate frames before it is replaced.
+ */
+void proc_free(uint32_t pid)
+{
+    if(!proc_used(pid))
+    {
+        return;
+    }
+
+    paging_user_free(proc_table[pid].page_table);
+    buddy_free(proc_table[pid].page_table, 0);
+    proc_table[pid].page_table = 0;
+    kfree(proc_table[pid].pcb);
+    proc_table[pid].pcb = NULL;
+
+    proc_table[pid].state = PROC_STATE_FREE;
+    proc_table[pid].next_free = proc_free_head;
+    proc_free_head = pid;
+    proc_live--;
+}
+
+/* proc_used
+ * 	Description: Tells whether a pid belongs to a live process.
+ * 	Inputs: pid
+ * 	Outputs: Return 1 if it does, 0 otherwise
+ * 	Side Effects: None
+ */
+int32_t proc_used(uint32_t pid)
+{
+    return (pid != PROC_NONE && pid <= PROC_MAX && proc_table[pid].state != PROC_STATE_FREE);
+}
+
+/* proc_get
+ * 	Description: Finds the table entry of a pid.
+ * 	Inputs: pid
+ * 	Outputs: Return the entry, NULL if the pid is not live
+ * 	Side Effects: None
+ */
+proc_entry_t* proc_get(uint32_t pid)
+{
+    return proc_used(pid) ? &proc_table[pid] : NULL;
+}
+
+/* proc_next_runnable
+ * 	Description: Walks the table round-robin from the pid after the
+ *  given one to the first process that is READY, or that was spawned
+ *  and has not started. The given pid itself comes last.
+ * 	Inputs: pid (PROC_NONE starts at pid 1)
+ * 	Outputs: Return the pid, PROC_NONE if nothing can run
+ * 	Side Effects: None
+ */
+uint32_t proc_next_runnable(uint32_t pid)
+{
+    uint32_t i, next;
+    proc_entry_t* entry;
+
+    for(i = 1; i <= PROC_MAX; i++)
+    {
+        next = (pid + i - 1) % PROC_MAX + 1;
+        entry = &proc_table[next];
+        if(entry->state == PROC_STATE_READY || (entry->state == PROC_STATE_NEW && entry->spawned))
+        {
+            return next;
+        }
+    }
+    return PROC_NONE;
+}
+
+/* proc_orphan
+ * 	Description: Lets go of the spawned children of a process that is
+ *  going away. Children that already halted are freed; the others are
+ *  detached and free themselves when they halt.
+ * 	Inputs: pid
+ * 	Outputs: None
+ * 	Side Effects: Frees zombie children.
+ */
+void proc_orphan(uint32_t pid)
+{
+    uint32_t child;
+
+    for(child = 1; child <= PROC_MAX; child++)
+    {
+        if(proc_table[child].state == PROC_STATE_FREE || proc_table[child].parent != pid)
+        {
+            continue;
+        }
+        proc_table[child].parent = PROC_NONE;
+        if(proc_table[child].state == PROC_STATE_ZOMBIE)
+        {
+            proc_free(child);
+        }
+    }
+}
+
+/* proc_kstack
+ * 	Description: Finds the kernel stack block of a pid.
+ * 	Inputs: pid (1 to PROC_MAX)
+ * 	Outputs: Return the lowest address of the block
+ * 	Side Effects: None
+ */
+uint32_t proc_kstack(uint32_t pid)
+{
+    return (uint32_t)proc_kstacks[pid - 1];
+}
+
+/* proc_kstack_top
+ * 	Description: Finds where the kernel stack of a pid starts.
+ * 	Inputs: pid (1 to PROC_MAX)
+ * 	Outputs: Return the top word of the block
+ * 	Side Effects: None
+ */
+uint32_t proc_kstack_top(uint32_t pid)
+{
+    return proc_kstack(pid) + PROC_KSTACK_SIZE - sizeof(uint32_t);
+}
+
+/* proc_page_table
+ * 	Description: Finds the user page table of a live pid.
+ * 	Inputs: pid
+ * 	Outputs: Return its physical address
+ * 	Side Effects: None
+ */
+uint32_t proc_page_table(uint32_t pid)
+{
+    return proc_table[pid].page_table;
+}
+
+/* proc_count
+ * 	Description: Counts the live processes.
+ * 	Inputs: None
+ * 	Outputs: Return the count
+ * 	Side Effects: None
+ */
+uint32_t proc_count(void)
+{
+    return proc_live;
+}
+
+/* proc_capacity
+ * 	Description: Reports how many processes can be live at once. Memory
+ *  is no longer reserved per pid, so this is the table size.
+ * 	Inputs: None
+ * 	Outputs: Return the capacity
+ * 	Side Effects: None
+ */
+uint32_t proc_capacity(void)
+{
+    return PROC_MAX;
+}
@@ -0,0 +1,86 @@
+/*
+ * process.h
+ * The process table. Pids come from a free list; each pid owns one
+ * block of the kernel stack pool, a PCB from the pcb cache, and a page
+ * table for the user window taken from the frame allocator. The window
+ * is backed by 4 KB pages that page faults fill in, so a process holds
+ * only the memory it has touched.
+ *
+ * The scheduler runs every READY process in turn. A process inside
+ * execute is PARKED until its child halts. A spawned child runs next to
+ * its parent and, once halted, stays a ZOMBIE until the parent collects
+ * its status with waitpid; a child whose parent is gone is freed as soon
+ * as it halts. A parent blocked in waitpid is WAITING and gets no turns
+ * until one of its spawned children halts.
+ */
+
+#ifndef _PROCESS_H
+#define _PROCESS_H
+
+#include "types.h"
+
+struct pcb;
+
+/* Magic numbers */
+#define PROC_MAX            32          /* pids run from 1 to PROC_MAX */
+#define PROC_NONE           0
+#define PROC_KSTACK_SIZE    0x2000      /* kernalStackSize */
+
+/* Process states */
+#define PROC_STATE_FREE     0
+#define PROC_STATE_NEW      1   /* taken, not started yet */
+#define PROC_STATE_READY    2   /* runs in turn */
+#define PROC_STATE_PARKED   3   /* inside execute, waiting for its child */
+#define PROC_STATE_ZOMBIE   4   /* halted spawned child, status not collected */
+#define PROC_STATE_WAITING  5   /* inside waitpid, until a spawned child halts */
+
+/* One entry of the process table */
+typedef struct proc_entry
+{
+    uint32_t page_table;        /* physical address of the user window's table */
+    struct pcb* pcb;            /* set by execute or spawn */
+    int32_t status;
+    uint8_t state;
+    uint8_t next_free;
+    uint8_t terminal;
+    uint8_t spawned;
+    uint8_t parent;             /* spawning parent, PROC_NONE once it is gone */
+} proc_entry_t;
+
+/* Chain every pid into the free list */
+void proc_init(void);
+
+/* Take a pid with its kernel stack and an empty page table, PROC_NONE if none is left */
+uint32_t proc_alloc(void);
+
+/* Give a pid back with every page it holds and its PCB */
+void proc_free(uint32_t pid);
+
+/* Whether a pid is live */
+int32_t proc_used(uint32_t pid);
+
+/* The table entry of a live pid, NULL otherwise */
+proc_entry_t* proc_get(uint32_t pid);
+
+/* The next process after a pid that can be run, PROC_NONE if there is none */
+uint32_t proc_next_runnable(uint32_t pid);
+
+/* Let the spawned children of a pid go: zombies are freed, the rest detached */
+void proc_orphan(uint32_t pid);
+
+/* Bottom of the kernel stack block of a pid */
+uint32_t proc_kstack(uint32_t pid);
+
+/* First address above the kernel stack of a pid, less one word */
+uint32_t proc_kstack_top(uint32_t pid);
+
+/* Physical address of the user page table of a pid */
+uint32_t proc_page_table(uint32_t pid);
+
+/* Number of live processes */
+uint32_t proc_count(void);
+
+/* Number of processes the table can hold at once */
+uint32_t proc_capacity(void);
+
+#endif /* _PROCESS_H */
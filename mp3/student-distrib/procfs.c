@@ -0,0 +1,555 @@
+#include "types.h"
+#include "lib.h"
+#include "x86_desc.h"
+#include "syscall.h"
+#include "filesystem.h"
+#include "paging.h"
+#include "scheduler.h"
+#include "idt_exceptions.h"
+#include "process.h"
+#include "buddy.h"
+#include "kmalloc.h"
+#include "procfs.h"
+
+static void procfs_render_ps(void);
+static void procfs_render_term(void);
+static void procfs_render_mem(void);
+static void procfs_render_irq(void);
+static void procfs_render_slab(void);
+
+/* Operations of the files and of the directory */
+static file_operations_table_pointer_t procfs_file_operations_table = {&procfs_read, &procfs_write, &procfs_open, &procfs_close, &procfs_stat, NULL};
+static file_operations_table_pointer_t procfs_dir_operations_table = {&procfs_dir_read, &procfs_write, &procfs_open, &procfs_close, &procfs_dir_stat, &procfs_dir_getdents};
+
+/* The files, in listing order */
+static procfs_node_t procfs_nodes[] =
+{
+    {"ps", &procfs_render_ps},
+    {"term", &procfs_render_term},
+    {"mem", &procfs_render_mem},
+    {"irq", &procfs_render_irq},
+    {"slab", &procfs_render_slab},
+};
+
+#define PROCFS_COUNT (sizeof(procfs_nodes) / sizeof(procfs_node_t))
+
+/* Names of the exceptions Intel defines, by vector */
+static const int8_t* procfs_vector_names[] =
+{
+    "divide error", "debug", "nmi", "breakpoint", "overflow", "bound range",
+    "invalid opcode", "no fpu", "double fault", "fpu segment", "invalid tss",
+    "no segment", "stack fault", "protection", "page fault", "assertion",
+    "fpu error", "alignment", "machine check", "simd",
+};
+
+#define PROCFS_EXCEPTION_NAMES (sizeof(procfs_vector_names) / sizeof(int8_t*))
+
+/* Names never change */
+static uint32_t procfs_generation = 0;
+
+vfs_backend_t procfs_backend = {&procfs_lookup, NULL, &procfs_generation};
+
+/* Text of the file being read, rendered again for every read */
+static uint8_t procfs_text[PROCFS_BUF_SIZE];
+static uint32_t procfs_length;
+
+/* procfs_putsn
+ * 	Description: Appends a string to the text, dropping what does not fit.
+ * 	Inputs: s, max (most bytes to take from s)
+ * 	Outputs: None
+ * 	Side Effects: Grows procfs_text
+ */
+static void procfs_putsn(const int8_t* s, uint32_t max)
+{
+    uint32_t i;
+
+    for(i = 0; i < max && s[i] != '\0' && procfs_length < PROCFS_BUF_SIZE; i++)
+    {
+        procfs_text[procfs_length++] = s[i];
+    }
+}
+
+/* procfs_puts
+ * 	Description: Appends a NUL-terminated string to the text.
+ * 	Inputs: s
+ * 	Outputs: None
+ * 	Side Effects: Grows procfs_text
+ */
+static void procfs_puts(const int8_t* s)
+{
+    procfs_putsn(s, PROCFS_BUF_SIZE);
+}
+
+/* procfs_putn
+ * 	Description: Appends a decimal number, right-aligned in a field.
+ * 	Inputs: n, width
+ * 	Outputs: None
+ * 	Side Effects: Grows procfs_text
+ */
+static void procfs_putn(uint32_t n, uint32_t width)
+{
+    int8_t num[PROCFS_NUM_LEN];
+    uint32_t length;
+
+    itoa(n, num, 10);
+    for(length = strlen(num); length < width; length++)
+    {
+        procfs_puts(" ");
+    }
+    procfs_puts(num);
+}
+
+/* procfs_puthex
+ * 	Description: Appends a 32-bit value as 0x and eight hex digits.
+ * 	Inputs: n
+ * 	Outputs: None
+ * 	Side Effects: Grows procfs_text
+ */
+static void procfs_puthex(uint32_t n)
+{
+    int8_t num[PROCFS_NUM_LEN];
+    uint32_t length;
+
+    itoa(n, num, 16);
+    procfs_puts("0x");
+    for(length = strlen(num); length < PROCFS_HEX_DIGITS; length++)
+    {
+        procfs_puts("0");
+    }
+    procfs_puts(num);
+}
+
+/* Names of the process states, indexed by state */
+static const int8_t* procfs_states[] = {"  free   ", "  new    ", "  ready  ", "  parked ", "  zombie ", "  wait   "};
+
+/* procfs_render_ps
+ * 	Description: Renders the process table: pid, parent, terminal,
+ *  state, name and arguments. A foreground process is marked with a
+ *  '*' after its state.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Fills procfs_text
+ */
+static void procfs_render_ps(void)
+{
+    uint32_t pid;
+    pcb_t* pcb;
+    proc_entry_t* entry;
+
+    procfs_puts("   PID  PPID  TERM  STATE   NAME\n");
+    for(pid = 1; pid <= PROC_MAX; pid++)
+    {
+        entry = proc_get(pid);
+        if(entry == NULL || entry->pcb == NULL)
+        {
+            continue;
+        }
+        pcb = entry->pcb;
+
+        procfs_putn(pid, PROCFS_COLUMN);
+        procfs_putn(entry->spawned ? entry->parent : pcb->parent_pid, PROCFS_COLUMN);
+        procfs_putn(entry->terminal, PROCFS_COLUMN);
+        procfs_puts(procfs_states[entry->state]);
+        procfs_puts(sched_pid[entry->terminal] == pid ? "*" : " ");
+        procfs_putsn((int8_t *)pcb->name, PCB_NAME_LEN);
+        if(pcb->argsflag)
+        {
+            procfs_puts(" ");
+            procfs_putsn((int8_t *)pcb->argbuf, keyBufferSize);
+        }
+        procfs_puts("\n");
+    }
+}
+
+/* procfs_render_term
+ * 	Description: Renders each terminal: whether it is shown, its cursor,
+ *  the bytes waiting in its key buffer and the pid it schedules.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Fills procfs_text
+ */
+static void procfs_render_term(void)
+{
+    uint32_t i, keys;
+
+    procfs_puts("  TERM  SHOWN   ROW   COL  KEYS   PID\n");
+    for(i = 0; i < NUM_TERM; i++)
+    {
+        for(keys = 0; keys < sizeof(term_arr[i].keyBuf) && term_arr[i].keyBuf[keys] != '\0'; keys++);
+
+        procfs_putn(i, PROCFS_COLUMN);
+        procfs_puts(i == curr_terminal ? "    yes" : "     no");
+        procfs_putn(term_arr[i].screen_y, PROCFS_COLUMN);
+        procfs_putn(term_arr[i].screen_x, PROCFS_COLUMN);
+        procfs_putn(keys, PROCFS_COLUMN);
+        procfs_putn(sched_pid[i], PROCFS_COLUMN);
+        procfs_puts("\n");
+    }
+}
+
+/* procfs_render_mem
+ * 	Description: Renders every present page-directory entry with the
+ *  memory it maps, then the totals, the state of the frame allocator
+ *  and the pages page faults filled in.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Fills procfs_text
+ */
+static void procfs_render_mem(void)
+{
+    uint32_t i, present = 0, large = 0;
+
+    procfs_puts("   PDE  VIRTUAL     PHYSICAL    SIZE  FLAGS\n");
+    for(i = 0; i < PAGING_SIZE; i++)
+    {
+        if(!page_dir[i].present_entry)
+        {
+            continue;
+        }
+        present++;
+
+        procfs_putn(i, PROCFS_COLUMN);
+        procfs_puts("  ");
+        procfs_puthex(i << SHIFT2);
+        procfs_puts("  ");
+        if(page_dir[i].ps_entry)
+        {
+            large++;
+            procfs_puthex(page_dir[i].page_table_base_addr_entry << SHIFT2);
+            procfs_puts("  4M    ");
+        }
+        else
+        {
+            procfs_puthex(page_dir[i].page_table_base_addr_pte << SHIFT1);
+            procfs_puts("  table ");
+        }
+        procfs_puts(page_dir[i].user_entry ? "u" : "-");
+        procfs_puts(page_dir[i].read_write_entry ? "w" : "-");
+        procfs_puts("\n");
+    }
+
+    procfs_puts("present ");
+    procfs_putn(present, 0);
+    procfs_puts(" of ");
+    procfs_putn(PAGING_SIZE, 0);
+    procfs_puts(", 4M pages ");
+    procfs_putn(large, 0);
+    procfs_puts(", processes ");
+    procfs_putn(proc_count(), 0);
+    procfs_puts(" of ");
+    procfs_putn(proc_capacity(), 0);
+    procfs_puts("\n");
+
+    procfs_puts("frames free ");
+    procfs_putn(buddy_stats.free_pages, 0);
+    procfs_puts(" of ");
+    procfs_putn(buddy_stats.total_pages, 0);
+    procfs_puts(" pages, free blocks by order");
+    for(i = 0; i < BUDDY_ORDERS; i++)
+    {
+        procfs_puts(" ");
+        procfs_putn(buddy_stats.free_blocks[i], 0);
+    }
+    procfs_puts("\n");
+
+    procfs_puts("faulted in ");
+    procfs_putn(demand_stats.file_pages, 0);
+    procfs_puts(" file pages, ");
+    procfs_putn(demand_stats.zero_pages, 0);
+    procfs_puts(" zero pages, ");
+    procfs_putn(demand_stats.failures, 0);
+    procfs_puts(" refused\n");
+}
+
+/* procfs_render_irq
+ * 	Description: Renders the count of every vector do_irq has
+ *  dispatched at least once, and the system call total.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Fills procfs_text
+ */
+static void procfs_render_irq(void)
+{
+    uint32_t i, calls = 0;
+
+    procfs_puts("   VEC       COUNT  NAME\n");
+    for(i = 0; i < NUM_VEC; i++)
+    {
+        if(irq_counts[i] == 0)
+        {
+            continue;
+        }
+        procfs_putn(i, PROCFS_COLUMN);
+        procfs_putn(irq_counts[i], PROCFS_WIDE_COLUMN);
+        procfs_puts("  ");
+        if(i < PROCFS_EXCEPTION_NAMES)
+        {
+            procfs_puts(procfs_vector_names[i]);
+        }
+        else if(i == pitHex)
+        {
+            procfs_puts("pit");
+        }
+        else if(i == keyboardHex)
+        {
+            procfs_puts("keyboard");
+        }
+        else if(i == rtcHex)
+        {
+            procfs_puts("rtc");
+        }
+        else if(i == ataHex)
+        {
+            procfs_puts("ata");
+        }
+        procfs_puts("\n");
+    }
+
+    for(i = 0; i <= SYSCALL_MAX; i++)
+    {
+        calls += syscall_counts[i];
+    }
+    procfs_putn(syscallHex, PROCFS_COLUMN);
+    procfs_putn(calls, PROCFS_WIDE_COLUMN);
+    procfs_puts("  system calls\n");
+}
+
+/* procfs_render_slab
+ * 	Description: Renders every slab cache that has grown: its object
+ *  size, objects in use and held, slabs and counters, then the blocks
+ *  kmalloc took as whole pages.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Fills procfs_text
+ */
+static void procfs_render_slab(void)
+{
+    kmem_cache_t* cache;
+
+    procfs_puts("  SIZE  ACTIVE   TOTAL SLABS      ALLOCS       FREES  FAIL  CACHE\n");
+    for(cache = kmem_caches; cache != NULL; cache = cache->next_cache)
+    {
+        procfs_putn(cache->size, PROCFS_COLUMN);
+        procfs_putn(cache->active, PROCFS_SLAB_COLUMN);
+        procfs_putn(cache->slabs * cache->per_slab, PROCFS_SLAB_COLUMN);
+        procfs_putn(cache->slabs, PROCFS_COLUMN);
+        procfs_putn(cache->allocs, PROCFS_WIDE_COLUMN);
+        procfs_putn(cache->frees, PROCFS_WIDE_COLUMN);
+        procfs_putn(cache->failures, PROCFS_COLUMN);
+        procfs_puts("  ");
+        procfs_puts(cache->name);
+        procfs_puts("\n");
+    }
+
+    procfs_puts("large: ");
+    procfs_putn(kmem_large_stats.allocs - kmem_large_stats.frees, 0);
+    procfs_puts(" blocks in ");
+    procfs_putn(kmem_large_stats.pages, 0);
+    procfs_puts(" pages, ");
+    procfs_putn(kmem_large_stats.allocs, 0);
+    procfs_puts(" allocs, ");
+    procfs_putn(kmem_large_stats.frees, 0);
+    procfs_puts(" frees, ");
+    procfs_putn(kmem_large_stats.failures, 0);
+    procfs_puts(" failures, ");
+    procfs_putn(kmem_large_stats.bad_frees, 0);
+    procfs_puts(" bad frees\n");
+}
+
+/* procfs_render
+ * 	Description: Renders the current text of a file.
+ * 	Inputs: inode
+ * 	Outputs: Return 0, -1 if the inode is not a file
+ * 	Side Effects: Replaces procfs_text
+ */
+static int32_t procfs_render(uint32_t inode)
+{
+    if(inode == VFS_ROOT_INODE || inode > PROCFS_COUNT)
+    {
+        return -1;
+    }
+    procfs_length = 0;
+    procfs_nodes[inode - 1].render();
+    return 0;
+}
+
+/* procfs_lookup
+ * 	Description: Finds a file by its name.
+ * 	Inputs: path (relative to /proc), node
+ * 	Outputs: Return 0, -1 if there is no such file
+ * 	Side Effects: Fills node, except for the mount.
+ */
+int32_t procfs_lookup(const uint8_t* path, vnode_t* node)
+{
+    uint32_t i;
+
+    if(*path == '\0')
+    {
+        node->inode = VFS_ROOT_INODE;
+        node->type = STAT_TYPE_DIRECTORY;
+        node->ops = &procfs_dir_operations_table;
+        return 0;
+    }
+
+    for(i = 0; i < PROCFS_COUNT; i++)
+    {
+        if(strncmp((int8_t *)path, procfs_nodes[i].name, PROCFS_NAME_LEN) == 0)
+        {
+            node->inode = i + 1;
+            node->type = STAT_TYPE_REGULAR;
+            node->ops = &procfs_file_operations_table;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* procfs_read
+ * 	Description: Renders a file and copies out the part at the offset.
+ *  A file read in pieces may change between the pieces.
+ * 	Inputs: inode, offset, buf, length
+ * 	Outputs: Return number of bytes read, -1 on a bad inode
+ * 	Side Effects: Fills buf
+ */
+int32_t procfs_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+{
+    if(buf == NULL || procfs_render(inode) == -1)
+    {
+        return -1;
+    }
+    if(offset >= procfs_length)
+    {
+        return 0;
+    }
+    if(length > procfs_length - offset)
+    {
+        length = procfs_length - offset;
+    }
+    memcpy(buf, procfs_text + offset, length);
+    return length;
+}
+
+/* procfs_write
+ * 	Description: Nothing in /proc can be written or created.
+ * 	Inputs: fd, buf, nbytes
+ * 	Outputs: Return -1
+ * 	Side Effects: None
+ */
+int32_t procfs_write(int32_t fd, const void* buf, int32_t nbytes)
+{
+    return -1;
+}
+
+/* procfs_open
+ * 	Description: Opens a file or the directory. Neither keeps per-open
+ *  state, so it does nothing.
+ * 	Inputs: filename
+ * 	Outputs: Return 0
+ * 	Side Effects: None
+ */
+int32_t procfs_open(const uint8_t* filename)
+{
+    return 0;
+}
+
+/* procfs_close
+ * 	Description: Closes a file or the directory. Neither keeps per-open
+ *  state, so it does nothing.
+ * 	Inputs: fd
+ * 	Outputs: Return 0
+ * 	Side Effects: None
+ */
+int32_t procfs_close(int32_t fd)
+{
+    return 0;
+}
+
+/* procfs_stat
+ * 	Description: Reports a file as regular, sized by rendering it now.
+ * 	Inputs: inode, buf
+ * 	Outputs: Return 0, -1 on a bad inode
+ * 	Side Effects: Fills buf
+ */
+int32_t procfs_stat(uint32_t inode, stat_t* buf)
+{
+    if(procfs_render(inode) == -1)
+    {
+        return -1;
+    }
+    buf->filetype = STAT_TYPE_REGULAR;
+    buf->inode = inode;
+    buf->size = procfs_length;
+    buf->blocks = 0;
+    return 0;
+}
+
+/* procfs_dir_read
+ * 	Description: Reads the file names, one per FILENAME_LEN bytes,
+ *  like directory_read.
+ * 	Inputs: inode, offset, buf, length
+ * 	Outputs: Return number of bytes read
+ * 	Side Effects: Fills buf
+ */
+int32_t procfs_dir_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+{
+    uint32_t done = 0;
+    uint32_t span, data;
+    uint8_t name[PROCFS_NAME_LEN];
+
+    while(done < length && offset / FILENAME_LEN < PROCFS_COUNT)
+    {
+        memset(name, 0, PROCFS_NAME_LEN);
+        strncpy((int8_t *)name, procfs_nodes[offset / FILENAME_LEN].name, PROCFS_NAME_LEN);
+        data = offset % FILENAME_LEN;
+        span = FILENAME_LEN - data;
+        if(span > length - done)
+        {
+            span = length - done;
+        }
+        memcpy(buf + done, name + data, span);
+        done += span;
+        offset += span;
+    }
+
+    return done;
+}
+
+/* procfs_dir_stat
+ * 	Description: Reports the directory type and the size of its name
+ *  listing.
+ * 	Inputs: inode, buf
+ * 	Outputs: Return 0
+ * 	Side Effects: Fills buf
+ */
+int32_t procfs_dir_stat(uint32_t inode, stat_t* buf)
+{
+    buf->filetype = STAT_TYPE_DIRECTORY;
+    buf->inode = inode;
+    buf->size = PROCFS_COUNT * FILENAME_LEN;
+    buf->blocks = 0;
+    return 0;
+}
+
+/* procfs_dir_getdents
+ * 	Description: Fills records for the files starting at an index. The
+ *  sizes are left 0, since rendering every file to list them would
+ *  cost more than the listing.
+ * 	Inputs: inode, index, buf, count (records that fit in the buffer)
+ * 	Outputs: Return number of records filled
+ * 	Side Effects: Fills buf
+ */
+int32_t procfs_dir_getdents(uint32_t inode, uint32_t index, struct dirent* buf, uint32_t count)
+{
+    uint32_t i;
+
+    for(i = 0; i < count && index + i < PROCFS_COUNT; i++)
+    {
+        memset(buf[i].name, 0, FILENAME_LEN);
+        strncpy((int8_t *)buf[i].name, procfs_nodes[index + i].name, FILENAME_LEN);
+        buf[i].filetype = STAT_TYPE_REGULAR;
+        buf[i].inode = index + i + 1;
+        buf[i].size = 0;
+    }
+
+    return i;
+}
@@ -0,0 +1,61 @@
+/*
+ * procfs.h
+ * Process filesystem, mounted on /proc. Its files are read-only text
+ * rendered from kernel state each time they are read or stat'ed: the
+ * process table, the terminals, the page directory, the interrupt
+ * counts and the kernel heap caches. Inode 0 is the directory, file i
+ * is inode i + 1.
+ */
+
+#ifndef _PROCFS_H
+#define _PROCFS_H
+
+#include "types.h"
+#include "vfs.h"
+
+/* Magic numbers */
+#define PROCFS_NAME_LEN     32
+#define PROCFS_BUF_SIZE     4096
+#define PROCFS_NUM_LEN      12
+#define PROCFS_HEX_DIGITS   8
+#define PROCFS_COLUMN       6
+#define PROCFS_WIDE_COLUMN  12
+#define PROCFS_SLAB_COLUMN  8
+
+/* One file and the function that renders it */
+typedef struct procfs_node
+{
+    const int8_t* name;
+    void (* render)(void);
+} procfs_node_t;
+
+extern vfs_backend_t procfs_backend;
+
+/* Find a file by name, "" for the directory */
+int32_t procfs_lookup(const uint8_t* path, vnode_t* node);
+
+/* Read the current text of a file */
+int32_t procfs_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+
+/* The files cannot be written */
+int32_t procfs_write(int32_t fd, const void* buf, int32_t nbytes);
+
+/* Does nothing but still returns a value */
+int32_t procfs_open(const uint8_t* filename);
+
+/* Does nothing but still returns a value */
+int32_t procfs_close(int32_t fd);
+
+/* Report the length of the current text of a file */
+int32_t procfs_stat(uint32_t inode, stat_t* buf);
+
+/* List the file names, FILENAME_LEN bytes each */
+int32_t procfs_dir_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+
+/* Report the directory type and the size of its name listing */
+int32_t procfs_dir_stat(uint32_t inode, stat_t* buf);
+
+/* Fill records for the files starting at an index */
+int32_t procfs_dir_getdents(uint32_t inode, uint32_t index, struct dirent* buf, uint32_t count);
+
+#endif /* _PROCFS_H */
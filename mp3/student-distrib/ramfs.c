@@ -0,0 +1,468 @@
+#include "types.h"
+#include "lib.h"
+#include "syscall.h"
+#include "filesystem.h"
+#include "ramfs.h"
+
+/* Operations of the files and of the directory */
+static file_operations_table_pointer_t ramfs_file_operations_table = {&ramfs_read, &ramfs_write, &ramfs_open, &ramfs_close, &ramfs_stat, NULL};
+static file_operations_table_pointer_t ramfs_dir_operations_table = {&ramfs_dir_read, &ramfs_dir_write, &ramfs_open, &ramfs_close, &ramfs_dir_stat, &ramfs_dir_getdents};
+
+/* The directory, by slot */
+static ramfs_file_t ramfs_files[RAMFS_MAX_FILES];
+
+/* Data blocks shared by every file */
+static uint8_t ramfs_pool[RAMFS_BLOCKS][RAMFS_BLOCK_SIZE];
+static uint8_t ramfs_pool_used[RAMFS_BLOCKS];
+
+/* Bumped whenever a file is removed */
+static uint32_t ramfs_generation = 0;
+
+vfs_backend_t ramfs_backend = {&ramfs_lookup, &ramfs_unlink, &ramfs_generation};
+
+/* ramfs_init
+ * 	Description: Empties the directory and the block pool.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Forgets every file.
+ */
+void ramfs_init()
+{
+    memset(ramfs_files, 0, sizeof(ramfs_files));
+    memset(ramfs_pool_used, 0, sizeof(ramfs_pool_used));
+    ramfs_generation++;
+}
+
+/* ramfs_find
+ * 	Description: Finds the slot of a file by name.
+ * 	Inputs: name, length
+ * 	Outputs: Return the slot, -1 if there is no such file
+ * 	Side Effects: None
+ */
+static int32_t ramfs_find(const uint8_t* name, uint32_t length)
+{
+    int32_t i;
+
+    if(length == 0 || length > RAMFS_NAME_LEN)
+    {
+        return -1;
+    }
+
+    for(i = 0; i < RAMFS_MAX_FILES; i++)
+    {
+        if(ramfs_files[i].used && strncmp((int8_t *)ramfs_files[i].name, (int8_t *)name, length) == 0 &&
+           (length == RAMFS_NAME_LEN || ramfs_files[i].name[length] == '\0'))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* ramfs_nth
+ * 	Description: Finds the slot of the file at a listing index. The
+ *  listing skips free slots.
+ * 	Inputs: index
+ * 	Outputs: Return the slot, -1 past the end of the listing
+ * 	Side Effects: None
+ */
+static int32_t ramfs_nth(uint32_t index)
+{
+    int32_t i;
+
+    for(i = 0; i < RAMFS_MAX_FILES; i++)
+    {
+        if(ramfs_files[i].used)
+        {
+            if(index == 0)
+            {
+                return i;
+            }
+            index--;
+        }
+    }
+    return -1;
+}
+
+/* ramfs_file
+ * 	Description: Gets the file an inode number names.
+ * 	Inputs: inode
+ * 	Outputs: Return the file, NULL for the directory or a free slot
+ * 	Side Effects: None
+ */
+static ramfs_file_t* ramfs_file(uint32_t inode)
+{
+    if(inode == VFS_ROOT_INODE || inode > RAMFS_MAX_FILES || !ramfs_files[inode - 1].used)
+    {
+        return NULL;
+    }
+    return &ramfs_files[inode - 1];
+}
+
+/* ramfs_block_alloc
+ * 	Description: Takes a zeroed block from the pool.
+ * 	Inputs: None
+ * 	Outputs: Return the block number, RAMFS_NO_BLOCK when the pool is empty
+ * 	Side Effects: Marks the block used
+ */
+static int32_t ramfs_block_alloc()
+{
+    int32_t i;
+
+    for(i = 0; i < RAMFS_BLOCKS; i++)
+    {
+        if(!ramfs_pool_used[i])
+        {
+            ramfs_pool_used[i] = 1;
+            memset(ramfs_pool[i], 0, RAMFS_BLOCK_SIZE);
+            return i;
+        }
+    }
+    return RAMFS_NO_BLOCK;
+}
+
+/* ramfs_lookup
+ * 	Description: Finds a file by its name.
+ * 	Inputs: path (relative to /tmp), node
+ * 	Outputs: Return 0, -1 if there is no such file
+ * 	Side Effects: Fills node, except for the mount.
+ */
+int32_t ramfs_lookup(const uint8_t* path, vnode_t* node)
+{
+    int32_t slot;
+
+    if(*path == '\0')
+    {
+        node->inode = VFS_ROOT_INODE;
+        node->type = STAT_TYPE_DIRECTORY;
+        node->ops = &ramfs_dir_operations_table;
+        return 0;
+    }
+
+    slot = ramfs_find(path, strlen((int8_t *)path));
+    if(slot == -1)
+    {
+        return -1;
+    }
+    node->inode = slot + 1;
+    node->type = STAT_TYPE_REGULAR;
+    node->ops = &ramfs_file_operations_table;
+    return 0;
+}
+
+/* ramfs_unlink
+ * 	Description: Removes a file and returns its blocks to the pool.
+ * 	Inputs: path (relative to /tmp)
+ * 	Outputs: Return 0, -1 if there is no such file
+ * 	Side Effects: Bumps the generation, so cached paths are dropped.
+ */
+int32_t ramfs_unlink(const uint8_t* path)
+{
+    int32_t slot, i;
+    ramfs_file_t* file;
+
+    slot = ramfs_find(path, strlen((int8_t *)path));
+    if(slot == -1)
+    {
+        return -1;
+    }
+    file = &ramfs_files[slot];
+
+    for(i = 0; i < RAMFS_FILE_BLOCKS; i++)
+    {
+        if(file->blocks[i] != RAMFS_NO_BLOCK)
+        {
+            ramfs_pool_used[file->blocks[i]] = 0;
+        }
+    }
+    file->used = 0;
+    ramfs_generation++;
+    return 0;
+}
+
+/* ramfs_read
+ * 	Description: Reads a file given its inode. Blocks a write skipped
+ *  over by seeking past the end were never allocated and read as zeros.
+ * 	Inputs: inode, offset, buf, length
+ * 	Outputs: Return number of bytes read, -1 on a bad inode
+ * 	Side Effects: Fills buf
+ */
+int32_t ramfs_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+{
+    uint32_t done = 0;
+    uint32_t span, data;
+    ramfs_file_t* file = ramfs_file(inode);
+
+    if(file == NULL || buf == NULL)
+    {
+        return -1;
+    }
+    if(offset >= file->length)
+    {
+        return 0;
+    }
+    if(length > file->length - offset)
+    {
+        length = file->length - offset;
+    }
+
+    while(done < length)
+    {
+        data = offset % RAMFS_BLOCK_SIZE;
+        span = RAMFS_BLOCK_SIZE - data;
+        if(span > length - done)
+        {
+            span = length - done;
+        }
+        if(file->blocks[offset / RAMFS_BLOCK_SIZE] == RAMFS_NO_BLOCK)
+        {
+            memset(buf + done, 0, span);
+        }
+        else
+        {
+            memcpy(buf + done, ramfs_pool[file->blocks[offset / RAMFS_BLOCK_SIZE]] + data, span);
+        }
+        done += span;
+        offset += span;
+    }
+
+    return done;
+}
+
+/* ramfs_write
+ * 	Description: Writes a file at the position of its descriptor,
+ *  taking blocks from the pool as the file grows. Stops early when the
+ *  file or the pool is full.
+ * 	Inputs: fd, buf, nbytes
+ * 	Outputs: Return number of bytes written, -1 if none could be
+ * 	Side Effects: Advances the descriptor's position
+ */
+int32_t ramfs_write(int32_t fd, const void* buf, int32_t nbytes)
+{
+    uint32_t done = 0;
+    uint32_t span, data, offset, index;
+    file_descriptor_t* desc;
+    ramfs_file_t* file;
+
+    if(pcb_current == NULL || buf == NULL || nbytes < 0)
+    {
+        return -1;
+    }
+    desc = pcb_current->pcb_arr[fd];
+    file = ramfs_file(desc->inode);
+    if(file == NULL)
+    {
+        return -1;
+    }
+
+    offset = desc->file_position;
+    while(done < (uint32_t)nbytes)
+    {
+        index = offset / RAMFS_BLOCK_SIZE;
+        if(index >= RAMFS_FILE_BLOCKS)
+        {
+            break;
+        }
+        if(file->blocks[index] == RAMFS_NO_BLOCK)
+        {
+            file->blocks[index] = ramfs_block_alloc();
+            if(file->blocks[index] == RAMFS_NO_BLOCK)
+            {
+                break;
+            }
+        }
+
+        data = offset % RAMFS_BLOCK_SIZE;
+        span = RAMFS_BLOCK_SIZE - data;
+        if(span > nbytes - done)
+        {
+            span = nbytes - done;
+        }
+        memcpy(ramfs_pool[file->blocks[index]] + data, (const uint8_t *)buf + done, span);
+        done += span;
+        offset += span;
+    }
+
+    if(done == 0 && nbytes > 0)
+    {
+        return -1;
+    }
+    if(offset > file->length)
+    {
+        file->length = offset;
+    }
+    desc->file_position = offset;
+    return done;
+}
+
+/* ramfs_open
+ * 	Description: Opens a file or the directory. Neither keeps per-open
+ *  state, so it does nothing.
+ * 	Inputs: filename
+ * 	Outputs: Return 0
+ * 	Side Effects: None
+ */
+int32_t ramfs_open(const uint8_t* filename)
+{
+    return 0;
+}
+
+/* ramfs_close
+ * 	Description: Closes a file or the directory. Neither keeps per-open
+ *  state, so it does nothing.
+ * 	Inputs: fd
+ * 	Outputs: Return 0
+ * 	Side Effects: None
+ */
+int32_t ramfs_close(int32_t fd)
+{
+    return 0;
+}
+
+/* ramfs_stat
+ * 	Description: Reports the length and block count of a file.
+ * 	Inputs: inode, buf
+ * 	Outputs: Return 0, -1 on a bad inode
+ * 	Side Effects: Fills buf
+ */
+int32_t ramfs_stat(uint32_t inode, stat_t* buf)
+{
+    uint32_t i;
+    ramfs_file_t* file = ramfs_file(inode);
+
+    if(file == NULL)
+    {
+        return -1;
+    }
+
+    buf->filetype = STAT_TYPE_REGULAR;
+    buf->inode = inode;
+    buf->size = file->length;
+    buf->blocks = 0;
+    for(i = 0; i < RAMFS_FILE_BLOCKS; i++)
+    {
+        if(file->blocks[i] != RAMFS_NO_BLOCK)
+        {
+            buf->blocks++;
+        }
+    }
+    return 0;
+}
+
+/* ramfs_dir_read
+ * 	Description: Reads the file names, one per FILENAME_LEN bytes,
+ *  like directory_read.
+ * 	Inputs: inode, offset, buf, length
+ * 	Outputs: Return number of bytes read
+ * 	Side Effects: Fills buf
+ */
+int32_t ramfs_dir_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+{
+    uint32_t done = 0;
+    uint32_t span, data;
+    int32_t slot;
+
+    while(done < length && (slot = ramfs_nth(offset / FILENAME_LEN)) != -1)
+    {
+        data = offset % FILENAME_LEN;
+        span = FILENAME_LEN - data;
+        if(span > length - done)
+        {
+            span = length - done;
+        }
+        memcpy(buf + done, ramfs_files[slot].name + data, span);
+        done += span;
+        offset += span;
+    }
+
+    return done;
+}
+
+/* ramfs_dir_write
+ * 	Description: Writing a name to the directory creates an empty file
+ *  with that name. There are no subdirectories.
+ * 	Inputs: fd, buf (the name), nbytes (length of the name)
+ * 	Outputs: Return nbytes on success, -1 on failure
+ * 	Side Effects: Takes a slot of the directory
+ */
+int32_t ramfs_dir_write(int32_t fd, const void* buf, int32_t nbytes)
+{
+    int32_t i, slot;
+    const uint8_t* name = (const uint8_t *)buf;
+
+    if(buf == NULL || nbytes <= 0 || nbytes > RAMFS_NAME_LEN || ramfs_find(name, nbytes) != -1)
+    {
+        return -1;
+    }
+    for(i = 0; i < nbytes; i++)
+    {
+        if(name[i] == VFS_SEPARATOR || name[i] == '\0')
+        {
+            return -1;
+        }
+    }
+
+    for(slot = 0; slot < RAMFS_MAX_FILES; slot++)
+    {
+        if(!ramfs_files[slot].used)
+        {
+            memset(ramfs_files[slot].name, 0, RAMFS_NAME_LEN);
+            memcpy(ramfs_files[slot].name, name, nbytes);
+            ramfs_files[slot].length = 0;
+            for(i = 0; i < RAMFS_FILE_BLOCKS; i++)
+            {
+                ramfs_files[slot].blocks[i] = RAMFS_NO_BLOCK;
+            }
+            ramfs_files[slot].used = 1;
+            return nbytes;
+        }
+    }
+    return -1;
+}
+
+/* ramfs_dir_stat
+ * 	Description: Reports the directory type and the size of its name
+ *  listing.
+ * 	Inputs: inode, buf
+ * 	Outputs: Return 0
+ * 	Side Effects: Fills buf
+ */
+int32_t ramfs_dir_stat(uint32_t inode, stat_t* buf)
+{
+    uint32_t i;
+
+    buf->filetype = STAT_TYPE_DIRECTORY;
+    buf->inode = inode;
+    buf->size = 0;
+    buf->blocks = 0;
+    for(i = 0; i < RAMFS_MAX_FILES; i++)
+    {
+        if(ramfs_files[i].used)
+        {
+            buf->size += FILENAME_LEN;
+        }
+    }
+    return 0;
+}
+
+/* ramfs_dir_getdents
+ * 	Description: Fills records for the files starting at an index.
+ * 	Inputs: inode, index, buf, count (records that fit in the buffer)
+ * 	Outputs: Return number of records filled
+ * 	Side Effects: Fills buf
+ */
+int32_t ramfs_dir_getdents(uint32_t inode, uint32_t index, struct dirent* buf, uint32_t count)
+{
+    uint32_t i;
+    int32_t slot;
+
+    for(i = 0; i < count && (slot = ramfs_nth(index + i)) != -1; i++)
+    {
+        memcpy(buf[i].name, ramfs_files[slot].name, FILENAME_LEN);
+        buf[i].filetype = FILE_TYPE_REGULAR;
+        buf[i].inode = slot + 1;
+        buf[i].size = ramfs_files[slot].length;
+    }
+
+    return i;
+}
@@ -0,0 +1,70 @@
+/*
+ * ramfs.h
+ * RAM filesystem, mounted on /tmp. A flat directory of up to
+ * RAMFS_MAX_FILES files whose data lives in a static pool of blocks,
+ * so nothing written here reaches the image or the disk. Inode 0 is
+ * the directory, the file in slot i is inode i + 1.
+ */
+
+#ifndef _RAMFS_H
+#define _RAMFS_H
+
+#include "types.h"
+#include "vfs.h"
+
+/* Magic numbers */
+#define RAMFS_MAX_FILES     16
+#define RAMFS_BLOCKS        32
+#define RAMFS_FILE_BLOCKS   16
+#define RAMFS_BLOCK_SIZE    4096
+#define RAMFS_NAME_LEN      32
+#define RAMFS_NO_BLOCK      -1
+
+/* One file; the name is not NUL terminated when it uses every byte */
+typedef struct ramfs_file
+{
+    uint8_t name[RAMFS_NAME_LEN];
+    uint32_t used;
+    uint32_t length;
+    int32_t blocks[RAMFS_FILE_BLOCKS];
+} ramfs_file_t;
+
+extern vfs_backend_t ramfs_backend;
+
+/* Empty the directory and the block pool */
+void ramfs_init();
+
+/* Find a file by name, "" for the directory */
+int32_t ramfs_lookup(const uint8_t* path, vnode_t* node);
+
+/* Remove a file and free its blocks */
+int32_t ramfs_unlink(const uint8_t* path);
+
+/* Read a file */
+int32_t ramfs_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+
+/* Write a file at the descriptor's position */
+int32_t ramfs_write(int32_t fd, const void* buf, int32_t nbytes);
+
+/* Does nothing but still returns a value */
+int32_t ramfs_open(const uint8_t* filename);
+
+/* Does nothing but still returns a value */
+int32_t ramfs_close(int32_t fd);
+
+/* Report the length and block count of a file */
+int32_t ramfs_stat(uint32_t inode, stat_t* buf);
+
+/* List the file names, RAMFS_NAME_LEN bytes each */
+int32_t ramfs_dir_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+
+/* Create an empty file with the name written */
+int32_t ramfs_dir_write(int32_t fd, const void* buf, int32_t nbytes);
+
+/* Report the directory type and the size of its name listing */
+int32_t ramfs_dir_stat(uint32_t inode, stat_t* buf);
+
+/* Fill records for the files starting at an index */
+int32_t ramfs_dir_getdents(uint32_t inode, uint32_t index, struct dirent* buf, uint32_t count);
+
+#endif /* _RAMFS_H */
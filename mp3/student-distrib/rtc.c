@@ -197,3 +197,20 @@ int rtc_close(int32_t fd)
 {
     return 0;
 }
+
+/* 
+ *  rtc_stat
+ *   DESCRIPTION: Stat functionality for RTC
+ *   INPUTS: inode, buf
+ *   OUTPUTS: the RTC type with no size
+ *   RETURN VALUE: 0
+ *   SIDE EFFECTS: Fills buf
+ */
+int rtc_stat(uint32_t inode, stat_t* buf)
+{
+    buf->filetype = STAT_TYPE_RTC;
+    buf->inode = inode;
+    buf->size = 0;
+    buf->blocks = 0;
+    return 0;
+}
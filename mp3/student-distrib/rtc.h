@@ -2,6 +2,7 @@
 #define _RTC_H
 
 #include "types.h"
+#include "stat.h"
 
 /* Ports and register values */
 #define RTC_PORT 0x70
@@ -43,5 +44,7 @@ int rtc_read(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
 int rtc_write(int32_t fd, const void* buffer, int32_t bytes);
 /* Close functionality */
 int rtc_close(int32_t fd);
+/* Stat function for RTC */
+int rtc_stat(uint32_t inode, stat_t* buf);
 
 #endif /* _RTC_H */
@@ -7,6 +7,8 @@
 #include "keyboard.h"
 #include "lib.h"
 #include "rtc.h"
+#include "mmap.h"
+#include "process.h"
 
 int32_t video_addr[4] = {VIDEO_MEM + 1 * KB_4, VIDEO_MEM + 2 * KB_4, VIDEO_MEM + 3 * KB_4, VIDEO_MEM};
 volatile uint8_t sched_pid[NUM_TERM] = {0, 0, 0};
@@ -54,16 +56,17 @@ void pit_interrupt_handler()
 void scheduler()
 {
     pcb_t *next_pcb, *cur_pcb;
-    uint32_t next_process;
+    uint32_t next_process, next_pid;
+    proc_entry_t* next_entry;
     int32_t cur_kesp, cur_kebp, next_kesp, next_kebp;
     
     if(sched_pid[0] == 0)
     {
-        sched_pid[0] = 1;
+        sched_pid[0] = proc_alloc();
         video_mem = (char *) video_addr[0];
 
-        next_kesp = bottomKernal - 4;
-        next_kebp = bottomKernal - 4;
+        next_kesp = proc_kstack_top(sched_pid[0]);
+        next_kebp = proc_kstack_top(sched_pid[0]);
 
         asm volatile(
             "movl %0, %%esp;"
@@ -83,22 +86,27 @@ void scheduler()
         : "=r" (cur_kesp), "=r" (cur_kebp)
     );
 
-    cur_pcb = (pcb_t*)(bottomKernal - (sched_pid[curr_process]) * kernalStackSize);
-    cur_pcb->esp = cur_kesp;
-    cur_pcb->ebp = cur_kebp;
+    /* a process that halted with nobody to wait for it has no PCB left */
+    cur_pcb = pcb_current;
+    if(cur_pcb != NULL)
+    {
+        cur_pcb->esp = cur_kesp;
+        cur_pcb->ebp = cur_kebp;
+    }
 
     next_process = (curr_process + 1) % 3;
     video_mem = (char*) video_addr[next_process];
 
     if(sched_pid[next_process] == 0)
     {
-        sched_pid[next_process] = sched_pid[curr_process] + 1;
+        /* the base shells come up in terminal order, so they hold pids 1 to 3 */
+        sched_pid[next_process] = proc_alloc();
         curr_process = next_process;
 
         video_mem = (char*)video_addr[curr_process];
 
-        next_kesp = bottomKernal - (sched_pid[next_process]) * kernalStackSize - 4;
-        next_kebp = bottomKernal - (sched_pid[next_process]) * kernalStackSize - 4;
+        next_kesp = proc_kstack_top(sched_pid[next_process]);
+        next_kebp = proc_kstack_top(sched_pid[next_process]);
         scheduler_remap_video(next_process);
 
         asm volatile(
@@ -113,30 +121,49 @@ void scheduler()
         return;
     }
 
-    curr_process = next_process;
+    /* once the base shells are up, every runnable process gets a turn */
+    next_pid = proc_next_runnable(cur_pcb != NULL ? cur_pcb->pid : PROC_NONE);
+    if(next_pid == PROC_NONE)
+    {
+        video_mem = (char*) video_addr[curr_process];
+        sti();
+        return;
+    }
+    next_entry = proc_get(next_pid);
+    curr_process = next_entry->terminal;
 
     video_mem = (char*) video_addr[curr_process];
-    next_pcb = (pcb_t*)(bottomKernal - (sched_pid[next_process]) * kernalStackSize);
+    next_pcb = next_entry->pcb;
     pcb_current = next_pcb;
 
     tss.ss0 = KERNEL_DS;
-    tss.esp0 = bottomKernal - (sched_pid[next_process] - 1) * kernalStackSize - 4;
+    tss.esp0 = proc_kstack_top(next_pid);
 
-    if (sched_pid[0] == 4 && cur_pcb->kesp <= 0x7f8f00) {
-        cur_pcb->kesp = 0;
-    }
-    
-    page_dir[pageDirIndex].hex = 0;
-    page_dir[pageDirIndex].page_table_base_addr_entry = (bottomKernal + (next_pcb->pid - 1) * pageSize) >> shiftCount;
-    page_dir[pageDirIndex].present_entry = 1;
-    page_dir[pageDirIndex].read_write_entry = 1;
-    page_dir[pageDirIndex].ps_entry = 1;
-    page_dir[pageDirIndex].user_entry = 1;
+    paging_map_user(proc_page_table(next_pid));
+    mmap_install(next_pid - 1);
 
     load_pde((uint32_t)page_dir);
     flush_tlb();
 
-    scheduler_remap_video(next_process);
+    scheduler_remap_video(curr_process);
+
+    /* a spawned process that has not run yet starts on an empty stack */
+    if(next_entry->state == PROC_STATE_NEW)
+    {
+        next_kesp = proc_kstack_top(next_pid);
+        next_kebp = proc_kstack_top(next_pid);
+
+        asm volatile(
+            "movl %0, %%esp;"
+            "movl %1, %%ebp;"
+            :
+            : "r" (next_kesp), "r" (next_kebp)
+
+        );
+
+        spawn_enter();
+        return;
+    }
     
     asm volatile(
         "movl %0, %%esp;"
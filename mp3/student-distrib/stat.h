@@ -0,0 +1,28 @@
+/*
+ * stat.h
+ * The record filled in by stat and fstat. Each file type fills it
+ * through the stat hook of its operations table.
+ */
+
+#ifndef _STAT_H
+#define _STAT_H
+
+#include "types.h"
+
+/* File types, the same values as the dentry filetype, plus the terminal and the memory devices */
+#define STAT_TYPE_RTC 0
+#define STAT_TYPE_DIRECTORY 1
+#define STAT_TYPE_REGULAR 2
+#define STAT_TYPE_TERMINAL 3
+#define STAT_TYPE_CHARDEV 4
+
+/* Information about an open or named file */
+typedef struct stat
+{
+    uint32_t filetype;
+    uint32_t inode;
+    uint32_t size;
+    uint32_t blocks;
+} stat_t;
+
+#endif /* _STAT_H */
@@ -7,28 +7,47 @@
 #include "paging.h"
 #include "x86_desc.h"
 #include "scheduler.h"
+#include "exec_cache.h"
+#include "mmap.h"
+#include "ata.h"
+#include "bcache.h"
+#include "vfs.h"
+#include "process.h"
+#include "kmalloc.h"
 
 extern int32_t execute(const uint8_t* command);
 
-/* Keeping count of how many programs are running to make sure we don't exceed */
-uint8_t program_count = 0;
+/* A program checked by program_find and ready to load */
+typedef struct program
+{
+    dentry_t dentry;
+    exec_cache_entry_t* cached;
+    int32_t warm;
+    uint32_t eip;
+    uint32_t length;             // bytes of the file, mapped from virtualAddr
+    uint8_t args[keyBufferSize];
+    int32_t args_flag;
+} program_t;
+
+/* Current pcb pointer */
+pcb_t *pcb_current = NULL;
 
-/* Temporary getargs flag (checks if arguments are present or not) */
-int args_flag = 0;
+/* Per-call counters bumped by sysc, indexed by call number */
+uint32_t syscall_counts[SYSCALL_MAX + 1];
 
-uint8_t pid_arr[programMax] = {0, 0, 0, 0, 0, 0};
+/* Pages the page fault handler filled in */
+demand_stats_t demand_stats;
 
-/* fops variable for all the file types */
-file_operations_table_pointer_t filesystem_operations_table = {&file_read, &file_write, &file_open, &file_close};
-file_operations_table_pointer_t directory_operations_table = {&directory_read, &directory_write, &directory_open, &directory_close};
-file_operations_table_pointer_t terminal_operations_table = {&terminal_read, &terminal_write, &terminal_open, &terminal_close};
-file_operations_table_pointer_t rtc_operations_table = {&rtc_read, &rtc_write, &rtc_open, &rtc_close};
+/* Slab caches of the PCBs and of the open files */
+static kmem_cache_t pcb_cache = KMEM_CACHE("pcb", sizeof(pcb_t));
+static kmem_cache_t fd_cache = KMEM_CACHE("file", sizeof(file_descriptor_t));
 
-/* Current pcb pointer */
-pcb_t *pcb_current = NULL;
+static int32_t fd_inherit(pcb_t* pcb, pcb_t* parent);
 
 /* halt_handler
- * 	Description: Halts the program that is executing
+ * 	Description: Halts the program that is executing. A program started
+ *  by execute returns to its parent; a spawned one stays behind for
+ *  waitpid and gives the processor to the next process
  * 	Inputs: status
  * 	Outputs: 0 on success -1 on failure
  * 	Side Effects:
@@ -40,40 +59,15 @@ int32_t halt_handler(uint8_t status)
 
     uint32_t ebp_parent;
     uint32_t esp_parent;
+    uint32_t pid = pcb_current->pid;
+    proc_entry_t* entry = proc_get(pid);
 
-    /* if only three shells are open, then pass */
-    if(pcb_current->pid <= 3)
+    /* the base shells hold the first pids and never exit */
+    if(pid <= NUM_TERM)
     {
         printf("Can't exit base shell!");
         return 0;
     }
-    /* otherwise decrement program count and current display pid*/
-    else
-    {
-        pid_arr[pcb_current->pid - 1] = 0;
-        sched_pid[curr_process] = pcb_current->parent_pid;
-        program_count--;
-    }
-
-    /* get the parent esp and parent ebp */
-    ebp_parent = pcb_current->parent_pcb->ebp;
-    esp_parent = pcb_current->parent_pcb->esp;
-
-    /* restore parent paging */
-    page_dir[pageDirIndex].hex = 0;
-    page_dir[pageDirIndex].page_table_base_addr_entry = (bottomKernal + (pcb_current->parent_pid - 1) * pageSize) >> shiftCount;
-    page_dir[pageDirIndex].present_entry = 1;
-    page_dir[pageDirIndex].read_write_entry = 1;
-    page_dir[pageDirIndex].ps_entry = 1;
-    page_dir[pageDirIndex].user_entry = 1;
-
-    /* load page and flush tlb */
-    load_pde((uint32_t)page_dir);
-    flush_tlb();
-
-    /* restore parent data */
-    tss.ss0 = KERNEL_DS;
-    tss.esp0 = pcb_current->parent_pcb->esp;
 
     /* clear out the argbuf */
     int i;
@@ -85,16 +79,66 @@ int32_t halt_handler(uint8_t status)
     /* set argbuf flag to low */
     pcb_current->argsflag = 0;
 
-    /* close handlers */
-    close_handler(2);
-    close_handler(3);
-    close_handler(4);
-    close_handler(5);
-    close_handler(6);
-    close_handler(7);
+    /* close every descriptor, stdin and stdout included */
+    pcb_close_all();
+
+    /* drop the file mappings and the program file, and let go of any
+     * spawned children */
+    mmap_release(pid - 1);
+    vfs_unpin_run(VFS_IMAGE_MOUNT, pcb_current->image_inode);
+    proc_orphan(pid);
+
+    if (entry->spawned)
+    {
+        /* the parent collects the status; with no parent nobody will */
+        if (entry->parent != PROC_NONE)
+        {
+            entry->state = PROC_STATE_ZOMBIE;
+            entry->status = status;
+
+            /* wake the parent if it sleeps in waitpid */
+            if (proc_get(entry->parent)->state == PROC_STATE_WAITING)
+            {
+                proc_get(entry->parent)->state = PROC_STATE_READY;
+            }
+        }
+        else
+        {
+            /* the PCB goes with the pid, so the scheduler has nothing to save into */
+            pcb_current = NULL;
+            proc_free(pid);
+        }
+
+        /* switch away for good; nothing ever switches back to this pid */
+        scheduler();
+        return 0;
+    }
 
-    /* restore parent pcb */
+    /* restore parent pcb, then give the pid and its PCB back; the stack
+     * stays intact until the next execute or spawn */
     pcb_current = pcb_current->parent_pcb;
+    proc_free(pid);
+    proc_get(pcb_current->pid)->state = PROC_STATE_READY;
+    if (sched_pid[curr_process] == pid)
+    {
+        sched_pid[curr_process] = pcb_current->pid;
+    }
+
+    /* get the esp and ebp the parent left in execute */
+    ebp_parent = pcb_current->exec_ebp;
+    esp_parent = pcb_current->exec_esp;
+
+    /* restore parent paging */
+    paging_map_user(proc_page_table(pcb_current->pid));
+    mmap_install(pcb_current->pid - 1);
+
+    /* load page and flush tlb */
+    load_pde((uint32_t)page_dir);
+    flush_tlb();
+
+    /* restore parent data */
+    tss.ss0 = KERNEL_DS;
+    tss.esp0 = proc_kstack_top(pcb_current->pid);
 
     /* jump back to syscall linkage and also enable interrupts */
     asm volatile(
@@ -112,39 +156,28 @@ int32_t halt_handler(uint8_t status)
     return 0;
 }
 
-/* execute_handler
- * 	Description: execute the program given command
- * 	Inputs: command
+/* program_find
+ * 	Description: splits a command into the program name and its
+ *  arguments, and checks that the program can run
+ * 	Inputs: command, prog
  * 	Outputs: 0 on success -1 on failure
- * 	Side Effects:
+ * 	Side Effects: fills prog
  */
-int32_t execute_handler(const uint8_t *command)
+static int32_t program_find(const uint8_t *command, program_t *prog)
 {
-    /* start of critical section */
-    cli();
-
     int i;                       // Variable to iterate through command
     int j;                       // Variable to iterate through args
     uint8_t exec[keyBufferSize]; // First word in command, file name of program to be executed
-    uint8_t args[keyBufferSize]; // should be provided to the new program on request via the getargs system call.
-    dentry_t dentry;             // Executable file
     uint8_t entryBuf[byte4];     // EIP byte by byte
-    uint32_t EIP;                // EIP
-    EIP = 0x0;
-
-    /* Start of sanity check */
+    stat_t st;                   // Size of the executable
 
     /* clear out argument buffer */
     for (i = 0; i < keyBufferSize; i++)
     {
-        args[i] = '\0';
-    }
-
-    /* Check to make sure not too many programs are executing */
-    if (program_count >= programMax)
-    {
-        return -1;
+        prog->args[i] = '\0';
     }
+    prog->args_flag = 0;
+    prog->eip = 0x0;
 
     /* NULL check for command */
     if (command == NULL)
@@ -159,7 +192,7 @@ int32_t execute_handler(const uint8_t *command)
     }
 
     /* Parsing executable name */
-    for (i = 0; command[i] != NULL; i++)
+    for (i = 0; command[i] != NULL && i < keyBufferSize - 1; i++)
     {
         if (command[i] == ' ' || command[i] == '\n')
         {
@@ -177,34 +210,49 @@ int32_t execute_handler(const uint8_t *command)
     /* copy command arguments into temporary argbuf */
     for (j = 0; command[i] != '\0' && i < maxInputLength; j++)
     {
-        args[j] = command[i];
+        prog->args[j] = command[i];
         i++;
     }
 
     /* find out if there is an argument */
     for (i = 0; i < keyBufferSize; i++)
     {
-        if (args[i] != '\0')
+        if (prog->args[i] != '\0')
         {
-            args_flag = 1;
+            prog->args_flag = 1;
             break;
         }
     }
 
     /* if the last character is overwritten, set flag to 0 */
-    if (args[keyBufferSize - 1] != '\0')
+    if (prog->args[keyBufferSize - 1] != '\0')
     {
-        args_flag = 0;
+        prog->args_flag = 0;
     }
 
     /* Verify executable is present */
-    if (read_dentry_by_name(exec, &dentry) == -1)
+    if (read_dentry_by_name(exec, &prog->dentry) == -1)
+    {
+        return -1;
+    }
+
+    /* Only regular files that fit between the load address and the end of the user window can run */
+    if (prog->dentry.filetype != FILE_TYPE_REGULAR || file_stat(prog->dentry.inode_num, &st) == -1 || st.size > programRoom)
     {
         return -1;
     }
 
+    /* Cached images already carry a validated entry point */
+    prog->cached = exec_cache_get(prog->dentry.inode_num, &prog->warm);
+    if (prog->cached != NULL)
+    {
+        prog->eip = prog->cached->entry;
+        prog->length = st.size;
+        return 0;
+    }
+
     /* Make sure file is executable and load EIP, just using exec as a placeholder */
-    read_data(dentry.inode_num, 0, exec, 4);
+    read_data(prog->dentry.inode_num, 0, exec, 4);
 
     /* Checking for executable magic numbers */
     if (exec[0] != exe0 || exec[1] != exe1 || exec[2] != exe2 || exec[3] != exe3)
@@ -213,152 +261,265 @@ int32_t execute_handler(const uint8_t *command)
     }
 
     /* Load program, get executable EIP */
-    read_data(dentry.inode_num, offset_24, entryBuf, byte4);
+    read_data(prog->dentry.inode_num, offset_24, entryBuf, byte4);
 
     for (i = 0; i < byte4; i++)
     {
-        EIP |= entryBuf[i] << (i * maskCount);
+        prog->eip |= entryBuf[i] << (i * maskCount);
     }
 
-    int temp, slot;
-    for(temp = 0; temp < programMax; temp++)
+    prog->length = st.size;
+    return 0;
+}
+
+/* pcb_setup
+ * 	Description: takes a PCB for a new process from the pcb cache and
+ *  fills it from its program
+ * 	Inputs: pid, parent (NULL for a base shell, which is its own parent), prog
+ * 	Outputs: return the PCB, NULL if memory or pins ran out
+ * 	Side Effects: the process table entry keeps the PCB, and proc_free
+ *  gives it back. A child shares every open file of its parent. The
+ *  program file can be neither unlinked nor written until halt
+ */
+static pcb_t* pcb_setup(uint32_t pid, pcb_t *parent, program_t *prog)
+{
+    int i;
+    pcb_t* pcb = kmem_cache_alloc(&pcb_cache);
+
+    if (pcb == NULL)
     {
-        if(pid_arr[temp] == 0)
-        {
-            slot = temp;
-            break;
-        }
+        return NULL;
     }
 
-    /* Setup paging */
-    page_dir[pageDirIndex].hex = 0;
-    page_dir[pageDirIndex].page_table_base_addr_entry = (bottomKernal + slot * pageSize) >> shiftCount;
-    page_dir[pageDirIndex].present_entry = 1;
-    page_dir[pageDirIndex].read_write_entry = 1;
-    page_dir[pageDirIndex].ps_entry = 1;
-    page_dir[pageDirIndex].user_entry = 1;
+    /* nothing is open yet */
+    memset(pcb, 0, sizeof(pcb_t));
+    pcb_fd_init(pcb);
 
-    /* Load page and flush tlb */
-    load_pde((uint32_t)page_dir);
-    flush_tlb();
+    /* page faults read the program file, so it must stay unchanged until
+     * halt. Nothing points at the PCB yet, so it goes straight back */
+    if (vfs_pin_run(VFS_IMAGE_MOUNT, prog->dentry.inode_num) == -1)
+    {
+        kmem_cache_free(&pcb_cache, pcb);
+        return NULL;
+    }
+    proc_get(pid)->pcb = pcb;
 
-    /* Copy executable contents to memory offset */
-    int count = 0;
-    int bytesRead;
-    uint8_t *addr = (uint8_t *)(virtualAddr);
-    while (pageSize - count > 0)
+    /* a child starts with its parent's descriptors */
+    if (parent != NULL && fd_inherit(pcb, parent) == -1)
     {
-        bytesRead = read_data(dentry.inode_num, count, addr + count, pageSize - count);
-        if (bytesRead == 0)
-        {
-            break;
-        }
-        else if (bytesRead != -1)
-        {
-            count += bytesRead;
-        }
-        else
-        {
-            return -1;
-        }
+        vfs_unpin_run(VFS_IMAGE_MOUNT, prog->dentry.inode_num);
+        return NULL;
+    }
+
+    pcb->pid = pid;
+    pcb->kesp = proc_kstack_top(pid);
+    pcb->parent_pcb = (parent == NULL) ? pcb : parent;
+    pcb->parent_pid = pcb->parent_pcb->pid;
+    pcb->argsflag = (parent == NULL) ? 0 : prog->args_flag;
+
+    /* Copy over the argument buffer */
+    for (i = 0; i < keyBufferSize; i++)
+    {
+        pcb->argbuf[i] = prog->args[i];
     }
 
-    pcb_t* pcb_child, *pcb_parent;
-    if(program_count < 3)
+    /* keep the program name for /proc/ps, and its file for page faults */
+    memcpy(pcb->name, prog->dentry.filename, PCB_NAME_LEN);
+    pcb->image_inode = prog->dentry.inode_num;
+    pcb->image_length = prog->length;
+
+    return pcb;
+}
+
+/* page_fault_load
+ * 	Description: fills in a page of the user window the first time the
+ *  current process touches it. Pages that hold part of the program
+ *  file are copied from the cached image, or read from the file when
+ *  the image is not cached; every other page, bss and stack included,
+ *  comes zeroed
+ * 	Inputs: addr (the faulting address)
+ * 	Outputs: 0 if the page is mapped now, -1 if the address is outside
+ *  the window, already mapped or memory ran out
+ * 	Side Effects: takes a frame from the frame allocator
+ */
+int32_t page_fault_load(uint32_t addr)
+{
+    pte_t* pages;
+    uint32_t page, offset, length;
+    uint8_t* frame;
+    exec_cache_entry_t* cached;
+
+    if (pcb_current == NULL || addr < MB_128 || addr >= MB_128 + pageSize || !proc_used(pcb_current->pid))
     {
-        /* bookkeeping: increment
-        * our number of processes, get current esp and ebp,
-        * and set the current pcb pointer */
+        demand_stats.failures++;
+        return -1;
+    }
 
-        uint32_t ebp;
-        uint32_t esp;
-        
-        asm volatile(
-            "movl %%esp, %0;"
-            "movl %%ebp, %1;"
-            : "=r"(esp), "=r"(ebp));
+    pages = (pte_t *)proc_page_table(pcb_current->pid);
+    page = (addr - MB_128) >> SHIFT1;
+    if (pages[page].present_pte || paging_user_alloc((uint32_t)pages, page, 1) == -1)
+    {
+        demand_stats.failures++;
+        return -1;
+    }
 
-        /* set up PCB */
-        pcb_child = (pcb_t *)(bottomKernal - (program_count + 1) * kernalStackSize);
-        pcb_parent = pcb_child;
+    /* the frame is reached through the kernel's one to one map */
+    addr &= ~(four_kb - 1);
+    if (addr < virtualAddr || addr - virtualAddr >= pcb_current->image_length)
+    {
+        demand_stats.zero_pages++;
+        return 0;
+    }
 
-        program_count++;
-        pcb_child->pid = program_count;
-        pcb_child->parent_pid = program_count;
-        pcb_child->kesp = bottomKernal - (kernalStackSize * (pcb_child->pid - 1)) - 4;
-        pcb_child->parent_pcb = pcb_parent;
-        pcb_child->esp = esp;
-        pcb_child->ebp = ebp;
-        pcb_child->argsflag = 0;
+    frame = (uint8_t *)(pages[page].page_table_base_addr_pte << SHIFT1);
+    offset = addr - virtualAddr;
+    length = pcb_current->image_length - offset;
+    length = (length > four_kb) ? four_kb : length;
 
-        pid_arr[pcb_child->pid - 1] = 1;
-        sched_pid[program_count - 1] = pcb_child->pid;
+    cached = exec_cache_lookup(pcb_current->image_inode);
+    if (cached != NULL && offset + length <= cached->length)
+    {
+        memcpy(frame, cached->image + offset, length);
     }
-    else
+    else if (read_data(pcb_current->image_inode, offset, frame, length) == -1)
+    {
+        demand_stats.failures++;
+        return -1;
+    }
+
+    demand_stats.file_pages++;
+    return 0;
+}
+
+/* user_prefault
+ * 	Description: fills in the pages of a user buffer before a handler
+ *  copies between it and a file, so the copy cannot fault into the
+ *  filesystem while it holds one of its buffers
+ * 	Inputs: buf, nbytes
+ * 	Outputs: none
+ * 	Side Effects: may map pages; addresses outside the window are left alone
+ */
+static void user_prefault(const void *buf, int32_t nbytes)
+{
+    uint32_t addr = (uint32_t)buf & ~(four_kb - 1);
+    uint32_t end = (uint32_t)buf + nbytes;
+    pte_t* pages;
+
+    if (nbytes <= 0 || pcb_current == NULL || !proc_used(pcb_current->pid))
     {
-        /* bookkeeping: increment
-        * our number of processes, get current esp and ebp,
-        * and set the current pcb pointer */
+        return;
+    }
 
-        for(temp = 0; temp < programMax; temp++)
+    pages = (pte_t *)proc_page_table(pcb_current->pid);
+    addr = (addr < MB_128) ? MB_128 : addr;
+    for (; addr < end && addr >= MB_128 && addr < MB_128 + pageSize; addr += four_kb)
+    {
+        if (!pages[(addr - MB_128) >> SHIFT1].present_pte)
         {
-            if(pid_arr[temp] == 0)
-            {
-                slot = temp;
-                break;
-            }
+            page_fault_load(addr);
+        }
+    }
+}
+
+/* execute_handler
+ * 	Description: execute the program given command
+ * 	Inputs: command
+ * 	Outputs: 0 on success -1 on failure
+ * 	Side Effects:
+ */
+int32_t execute_handler(const uint8_t *command)
+{
+    /* start of critical section */
+    cli();
+
+    program_t prog;              // Program to run, with its arguments
+    uint32_t pid;                // Pid of the new process
+    pcb_t* pcb_child;            // PCB of the new process
+    proc_entry_t* entry;         // Table entry of the new process
+
+    /* Start of sanity check */
+    if (program_find(command, &prog) == -1)
+    {
+        return -1;
+    }
+
+    /* the scheduler reserves the pid of a base shell before starting it on that pid's stack */
+    entry = proc_get(sched_pid[curr_process]);
+    int32_t base = (entry != NULL && entry->state == PROC_STATE_NEW && !entry->spawned);
+    if (base)
+    {
+        pid = sched_pid[curr_process];
+    }
+    else if ((pid = proc_alloc()) == PROC_NONE)
+    {
+        return -1;
+    }
+
+    /* set up the PCB of the new process */
+    if ((pcb_child = pcb_setup(pid, base ? NULL : pcb_current, &prog)) == NULL)
+    {
+        if (!base)
+        {
+            proc_free(pid);
         }
+        return -1;
+    }
+
+    /* Setup paging; the program comes in a page at a time as it faults */
+    paging_map_user(proc_page_table(pid));
+    mmap_install(pid - 1);
+
+    /* Load page and flush tlb */
+    load_pde((uint32_t)page_dir);
+    flush_tlb();
 
+    entry = proc_get(pid);
+    entry->state = PROC_STATE_READY;
+    entry->terminal = curr_process;
+
+    if (!base)
+    {
+        /* park the parent here until the child halts */
         uint32_t ebp;
         uint32_t esp;
-        
+
         asm volatile(
             "movl %%esp, %0;"
             "movl %%ebp, %1;"
             : "=r"(esp), "=r"(ebp));
-        
-        /* set up PCB */
-        pcb_child = (pcb_t *)(bottomKernal - (slot + 1) * kernalStackSize);
-        pcb_parent = pcb_current;
-
-        pcb_child->pid = slot + 1;
-
-        program_count++;
-
-        pcb_child->parent_pid = pcb_current->pid;
 
-        pcb_child->kesp = bottomKernal - (kernalStackSize * (pcb_child->pid - 1)) - 4;
-        pcb_child->parent_pcb = pcb_parent;
-        pcb_child->esp = esp;
-        pcb_child->ebp = ebp;
-        pcb_child->argsflag = args_flag;
+        pcb_current->exec_esp = esp;
+        pcb_current->exec_ebp = ebp;
+        proc_get(pcb_current->pid)->state = PROC_STATE_PARKED;
 
-        pid_arr[slot] = 1;
-        sched_pid[curr_terminal] = pcb_child->pid;
-    }
-
-    /* Copy over the argument buffer */
-    for (i = 0; i < keyBufferSize; i++)
-    {
-        pcb_child->argbuf[i] = args[i];
+        /* only a foreground program hands its terminal to the child */
+        if (sched_pid[curr_process] == pcb_current->pid)
+        {
+            sched_pid[curr_process] = pid;
+        }
     }
 
     pcb_current = pcb_child;
 
-    /* open stdin and stdout */
-    open_handler((uint8_t *)"stdin");
-    open_handler((uint8_t *)"stdout");
+    /* a base shell opens stdin and stdout; anything else inherited them */
+    if (base)
+    {
+        open_stdio();
+    }
 
     /* Context switch to user program */
     pcb_current->ss0 = tss.ss0;
     pcb_current->esp0 = tss.esp0;
 
     tss.ss0 = KERNEL_DS;
-    tss.esp0 = MB_8 - ((slot) * KB_8) - 4;
+    tss.esp0 = proc_kstack_top(pid);
 
     /* end of critical section */
     sti();
 
+    /* count the cycles from the execute trap up to the iret */
+    exec_stats_record(prog.warm);
+
     /* push IRET context, IRET, and return */
     asm volatile(
         "pushl %0;"
@@ -369,11 +530,27 @@ int32_t execute_handler(const uint8_t *command)
         "iret;"
         "sys_execute_return:;"
         :
-        : "r"(USER_DS), "r"(userCount), "r"(USER_CS), "r"(EIP));
+        : "r"(USER_DS), "r"(userCount), "r"(USER_CS), "r"(prog.eip));
 
     return 0;
 }
 
+/* fd_get
+ * 	Description: finds the open file behind a descriptor of the current
+ *  process
+ * 	Inputs: fd
+ * 	Outputs: return the open file, NULL if fd is out of range or closed
+ * 	Side Effects: none
+ */
+static file_descriptor_t* fd_get(int32_t fd)
+{
+    if (pcb_current == NULL || fd < fdMin || fd >= (int32_t)pcb_current->fd_count)
+    {
+        return NULL;
+    }
+    return pcb_current->pcb_arr[fd];
+}
+
 /* read_handler
  * 	Description: Reads command that was given as input
  * 	Inputs: fd, buf, nbytes
@@ -382,37 +559,25 @@ int32_t execute_handler(const uint8_t *command)
  */
 int32_t read_handler(int32_t fd, void *buf, int32_t nbytes)
 {
-    /* if any invalid fd, return -1 */
-    if (buf == NULL || fd < fdMin || fd > fdMax)
-    {
-        return -1;
-    }
+    int32_t ret;
+    file_descriptor_t* file = fd_get(fd);
 
-    /* if fd is stdout, return -1 */
-    if (fd == fdMin + 1)
+    /* if any invalid fd, or fd is stdout, return -1 */
+    if (buf == NULL || fd == fdMin + 1 || file == NULL)
     {
         return -1;
     }
 
-    /* if valid fd, then check if being used */
-    if (pcb_current->pcb_arr[fd].flags == 1)
+    user_prefault(buf, nbytes);
+
+    /* stdin may have been redirected to a file, so every descriptor
+     * reads at its position; the terminal ignores it */
+    ret = file->operations_pointer->read_ptr(file->inode, file->file_position, buf, (uint32_t)nbytes);
+    if (ret > 0)
     {
-        /* if being used, return the read handler for that fd */
-        if (fd == 0)
-        {
-            return pcb_current->pcb_arr[fd].operations_pointer.read_ptr((uint32_t)fd, 0, buf, (uint32_t)nbytes);
-        }
-        else
-        {
-            int ret;
-            ret = pcb_current->pcb_arr[fd].operations_pointer.read_ptr(pcb_current->pcb_arr[fd].inode, pcb_current->pcb_arr[fd].file_position, buf, (uint32_t)nbytes);
-            pcb_current->pcb_arr[fd].file_position += ret;
-            return ret;
-        }
+        file->file_position += ret;
     }
-
-    /* else, return -1 */
-    return -1;
+    return ret;
 }
 
 /* write_handler
@@ -424,122 +589,283 @@ int32_t read_handler(int32_t fd, void *buf, int32_t nbytes)
 int32_t write_handler(int32_t fd, const void *buf, int32_t nbytes)
 {
     /* if any invalid fd, return -1 */
-    if (buf == NULL || fd <= fdMin || fd > fdMax)
+    if (buf == NULL || fd <= fdMin || fd_get(fd) == NULL)
     {
         return -1;
     }
 
-    /* if valid fd, check if being used */
-    if (pcb_current->pcb_arr[fd].flags == 1)
-    {
-        /* if being used, return the write handler for that fd */
-        return pcb_current->pcb_arr[fd].operations_pointer.write_ptr((uint32_t)fd, buf, (uint32_t)nbytes);
-    }
+    user_prefault(buf, nbytes);
 
-    /* else, return -1 */
-    return -1;
+    /* return the write handler for that fd */
+    return pcb_current->pcb_arr[fd]->operations_pointer->write_ptr((uint32_t)fd, buf, (uint32_t)nbytes);
 }
 
-/* open_handler
- * 	Description: open the proper file
- * 	Inputs: filename
- * 	Outputs: return proper value, -1 on failure
- * 	Side Effects:
+/* fd_grow
+ * 	Description: makes room for at least count descriptors in a PCB,
+ *  doubling its table and moving it to kmalloc memory
+ * 	Inputs: pcb, count
+ * 	Outputs: return 0 on success, -1 if count is past FD_TABLE_MAX or
+ *  memory ran out
+ * 	Side Effects: frees the old table unless it is fd_small
  */
-int32_t open_handler(const uint8_t *filename)
+static int32_t fd_grow(pcb_t* pcb, uint32_t count)
 {
-    /* start of critical section */
-    cli();
+    file_descriptor_t** table;
+    uint32_t size = pcb->fd_count;
 
-    uint32_t fd = -1;
-    dentry_t dentry;
-
-    /* check if valid filename */
-    if (filename == NULL || *filename == '\0')
+    if (count <= size)
     {
-        return fd;
+        return 0;
     }
-
-    /* if filename is stdin, initialize stdin */
-    if (strncmp((int8_t *)filename, "stdin", strlen((int8_t *)filename)) == 0)
+    if (count > FD_TABLE_MAX)
     {
-        pcb_current->pcb_arr[0].operations_pointer = terminal_operations_table;
-        //pcb_current->pcb_arr[0].operations_pointer.write_ptr = NULL;
-        pcb_current->pcb_arr[0].inode = 0;
-        pcb_current->pcb_arr[0].file_position = 0;
-        pcb_current->pcb_arr[0].flags = 1;
-        return 0;
+        return -1;
     }
-    /* if filename is stdout, initialize stdout */
-    if (strncmp((int8_t *)filename, "stdout", strlen((int8_t *)filename)) == 0)
+    while (size < count)
     {
-        pcb_current->pcb_arr[1].operations_pointer = terminal_operations_table;
-        //pcb_current->pcb_arr[1].operations_pointer.read_ptr = NULL;
-        pcb_current->pcb_arr[1].inode = 0;
-        pcb_current->pcb_arr[1].file_position = 0;
-        pcb_current->pcb_arr[1].flags = 1;
-        return 1;
+        size <<= 1;
     }
+    size = (size > FD_TABLE_MAX) ? FD_TABLE_MAX : size;
 
-    /* get the dentry by name */
-    if (read_dentry_by_name(filename, &dentry) == -1)
+    if ((table = kmalloc(size * sizeof(file_descriptor_t*))) == NULL)
     {
         return -1;
     }
+    memcpy(table, pcb->pcb_arr, pcb->fd_count * sizeof(file_descriptor_t*));
+    memset(table + pcb->fd_count, 0, (size - pcb->fd_count) * sizeof(file_descriptor_t*));
+    if (pcb->pcb_arr != pcb->fd_small)
+    {
+        kfree(pcb->pcb_arr);
+    }
+    pcb->pcb_arr = table;
+    pcb->fd_count = size;
+    return 0;
+}
 
-    /* loop through free pcb blocks */
-    int i;
-    for (i = 2; i < PCB_SIZE; i++)
+/* fd_alloc
+ * 	Description: finds the lowest closed descriptor of the current
+ *  process from first up, growing the table when every slot is open
+ * 	Inputs: first
+ * 	Outputs: return the descriptor, -1 if the table cannot grow
+ * 	Side Effects: may grow the table
+ */
+static int32_t fd_alloc(int32_t first)
+{
+    int32_t fd;
+
+    for (fd = first; fd < (int32_t)pcb_current->fd_count; fd++)
     {
-        if (pcb_current->pcb_arr[i].flags == 0)
+        if (pcb_current->pcb_arr[fd] == NULL)
         {
-            fd = i;
-            break;
+            return fd;
         }
     }
+    return (fd_grow(pcb_current, fd + 1) == -1) ? -1 : fd;
+}
+
+/* fd_release
+ * 	Description: empties a slot of the current process and drops its
+ *  reference to the open file, which unpins its inode and goes back to
+ *  the file cache when no descriptor points to it any more
+ * 	Inputs: fd (in range)
+ * 	Outputs: none
+ * 	Side Effects: none for a closed slot
+ */
+static void fd_release(int32_t fd)
+{
+    file_descriptor_t* file = pcb_current->pcb_arr[fd];
 
-    /* if no pcb block was available, return -1 */
-    if (fd == -1)
+    if (file == NULL)
     {
-        return -1;
+        return;
     }
-    else
+    pcb_current->pcb_arr[fd] = NULL;
+    if (--file->refcount == 0)
     {
-        /* mark the free block as being used and initialize accordingly */
-        pcb_current->pcb_arr[fd].file_position = 0;
-        pcb_current->pcb_arr[fd].flags = 1;
-        pcb_current->pcb_arr[fd].inode = 0;
-
-        //rtc
-        if (dentry.filetype == 0)
-        {
-            pcb_current->pcb_arr[fd].operations_pointer = rtc_operations_table;
-            pcb_current->rtc_flag = 1;
-        }
-        //directory
-        else if (dentry.filetype == 1)
-        {
-            pcb_current->pcb_arr[fd].operations_pointer = directory_operations_table;
-        }
-        //file
-        else if (dentry.filetype == 2)
-        {
-            pcb_current->pcb_arr[fd].operations_pointer = filesystem_operations_table;
-            pcb_current->pcb_arr[fd].inode = dentry.inode_num;
-        }
-        //invalid, return -1;
-        else
-        {
-            return -1;
-        }
-
-        /* in any case return the open function pointer */
-        pcb_current->pcb_arr[fd].operations_pointer.open_ptr((uint8_t *)filename);
+        vfs_unpin(file->mount, file->inode);
+        kmem_cache_free(&fd_cache, file);
     }
+}
+
+/* fd_share
+ * 	Description: points a slot of the current process at an open file,
+ *  closing what the slot held before
+ * 	Inputs: fd (in range), file
+ * 	Outputs: none
+ * 	Side Effects: takes a reference to file
+ */
+static void fd_share(int32_t fd, file_descriptor_t* file)
+{
+    file->refcount++;
+    fd_release(fd);
+    pcb_current->pcb_arr[fd] = file;
+}
+
+/* fd_install
+ * 	Description: opens a vnode on a slot as a new open file from the
+ *  file cache, closing what the slot held before
+ * 	Inputs: fd (in range), node, filename
+ * 	Outputs: return what the open function returns, -1 if memory or
+ *  pins ran out
+ * 	Side Effects: marks the descriptor used and pins the inode
+ */
+static int32_t fd_install(int32_t fd, vnode_t* node, const uint8_t* filename)
+{
+    file_descriptor_t* file;
+
+    fd_release(fd);
+    if ((file = kmem_cache_alloc(&fd_cache)) == NULL)
+    {
+        return -1;
+    }
+    if (vfs_pin(node->mount, node->inode) == -1)
+    {
+        kmem_cache_free(&fd_cache, file);
+        return -1;
+    }
+    pcb_current->pcb_arr[fd] = file;
+
+    file->operations_pointer = node->ops;
+    file->mount = node->mount;
+    file->inode = node->inode;
+    file->file_position = 0;
+    file->flags = 1;
+    file->refcount = 1;
+    if (node->type == STAT_TYPE_RTC)
+    {
+        pcb_current->rtc_flag = 1;
+    }
+
+    return file->operations_pointer->open_ptr(filename);
+}
+
+/* fd_inherit
+ * 	Description: gives a new process every descriptor of its parent,
+ *  sharing the open files and so their positions
+ * 	Inputs: pcb (with an empty table), parent
+ * 	Outputs: return 0 on success, -1 if memory ran out
+ * 	Side Effects: takes a reference to each open file of the parent
+ */
+static int32_t fd_inherit(pcb_t* pcb, pcb_t* parent)
+{
+    uint32_t fd;
+
+    if (fd_grow(pcb, parent->fd_count) == -1)
+    {
+        return -1;
+    }
+    for (fd = 0; fd < parent->fd_count; fd++)
+    {
+        if ((pcb->pcb_arr[fd] = parent->pcb_arr[fd]) != NULL)
+        {
+            pcb->pcb_arr[fd]->refcount++;
+        }
+    }
+    return 0;
+}
+
+/* pcb_fd_init
+ * 	Description: gives a cleared PCB its empty descriptor table
+ * 	Inputs: pcb
+ * 	Outputs: none
+ * 	Side Effects: none
+ */
+void pcb_fd_init(pcb_t* pcb)
+{
+    pcb->pcb_arr = pcb->fd_small;
+    pcb->fd_count = PCB_SIZE;
+}
+
+/* pcb_close_all
+ * 	Description: closes every descriptor of the current process,
+ *  stdin and stdout included, and shrinks its table back to fd_small
+ * 	Inputs: none
+ * 	Outputs: none
+ * 	Side Effects: empties the descriptor table
+ */
+void pcb_close_all(void)
+{
+    uint32_t fd;
+
+    for (fd = 0; fd < pcb_current->fd_count; fd++)
+    {
+        fd_release(fd);
+    }
+    if (pcb_current->pcb_arr != pcb_current->fd_small)
+    {
+        kfree(pcb_current->pcb_arr);
+    }
+    pcb_fd_init(pcb_current);
+}
+
+/* open_stdio
+ * 	Description: opens /dev/stdin on descriptor 0 and /dev/stdout on
+ *  descriptor 1 of the current process
+ * 	Inputs: none
+ * 	Outputs: 0 on success, -1 if the devices cannot be found
+ * 	Side Effects: replaces descriptors 0 and 1
+ */
+int32_t open_stdio(void)
+{
+    vnode_t node;
+
+    if (vfs_lookup((uint8_t *)STDIN_PATH, &node) == -1)
+    {
+        return -1;
+    }
+    fd_install(0, &node, (uint8_t *)STDIN_PATH);
+
+    if (vfs_lookup((uint8_t *)STDOUT_PATH, &node) == -1)
+    {
+        return -1;
+    }
+    fd_install(1, &node, (uint8_t *)STDOUT_PATH);
+
+    return 0;
+}
+
+/* open_handler
+ * 	Description: open the proper file
+ * 	Inputs: filename
+ * 	Outputs: return proper value, -1 on failure
+ * 	Side Effects:
+ */
+int32_t open_handler(const uint8_t *filename)
+{
+    /* start of critical section */
+    cli();
+
+    int32_t fd = -1;
+    vnode_t node;
+
+    /* check if valid filename */
+    if (filename == NULL || *filename == '\0')
+    {
+        return fd;
+    }
+
+    /* find the file through the mount it is under */
+    if (vfs_lookup(filename, &node) == -1)
+    {
+        return -1;
+    }
+
+    /* take the lowest free descriptor, growing the table if it is full */
+    if ((fd = fd_alloc(fdMin + 2)) == -1)
+    {
+        return -1;
+    }
+
+    /* mark the free block as being used and open it */
+    fd_install(fd, &node, filename);
+    if (pcb_current->pcb_arr[fd] == NULL)
+    {
+        return -1;
+    }
+
+    /* End of critical section */
+    sti();
 
-    /* End of critical section */
-    sti();
-
     /* return the valid fd */
     return fd;
 }
@@ -561,21 +887,15 @@ int32_t close_handler(int32_t fd)
         return -1;
     }
 
-    /* if any invalid fd, return -1 */
-    if (fd < fdMin + 2 || fd > fdMax)
-    {
-        return -1;
-    }
-
-    /* check if fd isn't being used */
-    if (pcb_current->pcb_arr[fd].flags == 0)
+    /* if any invalid fd or fd isn't being used, return -1 */
+    if (fd < fdMin + 2 || fd_get(fd) == NULL)
     {
         return -1;
     }
     else
     {
-        /* else set flag to 0 and return 0 */
-        pcb_current->pcb_arr[fd].flags = 0;
+        /* else drop its reference to the open file and return 0 */
+        fd_release(fd);
     }
 
     /* end critical section */
@@ -584,6 +904,57 @@ int32_t close_handler(int32_t fd)
     return 0;
 }
 
+/* dup_handler
+ * 	Description: opens a second descriptor on the open file of fd,
+ *  sharing its position
+ * 	Inputs: fd
+ * 	Outputs: return the lowest free descriptor past stdout, -1 on failure
+ * 	Side Effects: may grow the descriptor table
+ */
+int32_t dup_handler(int32_t fd)
+{
+    int32_t newfd;
+    file_descriptor_t* file;
+
+    cli();
+    if ((file = fd_get(fd)) == NULL || (newfd = fd_alloc(fdMin + 2)) == -1)
+    {
+        sti();
+        return -1;
+    }
+    fd_share(newfd, file);
+    sti();
+
+    return newfd;
+}
+
+/* dup2_handler
+ * 	Description: points newfd at the open file of oldfd, closing what
+ *  newfd held first. Any descriptor may be replaced, so stdin and
+ *  stdout can be redirected
+ * 	Inputs: oldfd, newfd
+ * 	Outputs: return newfd, -1 on failure
+ * 	Side Effects: may grow the descriptor table
+ */
+int32_t dup2_handler(int32_t oldfd, int32_t newfd)
+{
+    file_descriptor_t* file;
+
+    cli();
+    if ((file = fd_get(oldfd)) == NULL || newfd < fdMin || fd_grow(pcb_current, newfd + 1) == -1)
+    {
+        sti();
+        return -1;
+    }
+    if (newfd != oldfd)
+    {
+        fd_share(newfd, file);
+    }
+    sti();
+
+    return newfd;
+}
+
 /* getargs_handler
  * 	Description: reads the program’s command line arguments into a user-level buffer.
  * 	Inputs: buf (buffer for user-level), nbytes(bytes to be read)
@@ -660,3 +1031,635 @@ int32_t vidmap_handler(uint8_t **screen_start)
 
     return 0;
 }
+
+/* set_handler_handler
+ * 	Description: signals are not supported, so no handler can be installed
+ * 	Inputs: signum, handler_address
+ * 	Outputs: -1
+ * 	Side Effects: none
+ */
+int32_t set_handler_handler(int32_t signum, void* handler_address)
+{
+    return -1;
+}
+
+/* sigreturn_handler
+ * 	Description: signals are not supported, so there is nothing to return from
+ * 	Inputs: none
+ * 	Outputs: -1
+ * 	Side Effects: none
+ */
+int32_t sigreturn_handler(void)
+{
+    return -1;
+}
+
+/* unlink_handler
+ * 	Description: removes a regular file or an empty directory through
+ *  the filesystem mounted at its path
+ * 	Inputs: filename
+ * 	Outputs: 0 on success -1 on failure
+ * 	Side Effects: frees the file's blocks, inode and dentry
+ */
+int32_t unlink_handler(const uint8_t* filename)
+{
+    int32_t ret;
+
+    /* begin critical section */
+    cli();
+
+    ret = vfs_unlink(filename);
+
+    /* end critical section */
+    sti();
+
+    return ret;
+}
+
+/* fd_length
+ * 	Description: gets the size a seek on the descriptor is measured
+ *  against: the file length for files, the bytes of file names for
+ *  the directory
+ * 	Inputs: file (the descriptor)
+ * 	Outputs: the length, -1 if the descriptor is not seekable
+ * 	Side Effects: none
+ */
+static int32_t fd_length(file_descriptor_t* file)
+{
+    stat_t st;
+
+    /* the stat hook already reports both sizes */
+    if (file->operations_pointer->stat_ptr(file->inode, &st) == -1 ||
+        (st.filetype != STAT_TYPE_REGULAR && st.filetype != STAT_TYPE_DIRECTORY))
+    {
+        return -1;
+    }
+    return st.size;
+}
+
+/* lseek_handler
+ * 	Description: moves the position of a file or directory descriptor
+ * 	Inputs: fd, offset, whence (SEEK_SET, SEEK_CUR or SEEK_END)
+ * 	Outputs: the new position, -1 on failure
+ * 	Side Effects: changes the file position of the descriptor
+ */
+int32_t lseek_handler(int32_t fd, int32_t offset, int32_t whence)
+{
+    int32_t base, position;
+    file_descriptor_t* file;
+
+    /* only open files past stdin and stdout can seek */
+    if (fd < fdMin + 2 || (file = fd_get(fd)) == NULL)
+    {
+        return -1;
+    }
+
+    if (whence == SEEK_SET)
+    {
+        base = 0;
+    }
+    else if (whence == SEEK_CUR)
+    {
+        base = file->file_position;
+    }
+    else if (whence == SEEK_END)
+    {
+        base = fd_length(file);
+    }
+    else
+    {
+        return -1;
+    }
+
+    /* positions can go past the end but never below zero */
+    position = base + offset;
+    if (fd_length(file) == -1 || base < 0 || position < 0 || (offset > 0 && position < base))
+    {
+        return -1;
+    }
+
+    file->file_position = position;
+    return position;
+}
+
+/* pread_handler
+ * 	Description: reads from a given offset without moving the position
+ * 	Inputs: fd, buf, nbytes, offset
+ * 	Outputs: return bytes read, -1 on failure
+ * 	Side Effects: writes to buf
+ */
+int32_t pread_handler(int32_t fd, void* buf, int32_t nbytes, int32_t offset)
+{
+    file_descriptor_t* file;
+
+    /* only open, seekable descriptors can be read at an offset */
+    if (buf == NULL || nbytes < 0 || offset < 0 || fd < fdMin + 2 || (file = fd_get(fd)) == NULL)
+    {
+        return -1;
+    }
+    if (fd_length(file) == -1)
+    {
+        return -1;
+    }
+
+    user_prefault(buf, nbytes);
+    return file->operations_pointer->read_ptr(file->inode, (uint32_t)offset, buf, (uint32_t)nbytes);
+}
+
+/* getdents_handler
+ * 	Description: fills a buffer with as many directory records as fit,
+ *  starting at the position of a directory descriptor
+ * 	Inputs: fd, buf, nbytes
+ * 	Outputs: return bytes filled, 0 at the end, -1 on failure
+ * 	Side Effects: advances the position one file name per record
+ */
+int32_t getdents_handler(int32_t fd, void* buf, int32_t nbytes)
+{
+    int32_t count;
+    file_descriptor_t* file;
+
+    dirent_t probe;
+
+    /* only open directory descriptors can be listed */
+    if (buf == NULL || nbytes < 0 || fd < fdMin + 2 || (file = fd_get(fd)) == NULL ||
+        file->operations_pointer->getdents_ptr == NULL)
+    {
+        return -1;
+    }
+    user_prefault(buf, nbytes);
+
+    /* a buffer too small for one record cannot make progress */
+    count = file->operations_pointer->getdents_ptr(file->inode, file->file_position / FILENAME_LEN, (dirent_t *)buf, (uint32_t)nbytes / sizeof(dirent_t));
+    if (count == 0 && nbytes < sizeof(dirent_t) &&
+        file->operations_pointer->getdents_ptr(file->inode, file->file_position / FILENAME_LEN, &probe, 1) != 0)
+    {
+        return -1;
+    }
+
+    file->file_position = (file->file_position / FILENAME_LEN + count) * FILENAME_LEN;
+    return count * sizeof(dirent_t);
+}
+
+/* stat_handler
+ * 	Description: reports the type, inode, size and blocks of a named file
+ * 	Inputs: filename, buf
+ * 	Outputs: return 0, -1 on failure
+ * 	Side Effects: fills buf
+ */
+int32_t stat_handler(const uint8_t* filename, stat_t* buf)
+{
+    int32_t ret;
+    vnode_t node;
+
+    if (filename == NULL || buf == NULL)
+    {
+        return -1;
+    }
+
+    /* use the stat hook of the table open_handler would pick */
+    cli();
+    ret = vfs_lookup(filename, &node);
+    if (ret == 0)
+    {
+        ret = node.ops->stat_ptr(node.inode, buf);
+    }
+    sti();
+
+    return ret;
+}
+
+/* fstat_handler
+ * 	Description: reports the type, inode, size and blocks of an open file
+ * 	Inputs: fd, buf
+ * 	Outputs: return 0, -1 on failure
+ * 	Side Effects: fills buf
+ */
+int32_t fstat_handler(int32_t fd, stat_t* buf)
+{
+    file_descriptor_t* file = fd_get(fd);
+
+    if (buf == NULL || file == NULL)
+    {
+        return -1;
+    }
+
+    return file->operations_pointer->stat_ptr(file->inode, buf);
+}
+
+/* mmap_handler
+ * 	Description: maps the first length bytes of an open regular file
+ *  read-only into the caller's mapping window, without copying
+ * 	Inputs: fd, length
+ * 	Outputs: return the user address of the mapping, -1 on failure
+ * 	Side Effects: changes the caller's mapping page table
+ */
+int32_t mmap_handler(int32_t fd, int32_t length)
+{
+    int32_t ret;
+    stat_t st;
+    file_descriptor_t* file;
+
+    if (length <= 0 || fd < fdMin + 2 || (file = fd_get(fd)) == NULL)
+    {
+        return -1;
+    }
+
+    /* only regular files of the image are backed by data blocks */
+    if (file->operations_pointer->read_ptr != &file_read ||
+        file->operations_pointer->stat_ptr(file->inode, &st) == -1 || st.filetype != STAT_TYPE_REGULAR)
+    {
+        return -1;
+    }
+
+    cli();
+    ret = mmap_map(pcb_current->pid - 1, file->inode, (uint32_t)length);
+    sti();
+
+    return ret;
+}
+
+/* munmap_handler
+ * 	Description: removes the pages of a mapping made by mmap
+ * 	Inputs: addr, length
+ * 	Outputs: return 0, -1 on failure
+ * 	Side Effects: changes the caller's mapping page table
+ */
+int32_t munmap_handler(void* addr, int32_t length)
+{
+    int32_t ret;
+
+    if (length <= 0)
+    {
+        return -1;
+    }
+
+    cli();
+    ret = mmap_unmap(pcb_current->pid - 1, (uint32_t)addr, (uint32_t)length);
+    sti();
+
+    return ret;
+}
+
+/* sync_handler
+ * 	Description: writes the filesystem's changes back to the data disk
+ * 	Inputs: None
+ * 	Outputs: return 0, -1 on a disk error
+ * 	Side Effects: writes the disk when the filesystem is mounted from it
+ */
+int32_t sync_handler(void)
+{
+    int32_t ret;
+
+    cli();
+    ret = fs_sync();
+    sti();
+
+    return ret;
+}
+
+/* sendfile_handler
+ * 	Description: moves count bytes from the position of in_fd to out_fd
+ *  without a trip through user space. Image files going to a device
+ *  are handed to its write function straight from their data blocks;
+ *  everything else passes through a small buffer on the kernel stack
+ * 	Inputs: out_fd, in_fd, count
+ * 	Outputs: return bytes written to out_fd, 0 at the end of in_fd,
+ *  -1 on failure. A short write ends the copy early
+ * 	Side Effects: advances the position of in_fd by the bytes written
+ */
+int32_t sendfile_handler(int32_t out_fd, int32_t in_fd, int32_t count)
+{
+    int32_t ret;
+    uint32_t want, done = 0;
+    stat_t st;
+    file_descriptor_t* in;
+    file_descriptor_t* out;
+    uint8_t chunk[SENDFILE_CHUNK];
+
+    /* stdin reads by descriptor rather than position, so it cannot be the source */
+    if (count < 0 || in_fd < fdMin + 2 || out_fd <= fdMin ||
+        (in = fd_get(in_fd)) == NULL || (out = fd_get(out_fd)) == NULL)
+    {
+        return -1;
+    }
+
+    /* a cached disk block must not move under a write into the filesystem */
+    if (in->operations_pointer->read_ptr == &file_read &&
+        out->operations_pointer->stat_ptr(out->inode, &st) == 0 &&
+        st.filetype != STAT_TYPE_REGULAR && st.filetype != STAT_TYPE_DIRECTORY)
+    {
+        ret = send_data(in->inode, in->file_position, (uint32_t)count, out->operations_pointer->write_ptr, out_fd);
+        if (ret > 0)
+        {
+            in->file_position += ret;
+        }
+        return ret;
+    }
+
+    while (done < (uint32_t)count)
+    {
+        want = (uint32_t)count - done;
+        if (want > SENDFILE_CHUNK)
+        {
+            want = SENDFILE_CHUNK;
+        }
+        ret = in->operations_pointer->read_ptr(in->inode, in->file_position, chunk, want);
+        if (ret <= 0)
+        {
+            return (done == 0) ? ret : (int32_t)done;
+        }
+        want = ret;
+        ret = out->operations_pointer->write_ptr(out_fd, chunk, want);
+        if (ret <= 0)
+        {
+            return (done == 0) ? -1 : (int32_t)done;
+        }
+        /* bytes the writer refused stay unread in in_fd */
+        in->file_position += ret;
+        done += ret;
+        if ((uint32_t)ret < want)
+        {
+            break;
+        }
+    }
+
+    return done;
+}
+
+/* iov_check
+ * 	Description: checks a vector passed to readv or writev before any
+ *  of it is used
+ * 	Inputs: iov, iovcnt
+ * 	Outputs: return 0 if every entry is usable, -1 otherwise
+ * 	Side Effects: none
+ */
+static int32_t iov_check(const iovec_t* iov, int32_t iovcnt)
+{
+    int32_t i;
+
+    if (iov == NULL || iovcnt < 0 || iovcnt > IOV_MAX)
+    {
+        return -1;
+    }
+    for (i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_len < 0 || (iov[i].iov_base == NULL && iov[i].iov_len > 0))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* readv_handler
+ * 	Description: reads into several buffers in turn with one system
+ *  call. It stops at the first buffer that is not filled
+ * 	Inputs: fd, iov, iovcnt
+ * 	Outputs: return bytes read, -1 on failure
+ * 	Side Effects: advances the position of fd like read does
+ */
+int32_t readv_handler(int32_t fd, const iovec_t* iov, int32_t iovcnt)
+{
+    int32_t i, ret, done = 0;
+
+    if (iov_check(iov, iovcnt) == -1)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_len == 0)
+        {
+            continue;
+        }
+        ret = read_handler(fd, iov[i].iov_base, iov[i].iov_len);
+        if (ret < 0)
+        {
+            return (done == 0) ? ret : done;
+        }
+        done += ret;
+        if (ret < iov[i].iov_len)
+        {
+            break;
+        }
+    }
+
+    return done;
+}
+
+/* writev_handler
+ * 	Description: writes several buffers in turn with one system call.
+ *  The terminal takes them all in a single write
+ * 	Inputs: fd, iov, iovcnt
+ * 	Outputs: return bytes written, -1 on failure
+ * 	Side Effects: none
+ */
+int32_t writev_handler(int32_t fd, const iovec_t* iov, int32_t iovcnt)
+{
+    int32_t i, ret, done = 0;
+
+    if (iov_check(iov, iovcnt) == -1 || fd <= fdMin || fd_get(fd) == NULL)
+    {
+        return -1;
+    }
+
+    if (pcb_current->pcb_arr[fd]->operations_pointer->write_ptr == &terminal_write)
+    {
+        return terminal_writev(iov, iovcnt);
+    }
+
+    for (i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_len == 0)
+        {
+            continue;
+        }
+        ret = write_handler(fd, iov[i].iov_base, iov[i].iov_len);
+        if (ret < 0)
+        {
+            return (done == 0) ? ret : done;
+        }
+        done += ret;
+        if (ret < iov[i].iov_len)
+        {
+            break;
+        }
+    }
+
+    return done;
+}
+
+/* spawn_handler
+ * 	Description: starts a program as a child that runs next to the
+ *  caller instead of in its place. The child inherits the caller's
+ *  descriptors, except that it reads /dev/null rather than the keyboard
+ * 	Inputs: command
+ * 	Outputs: return the pid of the child, -1 on failure
+ * 	Side Effects: the scheduler starts the child on one of its turns
+ */
+int32_t spawn_handler(const uint8_t *command)
+{
+    cli();
+
+    program_t prog;
+    uint32_t pid;
+    pcb_t* pcb_child;
+    pcb_t* pcb_parent = pcb_current;
+    proc_entry_t* entry;
+    proc_entry_t* parent = proc_get(pcb_parent->pid);
+    vnode_t node;
+
+    if (parent == NULL || program_find(command, &prog) == -1 || (pid = proc_alloc()) == PROC_NONE)
+    {
+        sti();
+        return -1;
+    }
+
+    if ((pcb_child = pcb_setup(pid, pcb_parent, &prog)) == NULL)
+    {
+        proc_free(pid);
+        sti();
+        return -1;
+    }
+    pcb_child->entry = prog.eip;
+    entry = proc_get(pid);
+    entry->spawned = 1;
+    entry->parent = pcb_parent->pid;
+    entry->terminal = parent->terminal;
+
+    /* replace a stdin on the keyboard as the child */
+    pcb_current = pcb_child;
+    if (pcb_child->pcb_arr[0] != NULL && pcb_child->pcb_arr[0]->operations_pointer->read_ptr == &terminal_read &&
+        vfs_lookup((uint8_t *)SPAWN_STDIN_PATH, &node) == 0)
+    {
+        fd_install(0, &node, (uint8_t *)SPAWN_STDIN_PATH);
+    }
+    pcb_current = pcb_parent;
+
+    sti();
+    return pid;
+}
+
+/* spawn_enter
+ * 	Description: first run of a spawned process, called by the
+ *  scheduler on the top of the child's kernel stack once its page,
+ *  TSS and pcb_current are in place
+ * 	Inputs: none
+ * 	Outputs: none, it does not return
+ * 	Side Effects: enters the program in user mode
+ */
+void spawn_enter(void)
+{
+    proc_get(pcb_current->pid)->state = PROC_STATE_READY;
+
+    sti();
+
+    /* push IRET context, IRET */
+    asm volatile(
+        "pushl %0;"
+        "pushl %1;"
+        "pushfl;"
+        "pushl %2;"
+        "pushl %3;"
+        "iret;"
+        :
+        : "r"(USER_DS), "r"(userCount), "r"(USER_CS), "r"(pcb_current->entry));
+}
+
+/* waitpid_handler
+ * 	Description: collects the status of a spawned child that halted.
+ *  Without WNOHANG the caller sleeps as WAITING, which the scheduler
+ *  passes over, until halt wakes it for a child
+ * 	Inputs: pid (WAIT_ANY for any child), status (may be NULL), options
+ * 	Outputs: return the pid collected, 0 if WNOHANG is set and no child
+ *  has halted, -1 if there is no such child
+ * 	Side Effects: frees the child's pid
+ */
+int32_t waitpid_handler(int32_t pid, int32_t *status, int32_t options)
+{
+    uint32_t child, self = pcb_current->pid;
+    int32_t found, code;
+    proc_entry_t* entry;
+
+    if (pid != WAIT_ANY && (pid <= 0 || pid > PROC_MAX))
+    {
+        return -1;
+    }
+
+    while (1)
+    {
+        cli();
+        found = 0;
+        for (child = 1; child <= PROC_MAX; child++)
+        {
+            entry = proc_get(child);
+            if (entry == NULL || !entry->spawned || entry->parent != self || (pid != WAIT_ANY && child != (uint32_t)pid))
+            {
+                continue;
+            }
+            found = 1;
+            if (entry->state == PROC_STATE_ZOMBIE)
+            {
+                code = entry->status;
+                proc_free(child);
+                sti();
+                if (status != NULL)
+                {
+                    *status = code;
+                }
+                return child;
+            }
+        }
+
+        if (!found)
+        {
+            sti();
+            return -1;
+        }
+        if (options & WNOHANG)
+        {
+            sti();
+            return 0;
+        }
+
+        /* the scan and the sleep are one critical section, so a child
+         * halting in between still finds this process WAITING */
+        proc_get(self)->state = PROC_STATE_WAITING;
+        scheduler();
+        proc_get(self)->state = PROC_STATE_READY;
+    }
+}
+
+/* diskmode_handler
+ * 	Description: chooses PIO or DMA transfers for the data disk. The
+ *  filesystem is synced and the buffer cache emptied first, so reads
+ *  after the switch come from the disk in the new mode
+ * 	Inputs: mode (0 for PIO, 1 for DMA, DISKMODE_QUERY to only ask)
+ * 	Outputs: return the previous mode, -1 if the filesystem is not on
+ *  the disk or the mode is not available
+ * 	Side Effects: writes back and empties the buffer cache
+ */
+int32_t diskmode_handler(int32_t mode)
+{
+    int32_t ret;
+
+    if (!fs_on_disk)
+    {
+        return -1;
+    }
+    if (mode == DISKMODE_QUERY)
+    {
+        return ata_get_mode();
+    }
+
+    cli();
+    ret = -1;
+    if (fs_sync() == 0 && bcache_drop() == 0)
+    {
+        ret = ata_set_mode(mode);
+    }
+    sti();
+
+    return ret;
+}
@@ -6,6 +6,9 @@
 
 #include "lib.h"
 #include "types.h"
+#include "stat.h"
+#include "uio.h"
+#include "vfs.h"
 
 #define MASK_PCB    0xFFFFE000
 #define MB_128      0x08000000
@@ -15,22 +18,55 @@
 #define GB_idx      256
 #define virtualAddr 0x08048000
 #define userCount   0x83FFFFC
-#define fdMax       7
 #define fdMin       0
 #define noOffset    0
 #define byte4       4
-#define PCB_SIZE    8
+#define PCB_SIZE    8           /* descriptors a process starts with room for */
+#define FD_TABLE_MAX    64      /* most descriptors a process can grow to */
 #define HALT        1
 #define EXECUTE     2
 #define READ        3
 #define WRITE       4
 #define OPEN        5
 #define CLOSE       6
+#define GETARGS     7
+#define VIDMAP      8
+#define SET_HANDLER 9
+#define SIGRETURN   10
+#define UNLINK      11
+#define LSEEK       12
+#define PREAD       13
+#define GETDENTS    14
+#define STAT        15
+#define FSTAT       16
+#define MMAP        17
+#define MUNMAP      18
+#define SYNC        19
+#define DISKMODE    20
+#define SENDFILE    21
+#define READV       22
+#define WRITEV      23
+#define SPAWN       24
+#define WAITPID     25
+#define DUP         26
+#define DUP2        27
+#define SYSCALL_MAX 27
+#define DISKMODE_QUERY  -1
+#define SENDFILE_CHUNK  1024
+#define STDIN_PATH  "/dev/stdin"
+#define STDOUT_PATH "/dev/stdout"
+#define SPAWN_STDIN_PATH "/dev/null"
+#define WAIT_ANY    -1
+#define WNOHANG     1
+#define SEEK_SET    0
+#define SEEK_CUR    1
+#define SEEK_END    2
 #define keyBufferSize   128
-#define programMax      6
+#define PCB_NAME_LEN    32
 #define bottomKernal    0x800000
 #define kernalStackSize 0x2000
 #define pageSize        0x400000
+#define programRoom     (MB_128 + pageSize - virtualAddr)
 #define countCheck  2
 #define shiftCount  22
 #define pageDirIndex    32
@@ -56,47 +92,130 @@ int32_t write_handler(int32_t fd, const void* buf, int32_t nbytes);
 /* Open function */
 int32_t open_handler(const uint8_t* filename);
 
+/* Open the terminal on descriptors 0 and 1 of the current process */
+int32_t open_stdio(void);
+
 /* Close function */
 int32_t close_handler(int32_t fd);
 
+/* Close every descriptor of the current process */
+void pcb_close_all(void);
+
 /* Get args function */
 int32_t getargs_handler(uint8_t * buf, int32_t nbytes);
 
 /* Vidmap function */
 int32_t vidmap_handler(uint8_t** screen_start);
 
-/* Defining structures */
+/* Set handler function (signals are not supported) */
+int32_t set_handler_handler(int32_t signum, void* handler_address);
+
+/* Sigreturn function (signals are not supported) */
+int32_t sigreturn_handler(void);
+
+/* Unlink function */
+int32_t unlink_handler(const uint8_t* filename);
+
+/* Lseek function */
+int32_t lseek_handler(int32_t fd, int32_t offset, int32_t whence);
+
+/* Pread function */
+int32_t pread_handler(int32_t fd, void* buf, int32_t nbytes, int32_t offset);
+
+/* Getdents function */
+int32_t getdents_handler(int32_t fd, void* buf, int32_t nbytes);
+
+/* Stat function */
+int32_t stat_handler(const uint8_t* filename, stat_t* buf);
+
+/* Fstat function */
+int32_t fstat_handler(int32_t fd, stat_t* buf);
+
+/* Mmap function */
+int32_t mmap_handler(int32_t fd, int32_t length);
+
+/* Munmap function */
+int32_t munmap_handler(void* addr, int32_t length);
+
+/* Sync function */
+int32_t sync_handler(void);
+
+/* Diskmode function */
+int32_t diskmode_handler(int32_t mode);
 
-/* File operations table pointer structure */
-typedef struct file_operations_table_pointer
+/* Spawn function */
+int32_t spawn_handler(const uint8_t* command);
+
+/* Waitpid function */
+int32_t waitpid_handler(int32_t pid, int32_t* status, int32_t options);
+
+/* First run of a spawned process, called by the scheduler */
+void spawn_enter(void);
+
+/* Dup function */
+int32_t dup_handler(int32_t fd);
+
+/* Dup2 function */
+int32_t dup2_handler(int32_t oldfd, int32_t newfd);
+
+/* Sendfile function */
+int32_t sendfile_handler(int32_t out_fd, int32_t in_fd, int32_t count);
+
+/* Readv function */
+int32_t readv_handler(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+/* Writev function */
+int32_t writev_handler(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+/* Fill a page of the user window the current process touched first, 0 if it is now mapped */
+int32_t page_fault_load(uint32_t addr);
+
+/* Number of times each system call was made, counted in sysc */
+extern uint32_t syscall_counts[SYSCALL_MAX + 1];
+
+/* Pages filled in by page faults, for /proc/mem */
+typedef struct demand_stats
 {
-    int32_t (* read_ptr)    (uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
-    int32_t (* write_ptr)   (int32_t fd, const void* buf, int32_t nbytes);
-    int32_t (* open_ptr)    (const uint8_t* filename);
-    int32_t (* close_ptr)   (int32_t fd);
-} file_operations_table_pointer_t;
+    uint32_t file_pages;
+    uint32_t zero_pages;
+    uint32_t failures;
+} demand_stats_t;
+
+extern demand_stats_t demand_stats;
+
+/* Defining structures */
 
-/* File descriptors structure */
+/* Open file, shared by every descriptor dup'ed or inherited from the one open made */
 typedef struct file_descriptor
 {
-    file_operations_table_pointer_t operations_pointer;
+    file_operations_table_pointer_t* operations_pointer;    /* the table of the vnode */
+    int32_t mount;
     uint32_t inode;
     uint32_t file_position;
     uint32_t flags;
+    uint32_t refcount;          /* descriptors that point here */
 } file_descriptor_t;
 
 /* PCB structure */
 typedef struct pcb
 {
-    file_descriptor_t pcb_arr[PCB_SIZE];
+    file_descriptor_t** pcb_arr;    /* fd_small, or a larger table from kmalloc; NULL when closed */
+    uint32_t fd_count;              /* slots in pcb_arr */
+    file_descriptor_t* fd_small[PCB_SIZE];
     uint8_t pid;
     uint8_t parent_pid;
     uint32_t esp;
     uint32_t kesp;
     uint32_t ebp;
+    uint32_t exec_esp;
+    uint32_t exec_ebp;
+    uint32_t entry;
+    uint32_t image_inode;
+    uint32_t image_length;
     uint32_t ss0;
     uint32_t esp0;
     uint8_t argbuf[keyBufferSize];
+    uint8_t name[PCB_NAME_LEN];
     uint8_t argsflag;
     struct pcb* parent_pcb;
     int32_t rtc_val;
@@ -106,7 +225,6 @@ typedef struct pcb
 /* Keep tracking of current pcb pointer */
 extern pcb_t* pcb_current;
 
-/* Program counter */
-extern uint8_t program_count;
+/* Give a cleared PCB its empty descriptor table */
+void pcb_fd_init(pcb_t* pcb);
 
-extern uint8_t pid_arr[programMax];
@@ -60,29 +60,19 @@ int32_t terminal_read(uint32_t fd, uint32_t offset, uint8_t *buf, uint32_t nbyte
 }
 
 
-/* terminal_write
- * 	Description: Writes to the terminal.
- * 	Inputs: fd, buf, nbytes
- * 	Outputs: Remeber of bytes outputted
+/* terminal_put
+ * 	Description: Prints a buffer on the terminal of the current process.
+ *  The caller holds interrupts off and the cursor, and has loaded the
+ *  screen position.
+ * 	Inputs: buf, nbytes
+ * 	Outputs: Number of bytes outputted
  * 	Side Effects: Writes the buffer to the terminal.
  */
-int32_t terminal_write(int32_t fd, const void *buf, int32_t nbytes)
+static int32_t terminal_put(const char *tempBuffer, int32_t nbytes)
 {
-    cli();
-
-    set_screen_x(term_arr[curr_process].screen_x);
-    set_screen_y(term_arr[curr_process].screen_y);
-
-    // initialize variables
     int i;
-    int8_t count = 0;
-    term_arr[curr_process].newline_tracker = 0;
-    term_arr[curr_process].enterFlag = 0;
-    
+    int32_t count = 0;
 
-    // get buffer
-    char *tempBuffer = (char *)buf;
-    
     // loop through buffer
     for (i = 0; i < nbytes; i++)
     {
@@ -113,7 +103,6 @@ int32_t terminal_write(int32_t fd, const void *buf, int32_t nbytes)
             {
                 putc_user(tempBuffer[i]);
             }
-            update_cursor();
             count++;
             term_arr[curr_process].newline_tracker++;
 
@@ -137,12 +126,81 @@ int32_t terminal_write(int32_t fd, const void *buf, int32_t nbytes)
         }
     }
 
+    // return chars written
+    return count;
+}
+
+/* terminal_begin
+ * 	Description: Starts a write to the terminal of the current process.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Masks interrupts, holds the cursor and loads the
+ *  screen position.
+ */
+static void terminal_begin(void)
+{
+    cli();
+    hold_cursor();
+
+    set_screen_x(term_arr[curr_process].screen_x);
+    set_screen_y(term_arr[curr_process].screen_y);
+
+    term_arr[curr_process].newline_tracker = 0;
+    term_arr[curr_process].enterFlag = 0;
+}
+
+/* terminal_end
+ * 	Description: Finishes a write started by terminal_begin.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Saves the screen position, moves the cursor once and
+ *  unmasks interrupts.
+ */
+static void terminal_end(void)
+{
     term_arr[curr_process].screen_x = get_screen_x();
     term_arr[curr_process].screen_y = get_screen_y();
 
+    release_cursor();
     sti();
+}
+
+/* terminal_write
+ * 	Description: Writes to the terminal.
+ * 	Inputs: fd, buf, nbytes
+ * 	Outputs: Remeber of bytes outputted
+ * 	Side Effects: Writes the buffer to the terminal.
+ */
+int32_t terminal_write(int32_t fd, const void *buf, int32_t nbytes)
+{
+    int32_t count;
+
+    terminal_begin();
+    count = terminal_put((const char *)buf, nbytes);
+    terminal_end();
+
+    return count;
+}
+
+/* terminal_writev
+ * 	Description: Writes several buffers to the terminal as one write,
+ *  so they cannot be split by another process and the cursor moves once.
+ * 	Inputs: iov, iovcnt (checked by the caller)
+ * 	Outputs: Number of bytes outputted
+ * 	Side Effects: Writes the buffers to the terminal.
+ */
+int32_t terminal_writev(const iovec_t *iov, int32_t iovcnt)
+{
+    int i;
+    int32_t count = 0;
+
+    terminal_begin();
+    for (i = 0; i < iovcnt; i++)
+    {
+        count += terminal_put((const char *)iov[i].iov_base, iov[i].iov_len);
+    }
+    terminal_end();
 
-    // return chars written
     return count;
 }
 
@@ -169,3 +227,19 @@ int32_t terminal_close(int32_t fd)
 {
     return 0;
 }
+
+/* terminal_stat
+ * 	Description: Reports the terminal type. The terminal has no inode
+ *  and no size.
+ * 	Inputs: inode, buf
+ * 	Outputs: Returns 0.
+ * 	Side Effects: Fills buf.
+ */
+int32_t terminal_stat(uint32_t inode, stat_t* buf)
+{
+    buf->filetype = STAT_TYPE_TERMINAL;
+    buf->inode = 0;
+    buf->size = 0;
+    buf->blocks = 0;
+    return 0;
+}
@@ -4,6 +4,8 @@
 */
 
 #include "keyboard.h"
+#include "stat.h"
+#include "uio.h"
 
 #ifndef _TERMINAL_H
 #define _TERMINAL_H
@@ -17,12 +19,18 @@ int32_t terminal_read(uint32_t fd, uint32_t offset, uint8_t* buf, uint32_t nbyte
 /* Writes to the terminal, given a buffer */
 int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes);
 
+/* Writes several buffers to the terminal in one go */
+int32_t terminal_writev(const iovec_t* iov, int32_t iovcnt);
+
 /* Opens the file (does nothing since we have a read-only system) */
 int32_t terminal_open(const uint8_t* filename);
 
 /* Closes the file (does nothing since we have a read-only system) */
 int32_t terminal_close(int32_t fd);
 
+/* Reports the terminal type */
+int32_t terminal_stat(uint32_t inode, stat_t* buf);
+
 /* Variable for the terminal buffer */
 extern char terminalBuffer[maxInputLength];
 
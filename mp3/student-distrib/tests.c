@@ -5,6 +5,20 @@
 #include "filesystem.h"
 #include "rtc.h"
 #include "terminal.h"
+#include "exec_cache.h"
+#include "syscall.h"
+#include "paging.h"
+#include "mmap.h"
+#include "lz.h"
+#include "zcache.h"
+#include "ata.h"
+#include "bcache.h"
+#include "vfs.h"
+#include "procfs.h"
+#include "ramfs.h"
+#include "process.h"
+#include "buddy.h"
+#include "kmalloc.h"
 
 #define PASS 1
 #define FAIL 0
@@ -22,6 +36,26 @@ static inline void assertion_failure(){
 }
 
 
+/* memcmp_bytes
+ * 	Description: Compares two buffers, since lib.c has no memcmp.
+ * 	Inputs: a, b, n
+ * 	Outputs: 0 if equal, 1 otherwise
+ * 	Side Effects: None
+ */
+static int memcmp_bytes(const uint8_t* a, const uint8_t* b, uint32_t n)
+{
+	uint32_t i;
+	for(i = 0; i < n; i++)
+	{
+		if(a[i] != b[i])
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
 /* Checkpoint 1 tests */
 
 /* IDT Test - Example
@@ -346,6 +380,1861 @@ int syscall_test()
 }
 /* Checkpoint 5 tests */
 
+/* fs_write_test
+ * 	Description: Creates a file, writes more than one block, overwrites
+ *	part of it, appends, reads it back and unlinks it.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: Leaves the filesystem as it was.
+ */
+int fs_write_test()
+{
+	TEST_HEADER;
+
+	int i;
+	int32_t inode;
+	int result = PASS;
+	static uint8_t pattern[2 * BLOCK_SIZE + 100];
+	static uint8_t check[2 * BLOCK_SIZE + 200];
+	dentry_t dentry;
+
+	for(i = 0; i < sizeof(pattern); i++)
+	{
+		pattern[i] = (uint8_t)(i * 7);
+	}
+
+	inode = fs_create((uint8_t *)"scratch.txt", strlen("scratch.txt"));
+	if(inode == -1 || read_dentry_by_name((uint8_t *)"scratch.txt", &dentry) == -1)
+	{
+		return FAIL;
+	}
+
+	/* Write across block boundaries, then overwrite the middle */
+	if(write_data(inode, 0, pattern, sizeof(pattern)) != sizeof(pattern) ||
+	   write_data(inode, BLOCK_SIZE - 10, pattern, 20) != 20)
+	{
+		result = FAIL;
+	}
+	memcpy(pattern + BLOCK_SIZE - 10, pattern, 20);
+
+	/* Append past the end */
+	if(write_data(inode, sizeof(pattern), pattern, 100) != 100)
+	{
+		result = FAIL;
+	}
+
+	if(read_data(inode, 0, check, sizeof(check)) != sizeof(pattern) + 100 ||
+	   memcmp_bytes(check, pattern, sizeof(pattern)) ||
+	   memcmp_bytes(check + sizeof(pattern), pattern, 100))
+	{
+		result = FAIL;
+	}
+
+	if(fs_unlink((uint8_t *)"scratch.txt") == -1 ||
+	   read_dentry_by_name((uint8_t *)"scratch.txt", &dentry) != -1)
+	{
+		result = FAIL;
+	}
+
+	return result;
+}
+
+/* Scratch PCB for calling the fd syscalls before the shell runs */
+static pcb_t test_pcb;
+static pcb_t* test_saved_pcb;
+
+/* test_pcb_enter
+ * 	Description: Points pcb_current at a cleared scratch PCB with stdin
+ *	and stdout open, so handlers that index the fd array can be called.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Changes pcb_current until test_pcb_leave.
+ */
+static void test_pcb_enter()
+{
+	test_saved_pcb = pcb_current;
+	memset(&test_pcb, 0, sizeof(test_pcb));
+	pcb_fd_init(&test_pcb);
+	pcb_current = &test_pcb;
+	open_stdio();
+}
+
+/* test_pcb_leave
+ * 	Description: Closes the descriptors of the scratch PCB and restores
+ *	the PCB saved by test_pcb_enter.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Changes pcb_current.
+ */
+static void test_pcb_leave()
+{
+	pcb_close_all();
+	pcb_current = test_saved_pcb;
+}
+
+/* lseek_pread_test
+ * 	Description: Seeks around the large text file and checks read and
+ *	pread against read_data at the same offsets.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int lseek_pread_test()
+{
+	TEST_HEADER;
+
+	int32_t fd, length;
+	int result = PASS;
+	static uint8_t expect[64];
+	static uint8_t got[64];
+	dentry_t dentry;
+	uint8_t* name = (uint8_t *)"verylargetextwithverylongname.tx";
+
+	if(read_dentry_by_name(name, &dentry) == -1)
+	{
+		return FAIL;
+	}
+	length = (inode_addr + dentry.inode_num)->length;
+
+	test_pcb_enter();
+	fd = open_handler(name);
+	if(fd == -1)
+	{
+		test_pcb_leave();
+		return FAIL;
+	}
+
+	/* Jump into the second block and read */
+	read_data(dentry.inode_num, BLOCK_SIZE + 5, expect, sizeof(expect));
+	if(lseek_handler(fd, BLOCK_SIZE + 5, SEEK_SET) != BLOCK_SIZE + 5 ||
+	   read_handler(fd, got, sizeof(got)) != sizeof(got) ||
+	   memcmp_bytes(got, expect, sizeof(got)))
+	{
+		result = FAIL;
+	}
+
+	/* Relative seek backwards lands where the read started */
+	if(lseek_handler(fd, -(int32_t)sizeof(got), SEEK_CUR) != BLOCK_SIZE + 5)
+	{
+		result = FAIL;
+	}
+
+	/* pread leaves the position alone */
+	read_data(dentry.inode_num, 100, expect, sizeof(expect));
+	if(pread_handler(fd, got, sizeof(got), 100) != sizeof(got) ||
+	   memcmp_bytes(got, expect, sizeof(got)) ||
+	   lseek_handler(fd, 0, SEEK_CUR) != BLOCK_SIZE + 5)
+	{
+		result = FAIL;
+	}
+
+	/* End-relative seeks, reads at the end, and bad arguments */
+	if(lseek_handler(fd, -10, SEEK_END) != length - 10 ||
+	   read_handler(fd, got, sizeof(got)) != 10 ||
+	   read_handler(fd, got, sizeof(got)) != 0 ||
+	   lseek_handler(fd, -(length + 1), SEEK_END) != -1 ||
+	   lseek_handler(fd, 0, 3) != -1 ||
+	   lseek_handler(1, 0, SEEK_SET) != -1 ||
+	   pread_handler(fd, got, sizeof(got), -1) != -1)
+	{
+		result = FAIL;
+	}
+
+	close_handler(fd);
+	test_pcb_leave();
+	return result;
+}
+
+/* test_syscall
+ * 	Description: Makes a system call through int 0x80 from the kernel,
+ *	so it goes through sysc and its counters like a user call would.
+ * 	Inputs: num, a, b, c
+ * 	Outputs: The return value of the call
+ * 	Side Effects: Whatever the call does.
+ */
+static int32_t test_syscall(int32_t num, int32_t a, int32_t b, int32_t c)
+{
+	int32_t ret;
+	asm volatile("int $0x80"
+		: "=a"(ret)
+		: "a"(num), "b"(a), "c"(b), "d"(c)
+		: "memory", "cc");
+	return ret;
+}
+
+/* syscall_total
+ * 	Description: Sums the per-call counters kept by sysc.
+ * 	Inputs: None
+ * 	Outputs: Total number of system calls made
+ * 	Side Effects: None
+ */
+static uint32_t syscall_total()
+{
+	int i;
+	uint32_t total = 0;
+	for(i = 0; i <= SYSCALL_MAX; i++)
+	{
+		total += syscall_counts[i];
+	}
+	return total;
+}
+
+#define GETDENTS_BATCH 16
+
+/* getdents_test
+ * 	Description: Lists the directory once with a read per name like the
+ *	old ls and once with getdents, checks both see the same entries with
+ *	the right type, inode and size, and prints the system calls each took.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: Prints the counts.
+ */
+int getdents_test()
+{
+	TEST_HEADER;
+
+	int i;
+	int32_t fd, cnt;
+	int32_t read_names = 0, dent_names = 0;
+	uint32_t start, read_calls, dent_calls;
+	int result = PASS;
+	static uint8_t name[FILENAME_LEN];
+	static dirent_t ents[GETDENTS_BATCH];
+	dentry_t dentry;
+
+	test_pcb_enter();
+
+	/* One read per name */
+	start = syscall_total();
+	fd = test_syscall(OPEN, (int32_t)".", 0, 0);
+	while((cnt = test_syscall(READ, fd, (int32_t)name, FILENAME_LEN)) > 0)
+	{
+		read_names++;
+	}
+	test_syscall(CLOSE, fd, 0, 0);
+	read_calls = syscall_total() - start;
+
+	/* A batch of records per call */
+	start = syscall_total();
+	fd = test_syscall(OPEN, (int32_t)".", 0, 0);
+	while((cnt = test_syscall(GETDENTS, fd, (int32_t)ents, sizeof(ents))) > 0)
+	{
+		for(i = 0; i < cnt / sizeof(dirent_t); i++, dent_names++)
+		{
+			if(read_dentry_by_index(dent_names, &dentry) == -1 ||
+			   memcmp_bytes(ents[i].name, (uint8_t *)dentry.filename, FILENAME_LEN) ||
+			   ents[i].filetype != dentry.filetype || ents[i].inode != dentry.inode_num ||
+			   (dentry.filetype == FILE_TYPE_REGULAR && ents[i].size != (inode_addr + dentry.inode_num)->length))
+			{
+				result = FAIL;
+			}
+		}
+	}
+	test_syscall(CLOSE, fd, 0, 0);
+	dent_calls = syscall_total() - start;
+
+	/* A buffer smaller than one record is refused */
+	fd = test_syscall(OPEN, (int32_t)".", 0, 0);
+	if(test_syscall(GETDENTS, fd, (int32_t)ents, sizeof(dirent_t) - 1) != -1)
+	{
+		result = FAIL;
+	}
+	test_syscall(CLOSE, fd, 0, 0);
+
+	test_pcb_leave();
+
+	printf(" %d entries: %u syscalls with read, %u with getdents\n", dent_names, read_calls, dent_calls);
+	if(cnt == -1 || read_names != dent_names || dent_names != boot_block_addr->dir_count)
+	{
+		result = FAIL;
+	}
+	return result;
+}
+
+/* stat_test
+ * 	Description: Checks stat against the inode of a file, and that the
+ *	directory, RTC and terminal descriptors report their own types.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int stat_test()
+{
+	TEST_HEADER;
+
+	int32_t fd, length;
+	int result = PASS;
+	stat_t st;
+	dentry_t dentry;
+
+	if(read_dentry_by_name((uint8_t *)"frame0.txt", &dentry) == -1)
+	{
+		return FAIL;
+	}
+	length = (inode_addr + dentry.inode_num)->length;
+
+	if(stat_handler((uint8_t *)"frame0.txt", &st) == -1 || st.filetype != STAT_TYPE_REGULAR ||
+	   st.inode != dentry.inode_num || st.size != length ||
+	   st.blocks != (length + BLOCK_SIZE - 1) / BLOCK_SIZE)
+	{
+		result = FAIL;
+	}
+	if(stat_handler((uint8_t *)"nosuchfile", &st) != -1 ||
+	   stat_handler((uint8_t *)".", &st) == -1 || st.filetype != STAT_TYPE_DIRECTORY ||
+	   stat_handler((uint8_t *)"rtc", &st) == -1 || st.filetype != STAT_TYPE_RTC)
+	{
+		result = FAIL;
+	}
+
+	test_pcb_enter();
+	fd = open_handler((uint8_t *)"frame0.txt");
+	if(fstat_handler(fd, &st) == -1 || st.size != length ||
+	   fstat_handler(1, &st) == -1 || st.filetype != STAT_TYPE_TERMINAL ||
+	   fstat_handler(fd + 1, &st) != -1)
+	{
+		result = FAIL;
+	}
+	close_handler(fd);
+	test_pcb_leave();
+
+	return result;
+}
+
+/* mmap_test
+ * 	Description: Maps the large text file into the window of the last
+ *	process slot, reads it through the mapping and compares it with
+ *	read_data, then unmaps it. The file cannot be unlinked while it is
+ *	mapped, and a write to it leaves the mapped block alone.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: Restores the mapping window when done.
+ */
+int mmap_test()
+{
+	TEST_HEADER;
+
+	int32_t addr, length, offset, cnt;
+	uint32_t saved;
+	uint32_t slot = MMAP_SLOTS - 1;
+	int result = PASS;
+	static uint8_t check[BLOCK_SIZE];
+	dentry_t dentry;
+
+	if(read_dentry_by_name((uint8_t *)"verylargetextwithverylongname.tx", &dentry) == -1)
+	{
+		return FAIL;
+	}
+	length = (inode_addr + dentry.inode_num)->length;
+
+	saved = page_dir[MMAP_PDE_IDX].hex;
+	mmap_install(slot);
+
+	addr = mmap_map(slot, dentry.inode_num, length);
+	for(offset = 0; addr != -1 && offset < length; offset += cnt)
+	{
+		cnt = read_data(dentry.inode_num, offset, check, BLOCK_SIZE);
+		if(cnt <= 0 || memcmp_bytes((uint8_t *)addr + offset, check, cnt))
+		{
+			result = FAIL;
+			break;
+		}
+	}
+	if(addr == -1)
+	{
+		result = FAIL;
+	}
+
+	/* The write copies the held block away, then the byte is put back */
+	if(addr != -1 && read_data(dentry.inode_num, 0, check, 1) == 1)
+	{
+		check[1] = check[0] ^ 1;
+		if(write_data(dentry.inode_num, 0, &check[1], 1) != 1 ||
+		   *(uint8_t *)addr != check[0] ||
+		   write_data(dentry.inode_num, 0, check, 1) != 1)
+		{
+			result = FAIL;
+		}
+	}
+
+	/* Past the end of the file and outside the window are refused, and
+	 * the mapping keeps its blocks from being freed */
+	if(mmap_map(slot, dentry.inode_num, length + 1) != -1 ||
+	   (addr != -1 && vfs_unlink((uint8_t *)"verylargetextwithverylongname.tx") != -1) ||
+	   mmap_unmap(slot, MMAP_BASE - MMAP_PAGE_SIZE, 1) != -1 ||
+	   mmap_unmap(slot, addr, length) == -1)
+	{
+		result = FAIL;
+	}
+
+	mmap_release(slot);
+	page_dir[MMAP_PDE_IDX].hex = saved;
+	flush_tlb();
+	return result;
+}
+
+#define SUBDIR_FILES 40
+
+/* subdir_test
+ * 	Description: Builds a nested directory, looks its entries up by
+ *	path and lists it through getdents, then removes it. A directory is
+ *	only removable once empty.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int subdir_test()
+{
+	TEST_HEADER;
+
+	int i;
+	int32_t fd, cnt, total = 0;
+	int result = PASS;
+	uint8_t path[FILENAME_LEN * 2];
+	static dirent_t ents[GETDENTS_BATCH];
+	dentry_t dentry, inner;
+
+	if(fs_mkdir((uint8_t *)"dirtest", strlen("dirtest")) == -1 ||
+	   read_dentry_by_name((uint8_t *)"dirtest", &dentry) == -1 ||
+	   dentry.filetype != FILE_TYPE_DIRECTORY)
+	{
+		return FAIL;
+	}
+
+	/* Names written to the directory descriptor land inside it */
+	test_pcb_enter();
+	fd = open_handler((uint8_t *)"dirtest");
+	if(write_handler(fd, "sub/", 4) != 4 || write_handler(fd, "sub/x", 5) != 5)
+	{
+		result = FAIL;
+	}
+	for(i = 0; i < SUBDIR_FILES; i++)
+	{
+		strcpy((int8_t *)path, "dirtest/f");
+		itoa(i, (int8_t *)path + strlen("dirtest/f"), 10);
+		if(fs_create(path, strlen((int8_t *)path)) == -1)
+		{
+			result = FAIL;
+		}
+	}
+
+	/* Every entry resolves, and only directories can be walked through */
+	if(read_dentry_by_name((uint8_t *)"dirtest/sub/x", &inner) == -1 ||
+	   inner.filetype != FILE_TYPE_REGULAR ||
+	   read_dentry_by_name((uint8_t *)"/dirtest//f7", &inner) == -1 ||
+	   read_dentry_by_name((uint8_t *)"dirtest/f7/x", &inner) != -1 ||
+	   read_dentry_by_name((uint8_t *)"dirtest/nosuchfile", &inner) != -1)
+	{
+		result = FAIL;
+	}
+
+	while((cnt = getdents_handler(fd, ents, sizeof(ents))) > 0)
+	{
+		total += cnt / sizeof(dirent_t);
+	}
+	if(cnt == -1 || total != SUBDIR_FILES + 1 || fs_dir_count(dentry.inode_num) != total)
+	{
+		result = FAIL;
+	}
+	close_handler(fd);
+	test_pcb_leave();
+
+	/* A directory goes only after everything in it */
+	if(fs_unlink((uint8_t *)"dirtest/sub") != -1 ||
+	   fs_unlink((uint8_t *)"dirtest/sub/x") == -1 ||
+	   fs_unlink((uint8_t *)"dirtest/sub") == -1)
+	{
+		result = FAIL;
+	}
+	for(i = 0; i < SUBDIR_FILES; i++)
+	{
+		strcpy((int8_t *)path, "dirtest/f");
+		itoa(i, (int8_t *)path + strlen("dirtest/f"), 10);
+		if(fs_unlink(path) == -1)
+		{
+			result = FAIL;
+		}
+	}
+	if(fs_unlink((uint8_t *)"dirtest") == -1 ||
+	   read_dentry_by_name((uint8_t *)"dirtest", &dentry) != -1)
+	{
+		result = FAIL;
+	}
+
+	return result;
+}
+
+#define EXTENT_TEST_BLOCKS 3
+
+/* extent_test
+ * 	Description: Rewrites a scratch file as an extent inode over its
+ *	own blocks and checks reads, then writes into it, which turns it
+ *	into an indirect inode, and checks reads again.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int extent_test()
+{
+	TEST_HEADER;
+
+	int i;
+	int32_t inode;
+	int32_t blocks[EXTENT_TEST_BLOCKS];
+	int result = PASS;
+	static uint8_t pattern[EXTENT_TEST_BLOCKS * BLOCK_SIZE];
+	static uint8_t check[EXTENT_TEST_BLOCKS * BLOCK_SIZE];
+	inode_extent_t* ext;
+
+	for(i = 0; i < sizeof(pattern); i++)
+	{
+		pattern[i] = (uint8_t)(i * 13);
+	}
+
+	inode = fs_create((uint8_t *)"extent.tmp", strlen("extent.tmp"));
+	if(inode == -1 || write_data(inode, 0, pattern, sizeof(pattern)) != sizeof(pattern))
+	{
+		return FAIL;
+	}
+
+	/* One extent per block, merged where the blocks are consecutive */
+	ext = (inode_extent_t *)(inode_addr + inode);
+	for(i = 0; i < EXTENT_TEST_BLOCKS; i++)
+	{
+		blocks[i] = fs_bmap(inode, i);
+	}
+	ext->layout = INODE_LAYOUT_EXTENT;
+	ext->count = 0;
+	for(i = 0; i < EXTENT_TEST_BLOCKS; i++)
+	{
+		if(ext->count > 0 && ext->extents[ext->count - 1].start + ext->extents[ext->count - 1].count == blocks[i])
+		{
+			ext->extents[ext->count - 1].count++;
+			continue;
+		}
+		ext->extents[ext->count].first = i;
+		ext->extents[ext->count].start = blocks[i];
+		ext->extents[ext->count].count = 1;
+		ext->count++;
+	}
+
+	if(read_data(inode, 0, check, sizeof(check)) != sizeof(pattern) ||
+	   memcmp_bytes(check, pattern, sizeof(pattern)) ||
+	   read_data(inode, BLOCK_SIZE - 5, check, 10) != 10 ||
+	   memcmp_bytes(check, pattern + BLOCK_SIZE - 5, 10))
+	{
+		result = FAIL;
+	}
+
+	/* Appending needs a new block number, so the inode goes indirect */
+	if(write_data(inode, sizeof(pattern) - 10, pattern, 20) != 20 ||
+	   (uint32_t)(inode_addr + inode)->data_block_num[0] != INODE_LAYOUT_INDIRECT)
+	{
+		result = FAIL;
+	}
+	memcpy(pattern + sizeof(pattern) - 10, pattern, 10);
+	if(read_data(inode, 0, check, sizeof(check)) != sizeof(pattern) ||
+	   memcmp_bytes(check, pattern, sizeof(pattern)) ||
+	   read_data(inode, sizeof(pattern), check, 10) != 10 ||
+	   memcmp_bytes(check, pattern + 10, 10))
+	{
+		result = FAIL;
+	}
+
+	if(fs_unlink((uint8_t *)"extent.tmp") == -1)
+	{
+		result = FAIL;
+	}
+
+	return result;
+}
+
+#define COMPRESS_TEST_TAIL 100
+
+/* compress_test
+ * 	Description: Rewrites a scratch file as a compressed inode by hand:
+ *	an "ab" block coded as two literals and one long overlapping match,
+ *	then a tail stored as it is. Checks the decoder, reads through the
+ *	block cache, and that the first write turns the inode back into a
+ *	direct one.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int compress_test()
+{
+	TEST_HEADER;
+
+	int i;
+	int32_t inode, start;
+	uint32_t n = 0, length;
+	uint32_t hits;
+	int result = PASS;
+	static uint8_t stream[BLOCK_SIZE];
+	static uint8_t expect[BLOCK_SIZE + COMPRESS_TEST_TAIL];
+	static uint8_t check[BLOCK_SIZE + COMPRESS_TEST_TAIL];
+	static const uint8_t bad_offset[] = {0x10, 'a', 0x05, 0x00};
+	inode_compressed_t* node;
+
+	for(i = 0; i < BLOCK_SIZE; i++)
+	{
+		expect[i] = (i % 2) ? 'b' : 'a';
+	}
+	for(i = 0; i < COMPRESS_TEST_TAIL; i++)
+	{
+		expect[BLOCK_SIZE + i] = (uint8_t)(i * 13);
+	}
+
+	/* Block 0: "ab", then a match two bytes back for the rest */
+	stream[n++] = (2 << LZ_TOKEN_SHIFT) | LZ_RUN_MASK;
+	stream[n++] = 'a';
+	stream[n++] = 'b';
+	stream[n++] = 2;
+	stream[n++] = 0;
+	for(length = BLOCK_SIZE - 2 - LZ_MIN_MATCH - LZ_RUN_MASK; length >= LZ_LENGTH_MORE; length -= LZ_LENGTH_MORE)
+	{
+		stream[n++] = LZ_LENGTH_MORE;
+	}
+	stream[n++] = length;
+
+	/* Block 1 did not shrink, so it is stored as it is */
+	memcpy(stream + n, expect + BLOCK_SIZE, COMPRESS_TEST_TAIL);
+
+	if(lz_decompress(stream, n, check, BLOCK_SIZE) != BLOCK_SIZE ||
+	   memcmp_bytes(check, expect, BLOCK_SIZE) ||
+	   lz_decompress(stream, n, check, BLOCK_SIZE - 1) != -1 ||
+	   lz_decompress(bad_offset, sizeof(bad_offset), check, BLOCK_SIZE) != -1)
+	{
+		return FAIL;
+	}
+
+	inode = fs_create((uint8_t *)"compress.tmp", strlen("compress.tmp"));
+	if(inode == -1 || write_data(inode, 0, stream, n + COMPRESS_TEST_TAIL) != n + COMPRESS_TEST_TAIL)
+	{
+		return FAIL;
+	}
+	start = fs_bmap(inode, 0);
+
+	node = (inode_compressed_t *)(inode_addr + inode);
+	node->length = BLOCK_SIZE + COMPRESS_TEST_TAIL;
+	node->layout = INODE_LAYOUT_COMPRESSED;
+	node->start = start;
+	node->size = n + COMPRESS_TEST_TAIL;
+	node->offsets[0] = 0;
+	node->offsets[1] = n;
+	node->offsets[2] = n + COMPRESS_TEST_TAIL;
+
+	/* The second read of block 0 comes from the cache */
+	if(read_data(inode, 0, check, sizeof(check)) != sizeof(expect) ||
+	   memcmp_bytes(check, expect, sizeof(expect)))
+	{
+		result = FAIL;
+	}
+	hits = zcache_stats.hits;
+	if(read_data(inode, BLOCK_SIZE - 5, check, 10) != 10 ||
+	   memcmp_bytes(check, expect + BLOCK_SIZE - 5, 10) ||
+	   zcache_stats.hits != hits + 1 || fs_bmap(inode, 0) != -1)
+	{
+		result = FAIL;
+	}
+
+	/* Writing decodes the file into plain blocks */
+	expect[1] = 'X';
+	if(write_data(inode, 1, (uint8_t *)"X", 1) != 1 ||
+	   (uint32_t)(inode_addr + inode)->data_block_num[0] == INODE_LAYOUT_COMPRESSED ||
+	   read_data(inode, 0, check, sizeof(check)) != sizeof(expect) ||
+	   memcmp_bytes(check, expect, sizeof(expect)))
+	{
+		result = FAIL;
+	}
+
+	if(fs_unlink((uint8_t *)"compress.tmp") == -1)
+	{
+		result = FAIL;
+	}
+
+	return result;
+}
+
+#define DISK_TEST_SIZE (10 * BLOCK_SIZE + 123)
+
+/* disk_test
+ * 	Description: Writes a scratch file on the data disk, syncs it, and
+ *	reads it back with the buffer cache emptied, once with PIO and once
+ *	with DMA, checking the disk was really read each time. Passes
+ *	without doing anything when there is no data disk.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int disk_test()
+{
+	TEST_HEADER;
+
+	int i;
+	int32_t inode, mode, old;
+	uint32_t pages;
+	int result = PASS;
+	static uint8_t expect[DISK_TEST_SIZE];
+	static uint8_t check[DISK_TEST_SIZE];
+
+	if(!fs_on_disk)
+	{
+		return PASS;
+	}
+
+	for(i = 0; i < DISK_TEST_SIZE; i++)
+	{
+		expect[i] = (uint8_t)(i * 7 + i / BLOCK_SIZE);
+	}
+	inode = fs_create((uint8_t *)"disk.tmp", strlen("disk.tmp"));
+	if(inode == -1 || write_data(inode, 0, expect, DISK_TEST_SIZE) != DISK_TEST_SIZE || fs_sync() == -1)
+	{
+		return FAIL;
+	}
+
+	old = ata_get_mode();
+	for(mode = ATA_MODE_PIO; mode <= ATA_MODE_DMA; mode++)
+	{
+		/* DMA is missing without a PCI IDE controller */
+		if(ata_set_mode(mode) == -1)
+		{
+			continue;
+		}
+		memset(check, 0, DISK_TEST_SIZE);
+		pages = ata_stats.pages_read;
+		if(bcache_drop() == -1 ||
+		   read_data(inode, 0, check, DISK_TEST_SIZE) != DISK_TEST_SIZE ||
+		   memcmp_bytes(check, expect, DISK_TEST_SIZE) ||
+		   ata_stats.pages_read < pages + DISK_TEST_SIZE / BLOCK_SIZE)
+		{
+			result = FAIL;
+		}
+	}
+	ata_set_mode(old);
+
+	if(fs_unlink((uint8_t *)"disk.tmp") == -1 || fs_sync() == -1)
+	{
+		result = FAIL;
+	}
+
+	return result;
+}
+
+#define VFS_TEST_NAME "vfs.tmp"
+#define VFS_TEST_SIZE (BLOCK_SIZE + 77)
+#define VFS_TEST_HOLE (3 * RAMFS_BLOCK_SIZE)
+
+/* vfs_test
+ * 	Description: Opens through all three mounts. A repeated lookup
+ *	must come from the path cache, a file made in /tmp must read back,
+ *	the hole left by a write past its end must read as zeros, it must
+ *	not be unlinked while open, and unlinking it must retire its cached
+ *	path.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int vfs_test()
+{
+	TEST_HEADER;
+
+	int i;
+	int32_t fd, dir;
+	uint32_t hits, stale;
+	int result = PASS;
+	stat_t st;
+	vnode_t node;
+	static dirent_t ents[GETDENTS_BATCH];
+	static uint8_t expect[VFS_TEST_SIZE];
+	static uint8_t check[VFS_TEST_SIZE];
+
+	test_pcb_enter();
+
+	/* The second open of a path skips the backend */
+	fd = open_handler((uint8_t *)"frame0.txt");
+	close_handler(fd);
+	hits = vfs_cache_stats.hits;
+	fd = open_handler((uint8_t *)"frame0.txt");
+	if(fd == -1 || vfs_cache_stats.hits != hits + 1)
+	{
+		result = FAIL;
+	}
+	close_handler(fd);
+
+	/* Devices live in /dev and cannot be removed */
+	dir = open_handler((uint8_t *)"/dev");
+	if(stat_handler((uint8_t *)"/dev/rtc", &st) == -1 || st.filetype != STAT_TYPE_RTC ||
+	   stat_handler((uint8_t *)"/dev/stdout", &st) == -1 || st.filetype != STAT_TYPE_TERMINAL ||
+	   getdents_handler(dir, ents, sizeof(ents)) != 6 * sizeof(dirent_t) ||
+	   strncmp((int8_t *)ents[0].name, "rtc", FILENAME_LEN) ||
+	   unlink_handler((uint8_t *)"/dev/rtc") != -1 ||
+	   write_handler(dir, "x", 1) != -1)
+	{
+		result = FAIL;
+	}
+	close_handler(dir);
+
+	/* A file in /tmp is made by writing its name to the directory */
+	for(i = 0; i < VFS_TEST_SIZE; i++)
+	{
+		expect[i] = (uint8_t)(i * 5 + 1);
+	}
+	dir = open_handler((uint8_t *)"/tmp");
+	if(write_handler(dir, VFS_TEST_NAME, strlen(VFS_TEST_NAME)) == -1)
+	{
+		result = FAIL;
+	}
+	close_handler(dir);
+	fd = open_handler((uint8_t *)"/tmp/" VFS_TEST_NAME);
+	if(fd == -1 ||
+	   write_handler(fd, expect, VFS_TEST_SIZE) != VFS_TEST_SIZE ||
+	   lseek_handler(fd, 0, SEEK_SET) != 0 ||
+	   read_handler(fd, check, VFS_TEST_SIZE) != VFS_TEST_SIZE ||
+	   memcmp_bytes(check, expect, VFS_TEST_SIZE) ||
+	   fstat_handler(fd, &st) == -1 || st.size != VFS_TEST_SIZE)
+	{
+		result = FAIL;
+	}
+
+	/* The block skipped over was never allocated */
+	memset(check, 0xFF, VFS_TEST_SIZE);
+	if(lseek_handler(fd, VFS_TEST_HOLE, SEEK_SET) != VFS_TEST_HOLE ||
+	   write_handler(fd, expect, 1) != 1 ||
+	   pread_handler(fd, check, VFS_TEST_SIZE, VFS_TEST_HOLE - VFS_TEST_SIZE) != VFS_TEST_SIZE ||
+	   check[0] != 0 || check[VFS_TEST_SIZE - 1] != 0 ||
+	   memcmp_bytes(check, check + 1, VFS_TEST_SIZE - 1))
+	{
+		result = FAIL;
+	}
+
+	/* An open file is pinned, so its slot cannot be handed out again */
+	if(unlink_handler((uint8_t *)"/tmp/" VFS_TEST_NAME) != -1)
+	{
+		result = FAIL;
+	}
+	close_handler(fd);
+
+	/* The path is cached, and the unlink must make that entry stale */
+	stale = vfs_cache_stats.stale;
+	if(vfs_lookup((uint8_t *)"/tmp/" VFS_TEST_NAME, &node) == -1 ||
+	   unlink_handler((uint8_t *)"/tmp/" VFS_TEST_NAME) == -1 ||
+	   vfs_lookup((uint8_t *)"/tmp/" VFS_TEST_NAME, &node) != -1 ||
+	   vfs_cache_stats.stale != stale + 1)
+	{
+		result = FAIL;
+	}
+
+	test_pcb_leave();
+	return result;
+}
+
+#define DEVFS_TEST_SIZE 64
+
+/* devfs_test
+ * 	Description: Checks the memory devices: null reads nothing, zero
+ *	reads zeros, random changes from read to read, and all of them take
+ *	any write.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int devfs_test()
+{
+	TEST_HEADER;
+
+	int i;
+	int32_t null_fd, zero_fd, random_fd;
+	int result = PASS;
+	stat_t st;
+	static uint8_t first[DEVFS_TEST_SIZE];
+	static uint8_t second[DEVFS_TEST_SIZE];
+
+	test_pcb_enter();
+	null_fd = open_handler((uint8_t *)"/dev/null");
+	zero_fd = open_handler((uint8_t *)"/dev/zero");
+	random_fd = open_handler((uint8_t *)"/dev/random");
+	if(null_fd == -1 || zero_fd == -1 || random_fd == -1)
+	{
+		test_pcb_leave();
+		return FAIL;
+	}
+
+	memset(first, 1, DEVFS_TEST_SIZE);
+	if(read_handler(null_fd, first, DEVFS_TEST_SIZE) != 0 ||
+	   write_handler(null_fd, first, DEVFS_TEST_SIZE) != DEVFS_TEST_SIZE ||
+	   read_handler(zero_fd, first, DEVFS_TEST_SIZE) != DEVFS_TEST_SIZE ||
+	   write_handler(random_fd, first, DEVFS_TEST_SIZE) != DEVFS_TEST_SIZE ||
+	   fstat_handler(zero_fd, &st) == -1 || st.filetype != STAT_TYPE_CHARDEV ||
+	   lseek_handler(zero_fd, 0, SEEK_SET) != -1)
+	{
+		result = FAIL;
+	}
+	for(i = 0; i < DEVFS_TEST_SIZE; i++)
+	{
+		if(first[i] != 0)
+		{
+			result = FAIL;
+		}
+	}
+
+	/* odd lengths exercise the partial last word */
+	if(read_handler(random_fd, first, DEVFS_TEST_SIZE - 1) != DEVFS_TEST_SIZE - 1 ||
+	   read_handler(random_fd, second, DEVFS_TEST_SIZE - 1) != DEVFS_TEST_SIZE - 1 ||
+	   !memcmp_bytes(first, second, DEVFS_TEST_SIZE - 1))
+	{
+		result = FAIL;
+	}
+
+	close_handler(null_fd);
+	close_handler(zero_fd);
+	close_handler(random_fd);
+	test_pcb_leave();
+	return result;
+}
+
+#define PROCFS_TEST_FILES 5
+#define PROCFS_TEST_IRQ   3
+
+/* procfs_test
+ * 	Description: Reads every file in /proc. Each must be as long as
+ *	stat says, start with its header line and refuse writes.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int procfs_test()
+{
+	TEST_HEADER;
+
+	int i;
+	int32_t fd, cnt;
+	int result = PASS;
+	stat_t st;
+	uint8_t path[FILENAME_LEN];
+	static dirent_t ents[GETDENTS_BATCH];
+	static uint8_t text[PROCFS_BUF_SIZE];
+	static const int8_t* heads[PROCFS_TEST_FILES] = {"   PID", "  TERM", "   PDE", "   VEC", "  SIZE"};
+
+	test_pcb_enter();
+	fd = open_handler((uint8_t *)"/proc");
+	cnt = getdents_handler(fd, ents, sizeof(ents));
+	close_handler(fd);
+	if(cnt != PROCFS_TEST_FILES * sizeof(dirent_t))
+	{
+		test_pcb_leave();
+		return FAIL;
+	}
+
+	for(i = 0; i < PROCFS_TEST_FILES; i++)
+	{
+		strcpy((int8_t *)path, "/proc/");
+		strncpy((int8_t *)path + strlen("/proc/"), (int8_t *)ents[i].name, FILENAME_LEN - strlen("/proc/") - 1);
+		fd = open_handler(path);
+		cnt = read_handler(fd, text, PROCFS_BUF_SIZE);
+		if(fd == -1 || cnt <= 0 || stat_handler(path, &st) == -1 ||
+		   st.filetype != STAT_TYPE_REGULAR ||
+		   strncmp((int8_t *)text, heads[i], strlen(heads[i])) ||
+		   write_handler(fd, text, 1) != -1)
+		{
+			result = FAIL;
+		}
+		/* the interrupt counts move between the two calls */
+		if(i != PROCFS_TEST_IRQ && st.size != cnt)
+		{
+			result = FAIL;
+		}
+		close_handler(fd);
+	}
+
+	test_pcb_leave();
+	return result;
+}
+
+#define SENDFILE_TEST_FILE "verylargetextwithverylongname.tx"
+#define SENDFILE_TEST_COPY "/tmp/sendfile.tmp"
+#define SENDFILE_TEST_MAX  0x4000
+
+/* sendfile_test
+ * 	Description: Sends a multi-block file to /dev/null straight from its
+ *	blocks, then into a /tmp file through the kernel buffer, and checks
+ *	the copy and the positions.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int sendfile_test()
+{
+	TEST_HEADER;
+
+	int32_t in, out, dir, copy;
+	int result = PASS;
+	stat_t st;
+	static uint8_t expect[SENDFILE_TEST_MAX];
+	static uint8_t check[SENDFILE_TEST_MAX];
+
+	test_pcb_enter();
+	in = open_handler((uint8_t *)SENDFILE_TEST_FILE);
+	out = open_handler((uint8_t *)"/dev/null");
+	if(in == -1 || out == -1 || fstat_handler(in, &st) == -1 || st.size > SENDFILE_TEST_MAX)
+	{
+		test_pcb_leave();
+		return FAIL;
+	}
+
+	/* everything in one call, then nothing left */
+	if(sendfile_handler(out, in, st.size + 1) != st.size ||
+	   sendfile_handler(out, in, 1) != 0 ||
+	   sendfile_handler(out, 0, 1) != -1 ||
+	   sendfile_handler(out, in, -1) != -1)
+	{
+		result = FAIL;
+	}
+
+	/* a regular file as the target takes the copying path */
+	dir = open_handler((uint8_t *)"/tmp");
+	write_handler(dir, "sendfile.tmp", strlen("sendfile.tmp"));
+	close_handler(dir);
+	copy = open_handler((uint8_t *)SENDFILE_TEST_COPY);
+	lseek_handler(in, 0, SEEK_SET);
+	if(copy == -1 || sendfile_handler(copy, in, st.size) != st.size ||
+	   read_data(pcb_current->pcb_arr[in]->inode, 0, expect, st.size) != st.size ||
+	   pread_handler(copy, check, st.size, 0) != st.size ||
+	   memcmp_bytes(check, expect, st.size))
+	{
+		result = FAIL;
+	}
+
+	close_handler(copy);
+	close_handler(out);
+	close_handler(in);
+	unlink_handler((uint8_t *)SENDFILE_TEST_COPY);
+	test_pcb_leave();
+	return result;
+}
+
+#define IOV_TEST_FILE "frame0.txt"
+#define IOV_TEST_HEAD 10
+#define IOV_TEST_TAIL 30
+
+/* iov_test
+ * 	Description: Reads the start of a file into two buffers with one
+ *	readv, writes them to /dev/null and the terminal with writev, and
+ *	checks that bad vectors are turned away.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: Prints one line.
+ */
+int iov_test()
+{
+	TEST_HEADER;
+
+	int32_t fd, null;
+	int result = PASS;
+	uint8_t head[IOV_TEST_HEAD];
+	uint8_t tail[IOV_TEST_TAIL];
+	uint8_t expect[IOV_TEST_HEAD + IOV_TEST_TAIL];
+	iovec_t iov[3];
+	iovec_t line[2];
+
+	test_pcb_enter();
+	fd = open_handler((uint8_t *)IOV_TEST_FILE);
+	null = open_handler((uint8_t *)"/dev/null");
+	if(fd == -1 || null == -1)
+	{
+		test_pcb_leave();
+		return FAIL;
+	}
+
+	/* an empty buffer in the middle is skipped */
+	iov[0].iov_base = head;
+	iov[0].iov_len = IOV_TEST_HEAD;
+	iov[1].iov_base = NULL;
+	iov[1].iov_len = 0;
+	iov[2].iov_base = tail;
+	iov[2].iov_len = IOV_TEST_TAIL;
+	if(readv_handler(fd, iov, 3) != IOV_TEST_HEAD + IOV_TEST_TAIL ||
+	   read_data(pcb_current->pcb_arr[fd]->inode, 0, expect, sizeof(expect)) != sizeof(expect) ||
+	   memcmp_bytes(head, expect, IOV_TEST_HEAD) ||
+	   memcmp_bytes(tail, expect + IOV_TEST_HEAD, IOV_TEST_TAIL) ||
+	   lseek_handler(fd, 0, SEEK_CUR) != IOV_TEST_HEAD + IOV_TEST_TAIL)
+	{
+		result = FAIL;
+	}
+
+	if(writev_handler(null, iov, 3) != IOV_TEST_HEAD + IOV_TEST_TAIL ||
+	   writev_handler(null, iov, IOV_MAX + 1) != -1 ||
+	   writev_handler(null, NULL, 1) != -1 ||
+	   readv_handler(1, iov, 3) != -1)
+	{
+		result = FAIL;
+	}
+
+	line[0].iov_base = "iov test: ";
+	line[0].iov_len = strlen("iov test: ");
+	line[1].iov_base = "one line\n";
+	line[1].iov_len = strlen("one line\n");
+	if(writev_handler(1, line, 2) != line[0].iov_len + line[1].iov_len)
+	{
+		result = FAIL;
+	}
+
+	close_handler(null);
+	close_handler(fd);
+	test_pcb_leave();
+	return result;
+}
+
+/* process_table_test
+ * 	Description: Takes every pid that is left, checks that each has its
+ *	own aligned kernel stack and page table, and that a freed pid is the
+ *	next one handed out. Everything taken is given back.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int process_table_test()
+{
+	TEST_HEADER;
+
+	static uint32_t pids[PROC_MAX];
+	uint32_t i, j, n = 0, live;
+	int result = PASS;
+
+	cli();
+	live = proc_count();
+	while((pids[n] = proc_alloc()) != PROC_NONE)
+	{
+		n++;
+	}
+	if(proc_count() != proc_capacity() || live + n != proc_capacity())
+	{
+		result = FAIL;
+	}
+
+	for(i = 0; i < n; i++)
+	{
+		if(!proc_used(pids[i]) ||
+		   (proc_kstack(pids[i]) & (PROC_KSTACK_SIZE - 1)) ||
+		   (proc_page_table(pids[i]) & (BUDDY_PAGE_SIZE - 1)) ||
+		   proc_page_table(pids[i]) < BUDDY_BASE)
+		{
+			result = FAIL;
+		}
+		for(j = 0; j < i; j++)
+		{
+			if(pids[i] == pids[j] || proc_page_table(pids[i]) == proc_page_table(pids[j]))
+			{
+				result = FAIL;
+			}
+		}
+	}
+
+	/* a pid given back comes out again first */
+	if(n > 0)
+	{
+		proc_free(pids[0]);
+		if(proc_used(pids[0]) || proc_alloc() != pids[0])
+		{
+			result = FAIL;
+		}
+	}
+
+	for(i = 0; i < n; i++)
+	{
+		proc_free(pids[i]);
+	}
+	if(proc_count() != live)
+	{
+		result = FAIL;
+	}
+	sti();
+	return result;
+}
+
+/* spawn_table_test
+ * 	Description: Checks the table side of spawn and waitpid: zombies and
+ *	parked processes are not scheduled, a spawned child that has not
+ *	started is, and a parent going away frees its zombie children and
+ *	detaches the rest. A scratch PCB has no children to wait for and
+ *	cannot spawn.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int spawn_table_test()
+{
+	TEST_HEADER;
+
+	uint32_t parent, zombie, child;
+	proc_entry_t* entry;
+	int32_t status;
+	int result = PASS;
+
+	cli();
+	parent = proc_alloc();
+	zombie = proc_alloc();
+	child = proc_alloc();
+	if(parent == PROC_NONE || zombie == PROC_NONE || child == PROC_NONE)
+	{
+		proc_free(parent);
+		proc_free(zombie);
+		sti();
+		return FAIL;
+	}
+
+	proc_get(parent)->state = PROC_STATE_PARKED;
+	entry = proc_get(zombie);
+	entry->spawned = 1;
+	entry->parent = parent;
+	entry->state = PROC_STATE_ZOMBIE;
+	entry = proc_get(child);
+	entry->spawned = 1;
+	entry->parent = parent;
+
+	/* from the parent the next to run is the new child, never the zombie */
+	if(proc_next_runnable(zombie - 1) == zombie || proc_next_runnable(parent) == parent ||
+	   proc_next_runnable(child - 1) != child)
+	{
+		result = FAIL;
+	}
+
+	proc_orphan(parent);
+	if(proc_used(zombie) || !proc_used(child) || proc_get(child)->parent != PROC_NONE)
+	{
+		result = FAIL;
+	}
+
+	proc_free(child);
+	proc_free(parent);
+	sti();
+
+	test_pcb_enter();
+	if(waitpid_handler(WAIT_ANY, &status, WNOHANG) != -1 ||
+	   waitpid_handler(0, &status, 0) != -1 ||
+	   spawn_handler((uint8_t *)"hello") != -1)
+	{
+		result = FAIL;
+	}
+	test_pcb_leave();
+	return result;
+}
+
+/* buddy_test
+ * 	Description: Takes single pages and a whole 4 MB block from the
+ *	frame allocator and checks their alignment, then gives them back and
+ *	checks that every split merged again. Backs two user pages of a
+ *	scratch page table and checks that they come zeroed and are freed
+ *	with the table.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int buddy_test()
+{
+	TEST_HEADER;
+
+	buddy_stats_t before;
+	uint32_t a, b, big, table, i;
+	pte_t* pages;
+	int result = PASS;
+
+	cli();
+	before = buddy_stats;
+
+	a = buddy_alloc(0);
+	b = buddy_alloc(0);
+	big = buddy_alloc(BUDDY_MAX_ORDER);
+	if(a == 0 || b == 0 || a == b || (a & (BUDDY_PAGE_SIZE - 1)) || (b & (BUDDY_PAGE_SIZE - 1)) ||
+	   (big != 0 && (big & ((BUDDY_PAGE_SIZE << BUDDY_MAX_ORDER) - 1))) ||
+	   buddy_alloc(BUDDY_MAX_ORDER + 1) != 0)
+	{
+		result = FAIL;
+	}
+	if(buddy_stats.free_pages + 2 + (big != 0 ? 1 << BUDDY_MAX_ORDER : 0) != before.free_pages)
+	{
+		result = FAIL;
+	}
+	buddy_free(a, 0);
+	buddy_free(b, 0);
+	if(big != 0)
+	{
+		buddy_free(big, BUDDY_MAX_ORDER);
+	}
+
+	/* user pages come zeroed and go back with the table */
+	table = buddy_alloc(0);
+	if(table == 0)
+	{
+		sti();
+		return FAIL;
+	}
+	memset((void*)table, 0, BUDDY_PAGE_SIZE);
+	pages = (pte_t*)table;
+	if(paging_user_alloc(table, 1, 2) == -1 || pages[0].present_pte || !pages[1].present_pte ||
+	   !pages[2].present_pte || !pages[1].user_pte)
+	{
+		result = FAIL;
+	}
+	for(i = 0; i < BUDDY_PAGE_SIZE && pages[1].present_pte; i++)
+	{
+		if(((uint8_t*)(pages[1].page_table_base_addr_pte << SHIFT1))[i] != 0)
+		{
+			result = FAIL;
+			break;
+		}
+	}
+	paging_user_free(table);
+	buddy_free(table, 0);
+
+	if(buddy_stats.free_pages != before.free_pages)
+	{
+		result = FAIL;
+	}
+	for(i = 0; i < BUDDY_ORDERS; i++)
+	{
+		if(buddy_stats.free_blocks[i] != before.free_blocks[i])
+		{
+			result = FAIL;
+		}
+	}
+	sti();
+	return result;
+}
+
+/* demand_page_test
+ * 	Description: Gives a scratch process an empty user window with hello
+ *	as its program, then touches the first page of the image and the top
+ *	of the stack. The first reads back as the start of the file and the
+ *	second as zeros, and only those two pages get mapped. Pages outside
+ *	the window, or already present, are refused. The program file cannot
+ *	be written while it runs.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+int demand_page_test()
+{
+	TEST_HEADER;
+
+	static uint8_t expect[64];
+	dentry_t dentry;
+	uint32_t pid, i, mapped = 0;
+	pde_t saved;
+	pte_t* pages;
+	int result = PASS;
+
+	if(read_dentry_by_name((uint8_t *)"hello", &dentry) == -1 ||
+	   read_data(dentry.inode_num, 0, expect, sizeof(expect)) != sizeof(expect))
+	{
+		return FAIL;
+	}
+
+	cli();
+	if((pid = proc_alloc()) == PROC_NONE)
+	{
+		sti();
+		return FAIL;
+	}
+	test_pcb_enter();
+	pcb_current->pid = pid;
+	pcb_current->image_inode = dentry.inode_num;
+	pcb_current->image_length = (inode_addr + dentry.inode_num)->length;
+	saved = page_dir[USER_PDE];
+	paging_map_user(proc_page_table(pid));
+	flush_tlb();
+
+	if(memcmp_bytes((uint8_t *)virtualAddr, expect, sizeof(expect)) ||
+	   *(volatile uint32_t *)userCount != 0)
+	{
+		result = FAIL;
+	}
+
+	pages = (pte_t *)proc_page_table(pid);
+	for(i = 0; i < PAGING_SIZE; i++)
+	{
+		mapped += pages[i].present_pte;
+	}
+	if(mapped != 2 || page_fault_load(MB_128 + pageSize) != -1 || page_fault_load(virtualAddr) != -1)
+	{
+		result = FAIL;
+	}
+
+	/* later faults would load whatever a write left in the file */
+	if(vfs_pin_run(VFS_IMAGE_MOUNT, dentry.inode_num) == -1 ||
+	   write_data(dentry.inode_num, 0, expect, 1) != -1)
+	{
+		result = FAIL;
+	}
+	vfs_unpin_run(VFS_IMAGE_MOUNT, dentry.inode_num);
+
+	page_dir[USER_PDE] = saved;
+	flush_tlb();
+	test_pcb_leave();
+	proc_free(pid);
+	sti();
+	return result;
+}
+
+/* kmalloc_test
+ * 	Description: Fills more than one slab of a scratch cache and checks
+ *	that its objects are distinct and aligned, then frees them and checks
+ *	that the spare slab went back. Takes a block of each kind from kmalloc
+ *	and checks that kfree returns the frames, and that NULL and a pointer
+ *	kmalloc never gave out are ignored.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+#define KMALLOC_TEST_OBJS	160
+int kmalloc_test()
+{
+	TEST_HEADER;
+
+	static kmem_cache_t cache = KMEM_CACHE("test", 40);
+	static uint8_t* objs[KMALLOC_TEST_OBJS];
+	uint32_t free_pages, slabs, bad_frees, i;
+	uint8_t *small, *large;
+	int result = PASS;
+
+	cli();
+	free_pages = buddy_stats.free_pages;
+	slabs = cache.slabs;
+	bad_frees = kmem_large_stats.bad_frees;
+
+	for(i = 0; i < KMALLOC_TEST_OBJS; i++)
+	{
+		objs[i] = kmem_cache_alloc(&cache);
+		if(objs[i] == NULL || ((uint32_t)objs[i] & (KMEM_ALIGN - 1)) || (i > 0 && objs[i] == objs[i - 1]))
+		{
+			sti();
+			return FAIL;
+		}
+		memset(objs[i], i, cache.size);
+	}
+	if(cache.active != KMALLOC_TEST_OBJS || cache.slabs < 2 || cache.slabs * cache.per_slab < KMALLOC_TEST_OBJS)
+	{
+		result = FAIL;
+	}
+	for(i = 0; i < KMALLOC_TEST_OBJS; i++)
+	{
+		if(objs[i][cache.size - 1] != (uint8_t)i)
+		{
+			result = FAIL;
+		}
+		kmem_cache_free(&cache, objs[i]);
+	}
+	/* the last empty slab stays for the next allocation */
+	if(cache.active != 0 || cache.slabs != 1 || buddy_stats.free_pages + cache.slabs - slabs != free_pages)
+	{
+		result = FAIL;
+	}
+
+	small = kmalloc(KMEM_MAX_CLASS);
+	large = kmalloc(KMEM_MAX_CLASS + 1);
+	if(small == NULL || large == NULL || kmalloc(0) != NULL)
+	{
+		result = FAIL;
+	}
+	kfree(large);
+	kfree(small);
+	kfree(NULL);
+	if(large != NULL)
+	{
+		kfree(large);
+	}
+	if(kmem_large_stats.bad_frees != bad_frees + (large != NULL))
+	{
+		result = FAIL;
+	}
+
+	/* the kmalloc-1024 slab may have been new, the large block is back */
+	if(buddy_stats.free_pages + 2 < free_pages)
+	{
+		result = FAIL;
+	}
+	sti();
+	return result;
+}
+
+/* dup_test
+ * 	Description: Dups a descriptor of frame0.txt and checks that a read
+ *	through either moves the position of both. Points stdin at it with
+ *	dup2 and reads it there, then opens more files than the table starts
+ *	with room for and checks that it grew. Every open file goes back to
+ *	the file cache when the last descriptor on it closes.
+ * 	Inputs: None
+ * 	Outputs: PASS/FAIL
+ * 	Side Effects: None
+ */
+#define DUP_TEST_FILE	"frame0.txt"
+#define DUP_TEST_OPEN	12
+int dup_test()
+{
+	TEST_HEADER;
+
+	int32_t fd, copy, fds[DUP_TEST_OPEN], i;
+	uint8_t a[4], b[4], expect[8];
+	file_descriptor_t* file;
+	int result = PASS;
+
+	test_pcb_enter();
+	fd = open_handler((uint8_t *)DUP_TEST_FILE);
+	if(fd == -1 || (copy = dup_handler(fd)) == -1 || copy == fd)
+	{
+		test_pcb_leave();
+		return FAIL;
+	}
+	file = pcb_current->pcb_arr[fd];
+
+	/* one open file, one position */
+	if(pcb_current->pcb_arr[copy] != file || file->refcount != 2 ||
+	   pread_handler(fd, expect, sizeof(expect), 0) != sizeof(expect) ||
+	   read_handler(fd, a, sizeof(a)) != sizeof(a) ||
+	   read_handler(copy, b, sizeof(b)) != sizeof(b) ||
+	   memcmp_bytes(a, expect, sizeof(a)) || memcmp_bytes(b, expect + sizeof(a), sizeof(b)))
+	{
+		result = FAIL;
+	}
+
+	/* stdin reads the file from where it is now */
+	lseek_handler(fd, 0, SEEK_SET);
+	if(dup2_handler(fd, 0) != 0 || dup2_handler(fd, fd) != fd || dup2_handler(fdMin + 2 + DUP_TEST_OPEN * 2, 1) != -1 ||
+	   read_handler(0, a, sizeof(a)) != sizeof(a) || memcmp_bytes(a, expect, sizeof(a)) || file->refcount != 3)
+	{
+		result = FAIL;
+	}
+	close_handler(copy);
+	close_handler(fd);
+	if(file->refcount != 1 || pcb_current->pcb_arr[0] != file)
+	{
+		result = FAIL;
+	}
+
+	/* more than PCB_SIZE descriptors */
+	for(i = 0; i < DUP_TEST_OPEN; i++)
+	{
+		fds[i] = open_handler((uint8_t *)DUP_TEST_FILE);
+		if(fds[i] == -1)
+		{
+			result = FAIL;
+			break;
+		}
+	}
+	if(pcb_current->fd_count <= PCB_SIZE || pcb_current->fd_count > FD_TABLE_MAX ||
+	   dup_handler(fds[DUP_TEST_OPEN - 1]) != fds[DUP_TEST_OPEN - 1] + 1)
+	{
+		result = FAIL;
+	}
+
+	test_pcb_leave();
+	if(test_pcb.fd_count != PCB_SIZE || test_pcb.pcb_arr != test_pcb.fd_small)
+	{
+		result = FAIL;
+	}
+	return result;
+}
+
+/* Performance benchmarks */
+
+#define PIT_CH2_PORT    0x42
+#define PIT_CMD_PORT    0x43
+#define PIT_GATE_PORT   0x61
+#define PIT_CH2_ONESHOT 0xB0
+#define PIT_GATE_ON     0x01
+#define PIT_SPEAKER_ON  0x02
+#define PIT_CH2_OUT     0x20
+#define PIT_HZ          1193182
+#define CALIBRATE_MS    10
+#define BENCH_ROUNDS    32
+#define BENCH_BUF_SIZE  0x10000
+
+static uint8_t bench_buf[BENCH_BUF_SIZE];
+
+/* tsc_mhz
+ * 	Description: Calibrates the time-stamp counter against a one-shot
+ *	countdown on PIT channel 2, which is free since the speaker is unused.
+ * 	Inputs: None
+ * 	Outputs: TSC frequency in MHz
+ * 	Side Effects: Reprograms PIT channel 2.
+ */
+static uint32_t tsc_mhz()
+{
+	uint32_t count = PIT_HZ / 1000 * CALIBRATE_MS;
+	uint32_t start, end;
+
+	/* Gate channel 2 on with the speaker output off */
+	outb((inb(PIT_GATE_PORT) & ~PIT_SPEAKER_ON) | PIT_GATE_ON, PIT_GATE_PORT);
+	outb(PIT_CH2_ONESHOT, PIT_CMD_PORT);
+	outb(count & 0xFF, PIT_CH2_PORT);
+	outb((count >> 8) & 0xFF, PIT_CH2_PORT);
+
+	/* Spin until the counter reaches zero */
+	start = rdtsc();
+	while(!(inb(PIT_GATE_PORT) & PIT_CH2_OUT));
+	end = rdtsc();
+
+	return (end - start) / (CALIBRATE_MS * 1000);
+}
+
+/* read_data_bytewise
+ * 	Description: The original read_data loop, kept as the baseline for
+ *	read_data_bench. Copies one byte per iteration and keeps looping to
+ *	length even after the end of the file.
+ * 	Inputs: inode, offset, buf, length
+ * 	Outputs: Number of bytes read
+ * 	Side Effects: Fills the buffer.
+ */
+static int32_t read_data_bytewise(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+{
+	int i, data, idx;
+	int read_counter = 0;
+	int cur_pos = offset;
+	data_t* cur_data_block_ptr;
+	inode_t* cur_inode_ptr = (inode_t *) (inode + inode_addr);
+
+	for(i = 0; i < length; i++)
+	{
+		if(cur_inode_ptr->length >= offset + read_counter)
+		{
+			idx = cur_pos / BLOCK_SIZE;
+			data = cur_pos % BLOCK_SIZE;
+			cur_data_block_ptr = (data_t *)(data_addr + cur_inode_ptr->data_block_num[idx]);
+			buf[i] = cur_data_block_ptr->val[data];
+			cur_pos++;
+			read_counter++;
+		}
+	}
+
+	return read_counter;
+}
+
+/* bench_read_file
+ * 	Description: Times whole-file loads of one file with a read engine.
+ *	Every load asks for the whole file, capped at the BENCH_BUF_SIZE
+ *	bytes of bench_buf so a large file cannot overrun it.
+ * 	Inputs: name, engine, mhz
+ * 	Outputs: None
+ * 	Side Effects: Prints cycles per load and throughput.
+ */
+static void bench_read_file(const uint8_t* name, const int8_t* label,
+	int32_t (*engine)(uint32_t, uint32_t, uint8_t*, uint32_t), uint32_t mhz)
+{
+	int i;
+	int32_t bytes = 0;
+	uint32_t start, cycles, usecs, request;
+	dentry_t dentry;
+
+	if(read_dentry_by_name(name, &dentry) == -1)
+	{
+		printf(" %s: not found\n", name);
+		return;
+	}
+	request = (inode_addr + dentry.inode_num)->length;
+	request = (request < BENCH_BUF_SIZE) ? request : BENCH_BUF_SIZE;
+
+	start = rdtsc();
+	for(i = 0; i < BENCH_ROUNDS; i++)
+	{
+		bytes += engine(dentry.inode_num, 0, bench_buf, request);
+	}
+	cycles = rdtsc() - start;
+
+	usecs = cycles / mhz;
+	printf(" %s %s: %u cycles/load, %u MB/s\n", name, label,
+		cycles / BENCH_ROUNDS, usecs ? bytes / usecs : 0);
+}
+
+/* read_data_bench
+ * 	Description: Compares the byte loop against the block-run read_data
+ *	on a multi-block binary and the large text file.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Prints the results.
+ */
+void read_data_bench()
+{
+	uint32_t mhz = tsc_mhz();
+
+	clear();
+	printf("\n\n read_data throughput (TSC %u MHz)\n", mhz);
+	if(mhz == 0)
+	{
+		return;
+	}
+
+	bench_read_file((uint8_t *)"fish", "byte loop", &read_data_bytewise, mhz);
+	bench_read_file((uint8_t *)"fish", "block runs", &read_data, mhz);
+	bench_read_file((uint8_t *)"verylargetextwithverylongname.tx", "byte loop", &read_data_bytewise, mhz);
+	bench_read_file((uint8_t *)"verylargetextwithverylongname.tx", "block runs", &read_data, mhz);
+}
+
+#define LOOKUP_ROUNDS   1000
+
+/* read_dentry_linear
+ * 	Description: The original linear dentry scan, kept as the baseline
+ *	for dentry_lookup_bench. Compares all 63 slots, used or not.
+ * 	Inputs: fname, dentry
+ * 	Outputs: 0 on success, -1 on failure
+ * 	Side Effects: Fills the dentry.
+ */
+static int32_t read_dentry_linear(const uint8_t* fname, dentry_t* dentry)
+{
+	int i;
+
+	if(strlen((int8_t *)fname) > FILENAME_LEN || fname == NULL || dentry == NULL)
+	{
+		return -1;
+	}
+
+	for(i = 0; i < DENTRY_SIZE - 1; i++)
+	{
+		if(!strncmp((int8_t *) &(boot_block_addr->direntries[i]), (int8_t *)fname, FILENAME_LEN))
+		{
+			memcpy((int8_t *)dentry->filename, (int8_t *)boot_block_addr->direntries[i].filename, FILENAME_LEN);
+			dentry->filetype = boot_block_addr->direntries[i].filetype;
+			dentry->inode_num = boot_block_addr->direntries[i].inode_num;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/* bench_lookup
+ * 	Description: Times repeated lookups of one name with a lookup function.
+ * 	Inputs: name, label, lookup
+ * 	Outputs: None
+ * 	Side Effects: Prints cycles per lookup and whether it hit.
+ */
+static void bench_lookup(const uint8_t* name, const int8_t* label,
+	int32_t (*lookup)(const uint8_t*, dentry_t*))
+{
+	int i;
+	int32_t ret = 0;
+	uint32_t start, cycles;
+	dentry_t dentry;
+
+	start = rdtsc();
+	for(i = 0; i < LOOKUP_ROUNDS; i++)
+	{
+		ret = lookup(name, &dentry);
+	}
+	cycles = rdtsc() - start;
+
+	printf(" %s %s %s: %u cycles/lookup\n", name, label,
+		ret == 0 ? "hit" : "miss", cycles / LOOKUP_ROUNDS);
+}
+
+/* dentry_lookup_bench
+ * 	Description: Compares the linear dentry scan against the hashed
+ *	index for an early hit, a late hit and a miss.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Prints the results.
+ */
+void dentry_lookup_bench()
+{
+	clear();
+	printf("\n\n read_dentry_by_name cost\n");
+
+	bench_lookup((uint8_t *)"sigtest", "linear", &read_dentry_linear);
+	bench_lookup((uint8_t *)"sigtest", "hashed", &read_dentry_by_name);
+	bench_lookup((uint8_t *)"hello", "linear", &read_dentry_linear);
+	bench_lookup((uint8_t *)"hello", "hashed", &read_dentry_by_name);
+	bench_lookup((uint8_t *)"nosuchfile", "linear", &read_dentry_linear);
+	bench_lookup((uint8_t *)"nosuchfile", "hashed", &read_dentry_by_name);
+}
+
+#define DISPATCH_ROUNDS 10000
+
+/* bench_dev
+ * 	Description: Times reads or writes of one size on a device through
+ *	read_handler and write_handler.
+ * 	Inputs: path, nbytes, write (nonzero to time writes), mhz
+ * 	Outputs: None
+ * 	Side Effects: Prints cycles per call and the byte rate.
+ */
+static void bench_dev(const uint8_t* path, int32_t nbytes, int write, uint32_t mhz)
+{
+	int i;
+	int32_t fd;
+	uint32_t start, cycles;
+
+	fd = open_handler(path);
+	if(fd == -1)
+	{
+		printf(" %s: open failed\n", path);
+		return;
+	}
+
+	start = rdtsc();
+	for(i = 0; i < DISPATCH_ROUNDS; i++)
+	{
+		if(write)
+		{
+			write_handler(fd, bench_buf, nbytes);
+		}
+		else
+		{
+			read_handler(fd, bench_buf, nbytes);
+		}
+	}
+	cycles = rdtsc() - start;
+	close_handler(fd);
+
+	/* bytes per microsecond is MB/s */
+	printf(" %s %s %d: %u cycles/call", path, write ? "write" : "read", nbytes, cycles / DISPATCH_ROUNDS);
+	if(nbytes > 1 && cycles / mhz != 0)
+	{
+		printf(", %u MB/s", nbytes * DISPATCH_ROUNDS / (cycles / mhz));
+	}
+	printf("\n");
+}
+
+/* dev_dispatch_bench
+ * 	Description: Measures descriptor dispatch alone with 1-byte calls on
+ *	/dev/null, then the fill rate of /dev/zero and /dev/random.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Prints the results.
+ */
+void dev_dispatch_bench()
+{
+	uint32_t mhz = tsc_mhz();
+
+	clear();
+	printf("\n\n device read/write cost (TSC %u MHz)\n", mhz);
+	if(mhz == 0)
+	{
+		return;
+	}
+
+	test_pcb_enter();
+	bench_dev((uint8_t *)"/dev/null", 1, 0, mhz);
+	bench_dev((uint8_t *)"/dev/null", 1, 1, mhz);
+	bench_dev((uint8_t *)"/dev/zero", 1, 0, mhz);
+	bench_dev((uint8_t *)"/dev/zero", BLOCK_SIZE, 0, mhz);
+	bench_dev((uint8_t *)"/dev/random", BLOCK_SIZE, 0, mhz);
+	test_pcb_leave();
+}
+
+/* exec_latency_report
+ * 	Description: Prints the execute latency counters, in cycles from the
+ *	int 0x80 trap to the user iret, split by cold and warm image cache.
+ *	Meaningful after some programs have been launched from the shell.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Prints the results.
+ */
+void exec_latency_report()
+{
+	printf("\n execute latency (cycles)\n");
+	printf(" cold: %u launches, last %u, avg %u\n", exec_stats.cold_count,
+		exec_stats.cold_last, exec_stats.cold_count ? exec_stats.cold_total / exec_stats.cold_count : 0);
+	printf(" warm: %u launches, last %u, avg %u\n", exec_stats.warm_count,
+		exec_stats.warm_last, exec_stats.warm_count ? exec_stats.warm_total / exec_stats.warm_count : 0);
+}
+
 /* Test suite entry point */
 void launch_tests(){
 	//TEST_OUTPUT("idt tests", idt_test());
@@ -367,4 +2256,28 @@ void launch_tests(){
 	//rtc_test_freq();
 	//reset();
 	//syscall_test();
+	//TEST_OUTPUT("fs write test", fs_write_test());
+	//TEST_OUTPUT("lseek pread test", lseek_pread_test());
+	//TEST_OUTPUT("getdents test", getdents_test());
+	//TEST_OUTPUT("stat test", stat_test());
+	//TEST_OUTPUT("mmap test", mmap_test());
+	//TEST_OUTPUT("subdir test", subdir_test());
+	//TEST_OUTPUT("extent test", extent_test());
+	//TEST_OUTPUT("compress test", compress_test());
+	//TEST_OUTPUT("disk test", disk_test());
+	//TEST_OUTPUT("vfs test", vfs_test());
+	//TEST_OUTPUT("devfs test", devfs_test());
+	//TEST_OUTPUT("procfs test", procfs_test());
+	//TEST_OUTPUT("sendfile test", sendfile_test());
+	//TEST_OUTPUT("iov test", iov_test());
+	//TEST_OUTPUT("process table test", process_table_test());
+	//TEST_OUTPUT("spawn table test", spawn_table_test());
+	//TEST_OUTPUT("buddy test", buddy_test());
+	//TEST_OUTPUT("demand page test", demand_page_test());
+	//TEST_OUTPUT("kmalloc test", kmalloc_test());
+	//TEST_OUTPUT("dup test", dup_test());
+	//read_data_bench();
+	//dentry_lookup_bench();
+	//exec_latency_report();
+	//dev_dispatch_bench();
 }
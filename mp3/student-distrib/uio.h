@@ -0,0 +1,22 @@
+/*
+ * uio.h
+ * The scatter/gather record taken by readv and writev. Each entry names
+ * one user buffer; the entries are handled in order in a single call.
+ */
+
+#ifndef _UIO_H
+#define _UIO_H
+
+#include "types.h"
+
+/* Most entries one readv or writev will take */
+#define IOV_MAX 16
+
+/* One buffer of a vectored read or write */
+typedef struct iovec
+{
+    void* iov_base;
+    int32_t iov_len;
+} iovec_t;
+
+#endif /* _UIO_H */
@@ -0,0 +1,435 @@
+#include "types.h"
+#include "lib.h"
+#include "filesystem.h"
+#include "devfs.h"
+#include "ramfs.h"
+#include "procfs.h"
+#include "vfs.h"
+
+/* Operations of the files and directories in the image */
+file_operations_table_pointer_t filesystem_operations_table = {&file_read, &file_write, &file_open, &file_close, &file_stat, NULL};
+file_operations_table_pointer_t directory_operations_table = {&directory_read, &directory_write, &directory_open, &directory_close, &directory_stat, &directory_getdents};
+
+static int32_t image_lookup(const uint8_t* path, vnode_t* node);
+
+/* The image, mounted on the root */
+static vfs_backend_t image_backend = {&image_lookup, &fs_unlink, &fs_generation};
+
+/* Mounted backends, in mount order */
+static vfs_mount_t vfs_mounts[VFS_MAX_MOUNTS];
+static uint32_t vfs_mount_count = 0;
+
+/* Inodes held open, mapped or running */
+static vfs_pin_t vfs_pins[VFS_MAX_PINS];
+
+/* Direct-mapped path cache */
+static vfs_cache_entry_t vfs_cache[VFS_CACHE_SIZE];
+
+vfs_cache_stats_t vfs_cache_stats;
+
+/* image_lookup
+ * 	Description: Finds a dentry in the image and picks the operations
+ *  table for its file type.
+ * 	Inputs: path (relative to the root), node
+ * 	Outputs: Return 0, -1 if there is no such file
+ * 	Side Effects: Fills node, except for the mount.
+ */
+static int32_t image_lookup(const uint8_t* path, vnode_t* node)
+{
+    dentry_t dentry;
+
+    if(*path == '\0')
+    {
+        node->inode = ROOT_DIR;
+        node->type = STAT_TYPE_DIRECTORY;
+        node->ops = &directory_operations_table;
+        return 0;
+    }
+
+    if(read_dentry_by_name(path, &dentry) == -1)
+    {
+        return -1;
+    }
+
+    /* the image's device entries keep working without /dev */
+    if(dentry.filetype == FILE_TYPE_RTC)
+    {
+        node->inode = 0;
+        node->type = STAT_TYPE_RTC;
+        node->ops = &rtc_operations_table;
+    }
+    else if(dentry.filetype == FILE_TYPE_DIRECTORY)
+    {
+        node->inode = dentry.inode_num;
+        node->type = STAT_TYPE_DIRECTORY;
+        node->ops = &directory_operations_table;
+    }
+    else if(dentry.filetype == FILE_TYPE_REGULAR)
+    {
+        node->inode = dentry.inode_num;
+        node->type = STAT_TYPE_REGULAR;
+        node->ops = &filesystem_operations_table;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/* vfs_init
+ * 	Description: Mounts the image on the root, the devices on /dev, the
+ *  RAM filesystem on /tmp and the kernel state on /proc.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Replaces the mount table and empties the path cache.
+ */
+void vfs_init()
+{
+    vfs_mount_count = 0;
+    memset(vfs_pins, 0, sizeof(vfs_pins));
+    ramfs_init();
+
+    vfs_mount((uint8_t *)"/", &image_backend);
+    vfs_mount((uint8_t *)"/dev", &devfs_backend);
+    vfs_mount((uint8_t *)"/tmp", &ramfs_backend);
+    vfs_mount((uint8_t *)"/proc", &procfs_backend);
+
+    memset(&vfs_cache_stats, 0, sizeof(vfs_cache_stats));
+}
+
+/* vfs_mount
+ * 	Description: Mounts a backend on a path. Paths below it, and the
+ *  path itself, go to the backend from then on.
+ * 	Inputs: path, backend
+ * 	Outputs: Return 0, -1 if the table is full or the path too long
+ * 	Side Effects: Empties the path cache, since the mount may hide
+ *  files that were looked up before.
+ */
+int32_t vfs_mount(const uint8_t* path, vfs_backend_t* backend)
+{
+    uint32_t length;
+    vfs_mount_t* mount;
+
+    if(path == NULL || backend == NULL || vfs_mount_count >= VFS_MAX_MOUNTS)
+    {
+        return -1;
+    }
+
+    while(*path == VFS_SEPARATOR)
+    {
+        path++;
+    }
+    length = strlen((int8_t *)path);
+    if(length >= VFS_MOUNT_LEN)
+    {
+        return -1;
+    }
+
+    mount = &vfs_mounts[vfs_mount_count];
+    memset(mount->path, 0, VFS_MOUNT_LEN);
+    memcpy(mount->path, path, length);
+    mount->length = length;
+    mount->backend = backend;
+    vfs_mount_count++;
+
+    vfs_cache_flush();
+    return 0;
+}
+
+/* vfs_resolve
+ * 	Description: Picks the mount with the longest prefix of a path.
+ *  A prefix only counts when it ends at a separator or at the end.
+ * 	Inputs: path, rest (set to the path below the mount point)
+ * 	Outputs: Return the mount index, -1 if nothing is mounted there
+ * 	Side Effects: None
+ */
+static int32_t vfs_resolve(const uint8_t* path, const uint8_t** rest)
+{
+    uint32_t i, length;
+    int32_t best = -1;
+
+    while(*path == VFS_SEPARATOR)
+    {
+        path++;
+    }
+
+    for(i = 0; i < vfs_mount_count; i++)
+    {
+        length = vfs_mounts[i].length;
+        if(best != -1 && length <= vfs_mounts[best].length)
+        {
+            continue;
+        }
+        if(strncmp((int8_t *)path, (int8_t *)vfs_mounts[i].path, length) == 0 &&
+           (path[length] == '\0' || path[length] == VFS_SEPARATOR || length == 0))
+        {
+            best = i;
+        }
+    }
+    if(best == -1)
+    {
+        return -1;
+    }
+
+    path += vfs_mounts[best].length;
+    while(*path == VFS_SEPARATOR)
+    {
+        path++;
+    }
+    *rest = path;
+    return best;
+}
+
+/* vfs_hash
+ * 	Description: Hashes a path for the cache with 32-bit FNV-1a.
+ * 	Inputs: path, length
+ * 	Outputs: Return the hash
+ * 	Side Effects: None
+ */
+static uint32_t vfs_hash(const uint8_t* path, uint32_t length)
+{
+    uint32_t i;
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for(i = 0; i < length; i++)
+    {
+        hash ^= path[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/* vfs_lookup
+ * 	Description: Finds the vnode a path names. A path seen before
+ *  comes from the cache when its backend has not removed anything
+ *  since; otherwise the backend of its mount looks it up.
+ * 	Inputs: path, node
+ * 	Outputs: Return 0, -1 if the path names nothing
+ * 	Side Effects: Fills node, updates the cache and its counters.
+ */
+int32_t vfs_lookup(const uint8_t* path, vnode_t* node)
+{
+    uint32_t length, hash, generation;
+    int32_t mount;
+    const uint8_t* rest;
+    vfs_backend_t* backend;
+    vfs_cache_entry_t* entry;
+
+    if(path == NULL || node == NULL)
+    {
+        return -1;
+    }
+    length = strlen((int8_t *)path);
+    if(length == 0 || length >= VFS_PATH_MAX)
+    {
+        return -1;
+    }
+
+    hash = vfs_hash(path, length);
+    entry = &vfs_cache[hash % VFS_CACHE_SIZE];
+    if(entry->length == length && entry->hash == hash && strncmp((int8_t *)entry->path, (int8_t *)path, length) == 0)
+    {
+        if(entry->generation == *(vfs_mounts[entry->node.mount].backend->generation))
+        {
+            vfs_cache_stats.hits++;
+            *node = entry->node;
+            return 0;
+        }
+        vfs_cache_stats.stale++;
+        entry->length = 0;
+    }
+    vfs_cache_stats.misses++;
+
+    mount = vfs_resolve(path, &rest);
+    if(mount == -1)
+    {
+        return -1;
+    }
+    backend = vfs_mounts[mount].backend;
+    generation = *(backend->generation);
+    if(backend->lookup(rest, node) == -1)
+    {
+        return -1;
+    }
+    node->mount = mount;
+
+    /* only names that exist are remembered, so a create needs no flush */
+    entry->hash = hash;
+    entry->length = length;
+    entry->generation = generation;
+    memcpy(entry->path, path, length);
+    entry->node = *node;
+    return 0;
+}
+
+/* vfs_pin_find
+ * 	Description: Finds the pin of an inode.
+ * 	Inputs: mount, inode
+ * 	Outputs: Return the pin, NULL if the inode is not pinned
+ * 	Side Effects: None
+ */
+static vfs_pin_t* vfs_pin_find(int32_t mount, uint32_t inode)
+{
+    uint32_t i;
+
+    for(i = 0; i < VFS_MAX_PINS; i++)
+    {
+        if(vfs_pins[i].count != 0 && vfs_pins[i].mount == mount && vfs_pins[i].inode == inode)
+        {
+            return &vfs_pins[i];
+        }
+    }
+    return NULL;
+}
+
+/* vfs_pin
+ * 	Description: Takes a hold on an inode, which keeps vfs_unlink from
+ *  removing it.
+ * 	Inputs: mount, inode
+ * 	Outputs: Return 0, -1 if every pin is taken
+ * 	Side Effects: None
+ */
+int32_t vfs_pin(int32_t mount, uint32_t inode)
+{
+    uint32_t i;
+    vfs_pin_t* pin = vfs_pin_find(mount, inode);
+
+    if(pin != NULL)
+    {
+        pin->count++;
+        return 0;
+    }
+    for(i = 0; i < VFS_MAX_PINS; i++)
+    {
+        if(vfs_pins[i].count == 0)
+        {
+            vfs_pins[i].mount = mount;
+            vfs_pins[i].inode = inode;
+            vfs_pins[i].count = 1;
+            vfs_pins[i].running = 0;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* vfs_unpin
+ * 	Description: Drops a hold taken by vfs_pin.
+ * 	Inputs: mount, inode
+ * 	Outputs: None
+ * 	Side Effects: None for an inode that is not pinned.
+ */
+void vfs_unpin(int32_t mount, uint32_t inode)
+{
+    vfs_pin_t* pin = vfs_pin_find(mount, inode);
+
+    if(pin != NULL)
+    {
+        pin->count--;
+    }
+}
+
+/* vfs_pin_run
+ * 	Description: Takes a hold on a program file for a process that runs
+ *  it. Besides keeping the file from being unlinked, this keeps
+ *  write_data away from it until vfs_unpin_run.
+ * 	Inputs: mount, inode
+ * 	Outputs: Return 0, -1 if every pin is taken
+ * 	Side Effects: None
+ */
+int32_t vfs_pin_run(int32_t mount, uint32_t inode)
+{
+    if(vfs_pin(mount, inode) == -1)
+    {
+        return -1;
+    }
+    vfs_pin_find(mount, inode)->running++;
+    return 0;
+}
+
+/* vfs_unpin_run
+ * 	Description: Drops a hold taken by vfs_pin_run.
+ * 	Inputs: mount, inode
+ * 	Outputs: None
+ * 	Side Effects: None for an inode that is not pinned.
+ */
+void vfs_unpin_run(int32_t mount, uint32_t inode)
+{
+    vfs_pin_t* pin = vfs_pin_find(mount, inode);
+
+    if(pin != NULL && pin->running > 0)
+    {
+        pin->running--;
+    }
+    vfs_unpin(mount, inode);
+}
+
+/* vfs_running
+ * 	Description: Tells whether some process holds a file through
+ *  vfs_pin_run.
+ * 	Inputs: mount, inode
+ * 	Outputs: Return 1 if it does, 0 otherwise
+ * 	Side Effects: None
+ */
+int32_t vfs_running(int32_t mount, uint32_t inode)
+{
+    vfs_pin_t* pin = vfs_pin_find(mount, inode);
+
+    return (pin != NULL && pin->running > 0) ? 1 : 0;
+}
+
+/* vfs_unlink
+ * 	Description: Removes the file a path names through the backend of
+ *  its mount. Mount points themselves cannot be removed, nor can a file
+ *  that is pinned.
+ * 	Inputs: path
+ * 	Outputs: Return 0, -1 on failure
+ * 	Side Effects: The backend bumps its generation on success.
+ */
+int32_t vfs_unlink(const uint8_t* path)
+{
+    int32_t mount;
+    const uint8_t* rest;
+    vfs_backend_t* backend;
+    vnode_t node;
+
+    if(path == NULL || strlen((int8_t *)path) >= VFS_PATH_MAX)
+    {
+        return -1;
+    }
+
+    mount = vfs_resolve(path, &rest);
+    if(mount == -1 || *rest == '\0')
+    {
+        return -1;
+    }
+    backend = vfs_mounts[mount].backend;
+    if(backend->unlink == NULL)
+    {
+        return -1;
+    }
+
+    /* the backend would hand the inode out again while it is still used */
+    if(backend->lookup(rest, &node) == 0 && vfs_pin_find(mount, node.inode) != NULL)
+    {
+        return -1;
+    }
+    return backend->unlink(rest);
+}
+
+/* vfs_cache_flush
+ * 	Description: Forgets every remembered lookup.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Empties the path cache.
+ */
+void vfs_cache_flush()
+{
+    uint32_t i;
+
+    for(i = 0; i < VFS_CACHE_SIZE; i++)
+    {
+        vfs_cache[i].length = 0;
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ * vfs.h
+ * Virtual filesystem layer. Each backend (the filesystem image, the
+ * device filesystem, the RAM filesystem, the process filesystem) is
+ * mounted on a path and turns paths below it into vnodes: the backend's
+ * inode number plus the operations table for that kind of file. open, stat and unlink only
+ * talk to the VFS, so a new kind of file needs a backend and a mount,
+ * not a change to the system calls.
+ *
+ * Lookups are remembered in a path cache. A backend bumps its
+ * generation whenever a name goes away, which retires every cached
+ * path of that mount at once.
+ *
+ * Open files, file mappings and running programs pin the inode they
+ * use. Backends hand inode numbers out again once a file is removed,
+ * so a pinned file cannot be unlinked. A running program's pin also
+ * marks it running: its pages load from the file as they fault in, so
+ * the file cannot be written either.
+ */
+
+#ifndef _VFS_H
+#define _VFS_H
+
+#include "types.h"
+#include "stat.h"
+
+/* Magic numbers */
+#define VFS_MAX_MOUNTS      4
+#define VFS_MOUNT_LEN       16
+#define VFS_PATH_MAX        128
+#define VFS_CACHE_SIZE      64
+#define VFS_SEPARATOR       '/'
+#define VFS_ROOT_INODE      0
+#define VFS_IMAGE_MOUNT     0           /* the image is mounted first */
+#define VFS_MAX_PINS        128
+
+struct dirent;
+
+/* File operations table pointer structure */
+typedef struct file_operations_table_pointer
+{
+    int32_t (* read_ptr)    (uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+    int32_t (* write_ptr)   (int32_t fd, const void* buf, int32_t nbytes);
+    int32_t (* open_ptr)    (const uint8_t* filename);
+    int32_t (* close_ptr)   (int32_t fd);
+    int32_t (* stat_ptr)    (uint32_t inode, stat_t* buf);
+    int32_t (* getdents_ptr)(uint32_t inode, uint32_t index, struct dirent* buf, uint32_t count);
+} file_operations_table_pointer_t;
+
+/* A file found by path: where it lives, what it is and how to use it */
+typedef struct vnode
+{
+    int32_t mount;
+    uint32_t inode;
+    uint32_t type;
+    file_operations_table_pointer_t* ops;
+} vnode_t;
+
+/*
+ * A filesystem that can be mounted. Paths handed to the backend are
+ * relative to the mount point, "" being its root directory. unlink may
+ * be NULL for a backend whose names never change.
+ */
+typedef struct vfs_backend
+{
+    int32_t (* lookup)(const uint8_t* path, vnode_t* node);
+    int32_t (* unlink)(const uint8_t* path);
+    uint32_t* generation;
+} vfs_backend_t;
+
+/* A mount point, stored without its leading separator */
+typedef struct vfs_mount
+{
+    uint8_t path[VFS_MOUNT_LEN];
+    uint32_t length;
+    vfs_backend_t* backend;
+} vfs_mount_t;
+
+/* A remembered lookup, empty when length is 0 */
+typedef struct vfs_cache_entry
+{
+    uint32_t hash;
+    uint32_t length;
+    uint32_t generation;
+    uint8_t path[VFS_PATH_MAX];
+    vnode_t node;
+} vfs_cache_entry_t;
+
+/* An inode in use and how many holders it has, running counting the
+ * processes among them that run it; empty when count is 0 */
+typedef struct vfs_pin
+{
+    int32_t mount;
+    uint32_t inode;
+    uint32_t count;
+    uint32_t running;
+} vfs_pin_t;
+
+/* Path cache counters; stale counts hits retired by a generation change */
+typedef struct vfs_cache_stats
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t stale;
+} vfs_cache_stats_t;
+
+extern vfs_cache_stats_t vfs_cache_stats;
+
+/* Mount the image, the devices, the RAM filesystem and /proc */
+void vfs_init();
+
+/* Mount a backend on a path */
+int32_t vfs_mount(const uint8_t* path, vfs_backend_t* backend);
+
+/* Find the vnode a path names */
+int32_t vfs_lookup(const uint8_t* path, vnode_t* node);
+
+/* Remove the file a path names */
+int32_t vfs_unlink(const uint8_t* path);
+
+/* Keep a file from being unlinked until as many vfs_unpin calls */
+int32_t vfs_pin(int32_t mount, uint32_t inode);
+
+/* Drop one hold taken by vfs_pin */
+void vfs_unpin(int32_t mount, uint32_t inode);
+
+/* Pin a program file for a process running it */
+int32_t vfs_pin_run(int32_t mount, uint32_t inode);
+
+/* Drop a hold taken by vfs_pin_run */
+void vfs_unpin_run(int32_t mount, uint32_t inode);
+
+/* Tell whether a process is running a file */
+int32_t vfs_running(int32_t mount, uint32_t inode);
+
+/* Forget every remembered lookup */
+void vfs_cache_flush();
+
+#endif /* _VFS_H */
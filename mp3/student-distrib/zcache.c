@@ -0,0 +1,108 @@
+#include "types.h"
+#include "lib.h"
+#include "zcache.h"
+
+/* Cached blocks and the LRU clock */
+static zcache_entry_t zcache[ZCACHE_ENTRIES];
+static uint32_t zcache_clock = 0;
+
+zcache_stats_t zcache_stats;
+
+/* zcache_reset
+ * 	Description: Marks every entry empty. Called when a filesystem is
+ *  mounted, since inode numbers from another image mean nothing.
+ * 	Inputs: None
+ * 	Outputs: None
+ * 	Side Effects: Clears the cache and zcache_stats.
+ */
+void zcache_reset()
+{
+    int i;
+    for(i = 0; i < ZCACHE_ENTRIES; i++)
+    {
+        zcache[i].inode = ZCACHE_EMPTY;
+        zcache[i].last_used = 0;
+    }
+    zcache_clock = 0;
+    memset(&zcache_stats, 0, sizeof(zcache_stats));
+}
+
+/* zcache_lookup
+ * 	Description: Finds the decompressed copy of a file block.
+ * 	Inputs: inode, index (file block)
+ * 	Outputs: Return the block data, NULL if it is not cached
+ * 	Side Effects: Refreshes the LRU stamp of a hit and counts the lookup.
+ */
+uint8_t* zcache_lookup(uint32_t inode, uint32_t index)
+{
+    int i;
+
+    zcache_clock++;
+    for(i = 0; i < ZCACHE_ENTRIES; i++)
+    {
+        if(zcache[i].inode == (int32_t)inode && zcache[i].index == index)
+        {
+            zcache[i].last_used = zcache_clock;
+            zcache_stats.hits++;
+            return zcache[i].data;
+        }
+    }
+
+    zcache_stats.misses++;
+    return NULL;
+}
+
+/* zcache_claim
+ * 	Description: Hands out an empty entry, or the least recently used
+ *  one, for a block the caller is about to decode. The caller must
+ *  zcache_invalidate the inode if decoding fails.
+ * 	Inputs: inode, index (file block)
+ * 	Outputs: Return the buffer to decode into
+ * 	Side Effects: May evict another block.
+ */
+uint8_t* zcache_claim(uint32_t inode, uint32_t index)
+{
+    int i;
+    zcache_entry_t* victim = &zcache[0];
+
+    for(i = 0; i < ZCACHE_ENTRIES; i++)
+    {
+        if(zcache[i].inode == ZCACHE_EMPTY)
+        {
+            victim = &zcache[i];
+            break;
+        }
+        if(zcache[i].last_used < victim->last_used)
+        {
+            victim = &zcache[i];
+        }
+    }
+    if(victim->inode != ZCACHE_EMPTY)
+    {
+        zcache_stats.evictions++;
+    }
+
+    victim->inode = inode;
+    victim->index = index;
+    victim->last_used = zcache_clock;
+    return victim->data;
+}
+
+/* zcache_invalidate
+ * 	Description: Drops the cached blocks of an inode, after the file is
+ *  rewritten or removed.
+ * 	Inputs: inode
+ * 	Outputs: None
+ * 	Side Effects: Empties the matching entries.
+ */
+void zcache_invalidate(uint32_t inode)
+{
+    int i;
+    for(i = 0; i < ZCACHE_ENTRIES; i++)
+    {
+        if(zcache[i].inode == (int32_t)inode)
+        {
+            zcache[i].inode = ZCACHE_EMPTY;
+        }
+    }
+}
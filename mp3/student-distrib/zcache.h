@@ -0,0 +1,49 @@
+/*
+ * zcache.h
+ * Cache of decompressed file blocks, keyed by inode and file block.
+ * Reads of a compressed file decode each block once and then copy out
+ * of the cache until the entry is evicted.
+ */
+
+#ifndef _ZCACHE_H
+#define _ZCACHE_H
+
+#include "types.h"
+
+/* Magic numbers */
+#define ZCACHE_ENTRIES      32
+#define ZCACHE_BLOCK_SIZE   4096
+#define ZCACHE_EMPTY        -1
+
+/* One decompressed block */
+typedef struct zcache_entry
+{
+    int32_t inode;
+    uint32_t index;
+    uint32_t last_used;
+    uint8_t data[ZCACHE_BLOCK_SIZE];
+} zcache_entry_t;
+
+/* Lookup counters */
+typedef struct zcache_stats
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+} zcache_stats_t;
+
+extern zcache_stats_t zcache_stats;
+
+/* Find a decompressed block, NULL on a miss */
+uint8_t* zcache_lookup(uint32_t inode, uint32_t index);
+
+/* Take the least recently used entry for a block about to be decoded */
+uint8_t* zcache_claim(uint32_t inode, uint32_t index);
+
+/* Drop every cached block of an inode */
+void zcache_invalidate(uint32_t inode);
+
+/* Empty the cache and clear the counters */
+void zcache_reset();
+
+#endif /* _ZCACHE_H */
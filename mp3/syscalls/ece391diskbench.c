@@ -0,0 +1,134 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * diskbench FILE
+ * Reads FILE front to back once with PIO and once with DMA transfers
+ * and prints the sequential read rate of each.  Switching modes empties
+ * the kernel's buffer cache, so every pass reads the data disk.  The
+ * time stamp counter is calibrated against the RTC first.
+ */
+
+#define BUFSIZE 0x10000
+#define RTC_FREQ 32
+#define RTC_TICKS 16
+#define KCYCLE_SHIFT 10
+#define MS_PER_SEC 1000
+#define KB 1024
+
+static uint8_t buf[BUFSIZE];
+
+static uint64_t
+rdtsc (void)
+{
+    uint64_t t;
+    asm volatile ("rdtsc" : "=A" (t));
+    return t;
+}
+
+static void
+put_num (uint32_t n)
+{
+    uint8_t num[16];
+
+    ece391_itoa (n, num, 10);
+    ece391_fdputs (1, num);
+}
+
+/* Returns thousands of TSC cycles per millisecond, 0 on failure. */
+static uint32_t
+calibrate (void)
+{
+    int32_t fd, freq = RTC_FREQ, i, garbage;
+    uint64_t start;
+    uint32_t kcycles;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"rtc")))
+        return 0;
+    ece391_write (fd, &freq, 4);
+
+    /* start on a tick edge */
+    ece391_read (fd, &garbage, 4);
+    start = rdtsc ();
+    for (i = 0; i < RTC_TICKS; i++)
+	ece391_read (fd, &garbage, 4);
+    kcycles = (uint32_t)((rdtsc () - start) >> KCYCLE_SHIFT);
+    ece391_close (fd);
+
+    return kcycles / (RTC_TICKS * MS_PER_SEC / RTC_FREQ);
+}
+
+/* Reads the whole file once in the given mode and prints the rate. */
+static int32_t
+pass (int32_t fd, int32_t mode, const char* name, uint32_t kc_per_ms)
+{
+    int32_t cnt;
+    uint32_t total = 0, ms;
+    uint64_t start;
+
+    if (-1 == ece391_diskmode (mode)) {
+        ece391_fdputs (1, (uint8_t*)name);
+	ece391_fdputs (1, (uint8_t*)": not available\n");
+	return 0;
+    }
+    if (-1 == ece391_lseek (fd, 0, SEEK_SET))
+        return -1;
+
+    start = rdtsc ();
+    while (0 != (cnt = ece391_read (fd, buf, BUFSIZE))) {
+        if (-1 == cnt)
+	    return -1;
+	total += cnt;
+    }
+    ms = (uint32_t)((rdtsc () - start) >> KCYCLE_SHIFT) / kc_per_ms;
+    if (0 == ms)
+        ms = 1;
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, (uint8_t*)": ");
+    put_num (total / KB);
+    ece391_fdputs (1, (uint8_t*)" KB in ");
+    put_num (ms);
+    ece391_fdputs (1, (uint8_t*)" ms, ");
+    put_num (total / KB * MS_PER_SEC / ms);
+    ece391_fdputs (1, (uint8_t*)" KB/s\n");
+    return 0;
+}
+
+int main ()
+{
+    int32_t fd, old;
+    uint32_t kc_per_ms;
+
+    if (0 != ece391_getargs (buf, 1024)) {
+        ece391_fdputs (1, (uint8_t*)"usage: diskbench <file>\n");
+	return 3;
+    }
+
+    if (-1 == (old = ece391_diskmode (DISKMODE_QUERY))) {
+        ece391_fdputs (1, (uint8_t*)"the filesystem is not on the data disk\n");
+	return 2;
+    }
+
+    if (-1 == (fd = ece391_open (buf))) {
+        ece391_fdputs (1, (uint8_t*)"file not found\n");
+	return 2;
+    }
+
+    if (0 == (kc_per_ms = calibrate ())) {
+        ece391_fdputs (1, (uint8_t*)"could not calibrate the TSC\n");
+	return 3;
+    }
+
+    if (-1 == pass (fd, DISKMODE_PIO, "PIO", kc_per_ms) ||
+        -1 == pass (fd, DISKMODE_DMA, "DMA", kc_per_ms)) {
+        ece391_fdputs (1, (uint8_t*)"file read failed\n");
+	return 3;
+    }
+
+    ece391_diskmode (old);
+    ece391_close (fd);
+    return 0;
+}
@@ -3,13 +3,56 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
-#define BUFSIZE 1024
+#define BUFSIZE 0x10000
+#define ARGSIZE 1024
 #define SBUFSIZE 33
+#define MATCH_IOVS 4
+
+/* print "fname:line\n" with a single system call */
+static void
+print_match (const char* fname, const uint8_t* line, int32_t len)
+{
+    struct ece391_iovec iov[MATCH_IOVS];
+
+    iov[0].iov_base = (void*)fname;
+    iov[0].iov_len = ece391_strlen ((uint8_t*)fname);
+    iov[1].iov_base = ":";
+    iov[1].iov_len = 1;
+    iov[2].iov_base = (void*)line;
+    iov[2].iov_len = len;
+    iov[3].iov_base = "\n";
+    iov[3].iov_len = 1;
+    ece391_writev (1, iov, MATCH_IOVS);
+}
+
+/* search a file mapped in memory in place, one line at a time */
+static void
+search_mapped (const char* s, int32_t s_len, const char* fname,
+	       const uint8_t* data, int32_t len)
+{
+    int32_t line_start, line_end, check;
+
+    for (line_start = 0; line_start < len; line_start = line_end + 1) {
+	line_end = line_start;
+	while (line_end < len && '\n' != data[line_end])
+	    line_end++;
+	for (check = line_start; check + s_len <= line_end; check++) {
+	    if (s[0] == data[check] &&
+		0 == ece391_strncmp (data + check, (uint8_t*)s, s_len)) {
+		print_match (fname, data + line_start, line_end - line_start);
+		break;
+	    }
+	}
+    }
+}
 
 int32_t
 do_one_file (const char* s, const char* fname) 
 {
-    int32_t fd, cnt, last, line_start, line_end, check, s_len;
+    int32_t fd, cnt, last, line_start, line_end, check, s_len, want, done;
+    uint32_t left;
+    struct ece391_stat st;
+    uint8_t* map;
     uint8_t data[BUFSIZE+1];
 
     s_len = ece391_strlen ((uint8_t*)s);
@@ -17,20 +60,38 @@ do_one_file (const char* s, const char* fname)
         ece391_fdputs (1, (uint8_t*)"file open failed\n");
         return -1;
     }
+    /* with the size known, a file that fits is searched after one read */
+    if (-1 == ece391_fstat (fd, &st)) {
+        ece391_fdputs (1, (uint8_t*)"file stat failed\n");
+        return -1;
+    }
+    /* a file that maps is searched in place without any copying */
+    if (0 != st.size &&
+	ECE391_MAP_FAILED != (map = ece391_mmap (fd, st.size))) {
+	search_mapped (s, s_len, fname, map, st.size);
+	ece391_munmap (map, st.size);
+	left = 0;
+    } else
+	left = st.size;
     last = 0;
     while (1) {
-        cnt = ece391_read (fd, data + last, BUFSIZE - last);
+        want = BUFSIZE - last;
+	if (left < want)
+	    want = left;
+        cnt = (0 == want ? 0 : ece391_read (fd, data + last, want));
 	if (-1 == cnt) {
             ece391_fdputs (1, (uint8_t*)"file read failed\n");
             return -1;
 	}
 	last += cnt;
+	left -= cnt;
+	done = (0 == cnt || 0 == left);
 	line_start = 0;
 	while (1) {
 	    line_end = line_start;
 	    while (line_end < last && '\n' != data[line_end])
 		line_end++;
-	    if ('\n' != data[line_end] && 0 != cnt && line_start != 0) {
+	    if ('\n' != data[line_end] && !done && line_start != 0) {
 		/* copy from line_start to last down to 0 and fix last */
 		data[line_end] = '\0';
 		ece391_strcpy (data, data + line_start);
@@ -42,10 +103,8 @@ do_one_file (const char* s, const char* fname)
 	    for (check = line_start; check < line_end; check++) {
 		if (s[0] == data[check] && 
 		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
-		    ece391_fdputs (1, data + line_start);
-		    ece391_fdputs (1, (uint8_t*)"\n");
+		    print_match (fname, data + line_start,
+				 line_end - line_start);
 		    break;
 		}
 	    }
@@ -55,7 +114,7 @@ do_one_file (const char* s, const char* fname)
 		break;
 	    }
 	}
-	if (0 == cnt)
+	if (done)
 	    break;
     }
     if (-1 == ece391_close (fd)) {
@@ -69,9 +128,10 @@ int main ()
 {
     int32_t fd, cnt;
     uint8_t buf[SBUFSIZE];
-    uint8_t search[BUFSIZE];
+    uint8_t search[ARGSIZE];
+    struct ece391_stat st;
 
-    if (0 != ece391_getargs (search, BUFSIZE)) {
+    if (0 != ece391_getargs (search, ARGSIZE)) {
         ece391_fdputs (1, (uint8_t*)"could not read argument\n");
         return 3;
     }
@@ -86,9 +146,10 @@ int main ()
 	    ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	    return 3;
 	}
-	if ('.' == buf[0]) /* a directory... */
-	    continue;
 	buf[cnt] = '\0';
+	/* only regular files are searched */
+	if (-1 == ece391_stat (buf, &st) || STAT_TYPE_REGULAR != st.type)
+	    continue;
 	if (0 != do_one_file ((char*)search, (char*)buf))
 	    return 3;
     }
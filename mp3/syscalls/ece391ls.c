@@ -3,26 +3,58 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
-#define SBUFSIZE 33
+#define DIRENT_BATCH 16
+#define NAME_COLUMN  34
+#define NUM_BUFSIZE  11
+#define LINE_BUFSIZE 80
+#define ARG_BUFSIZE  128
+
+/* put a number right after the padded column */
+static uint32_t put_field (uint8_t* line, uint32_t pos, const uint8_t* label,
+			   uint32_t value)
+{
+    uint8_t num[NUM_BUFSIZE];
+
+    ece391_strcpy (line + pos, label);
+    pos += ece391_strlen (label);
+    ece391_itoa (value, num, 10);
+    ece391_strcpy (line + pos, num);
+    return pos + ece391_strlen (num);
+}
 
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, i, j, pos;
+    struct ece391_dirent ents[DIRENT_BATCH];
+    uint8_t line[LINE_BUFSIZE];
+    uint8_t dir[ARG_BUFSIZE];
 
-    if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
+    /* list the directory named by the argument, the root without one */
+    if (0 != ece391_getargs (dir, ARG_BUFSIZE) || '\0' == dir[0])
+        ece391_strcpy (dir, (uint8_t*)".");
+
+    if (-1 == (fd = ece391_open (dir))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    /* one call returns a whole batch of entries, sizes included */
+    while (0 != (cnt = ece391_getdents (fd, ents, sizeof (ents)))) {
         if (-1 == cnt) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
-	        return 3;
+	    for (i = 0; i < cnt / (int32_t)sizeof (ents[0]); i++) {
+	        for (j = 0; j < DIRENT_NAME_LEN && '\0' != ents[i].name[j]; j++)
+		        line[j] = ents[i].name[j];
+	        for (pos = j; pos < NAME_COLUMN; pos++)
+		        line[pos] = ' ';
+	        pos = put_field (line, pos, (uint8_t*)"type: ", ents[i].type);
+	        pos = put_field (line, pos, (uint8_t*)"  size: ", ents[i].size);
+	        line[pos] = '\n';
+	        if (-1 == ece391_write (1, line, pos + 1))
+		        return 3;
+	    }
     }
 
     return 0;
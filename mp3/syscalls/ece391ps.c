@@ -0,0 +1,73 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * ps [-a | FILE]
+ * Prints the process table from /proc/ps.  With -a it also prints the
+ * terminals, the page directory, the interrupt counts and the slab
+ * caches; with a name it prints that file of /proc alone.
+ */
+
+#define BUFSIZE     4096
+#define ARG_BUFSIZE 128
+#define PATH_BUFSIZE 160
+#define PROC_DIR    "/proc/"
+
+static uint8_t buf[BUFSIZE];
+
+/* Copies one /proc file to stdout, with a title line if asked. */
+static int32_t
+show (const uint8_t* name, int32_t title)
+{
+    int32_t fd, cnt;
+    uint8_t path[PATH_BUFSIZE];
+
+    if (ece391_strlen (name) + sizeof (PROC_DIR) > PATH_BUFSIZE)
+        return -1;
+    ece391_strcpy (path, (uint8_t*)PROC_DIR);
+    ece391_strcpy (path + sizeof (PROC_DIR) - 1, name);
+
+    if (-1 == (fd = ece391_open (path)))
+        return -1;
+
+    if (title) {
+        ece391_fdputs (1, (uint8_t*)"== ");
+	ece391_fdputs (1, path);
+	ece391_fdputs (1, (uint8_t*)" ==\n");
+    }
+
+    /* each read renders the file again, so take it in one piece */
+    cnt = ece391_read (fd, buf, BUFSIZE);
+    ece391_close (fd);
+    if (-1 == cnt || -1 == ece391_write (1, buf, cnt))
+        return -1;
+    return 0;
+}
+
+int main ()
+{
+    uint8_t arg[ARG_BUFSIZE];
+
+    if (0 != ece391_getargs (arg, ARG_BUFSIZE) || '\0' == arg[0])
+        ece391_strcpy (arg, (uint8_t*)"ps");
+
+    if (0 == ece391_strcmp (arg, (uint8_t*)"-a")) {
+        if (-1 == show ((uint8_t*)"ps", 1) ||
+	    -1 == show ((uint8_t*)"term", 1) ||
+	    -1 == show ((uint8_t*)"mem", 1) ||
+	    -1 == show ((uint8_t*)"irq", 1) ||
+	    -1 == show ((uint8_t*)"slab", 1)) {
+	    ece391_fdputs (1, (uint8_t*)"could not read /proc\n");
+	    return 3;
+	}
+	return 0;
+    }
+
+    if (-1 == show (arg, 0)) {
+        ece391_fdputs (1, (uint8_t*)"usage: ps [-a | ps | term | mem | irq | slab]\n");
+	return 2;
+    }
+    return 0;
+}
@@ -4,14 +4,156 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define NUMSIZE 12
+#define NAMESIZE 128
+
+/* Reports a background job that has finished. */
+static void
+job_done (int32_t pid, int32_t status)
+{
+    uint8_t num[NUMSIZE];
+
+    ece391_fdputs (1, (uint8_t*)"[");
+    ece391_fdputs (1, ece391_itoa (pid, num, 10));
+    ece391_fdputs (1, (uint8_t*)"] done, status ");
+    ece391_fdputs (1, ece391_itoa (status, num, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* 
+ * Strips a trailing '&' and the blanks around it.  Returns 1 if the
+ * command is to run in the background.
+ */
+static int32_t
+background (uint8_t* buf, int32_t cnt)
+{
+    while (cnt > 0 && ' ' == buf[cnt - 1])
+	cnt--;
+    if (0 == cnt || '&' != buf[cnt - 1])
+	return 0;
+    cnt--;
+    while (cnt > 0 && ' ' == buf[cnt - 1])
+	cnt--;
+    buf[cnt] = '\0';
+    return 1;
+}
+
+/*
+ * Cuts "< file" and "> file" out of the command and leaves the names in
+ * in and out, empty when not given.  Returns -1 if a '<' or '>' has no
+ * name after it.
+ */
+static int32_t
+redirections (uint8_t* buf, uint8_t* in, uint8_t* out)
+{
+    int32_t i = 0, j = 0, k;
+    uint8_t* name;
+
+    in[0] = out[0] = '\0';
+    while ('\0' != buf[i]) {
+	if ('<' != buf[i] && '>' != buf[i]) {
+	    buf[j++] = buf[i++];
+	    continue;
+	}
+	name = ('<' == buf[i]) ? in : out;
+	for (i++; ' ' == buf[i]; i++);
+	for (k = 0; '\0' != buf[i] && ' ' != buf[i] && '<' != buf[i] &&
+		    '>' != buf[i]; i++)
+	    if (k < NAMESIZE - 1)
+		name[k++] = buf[i];
+	name[k] = '\0';
+	if (0 == k)
+	    return -1;
+    }
+    while (j > 0 && ' ' == buf[j - 1])
+	j--;
+    buf[j] = '\0';
+    return 0;
+}
+
+/* 
+ * Creates an empty file by writing its name to the directory it goes
+ * in.  Returns -1 on failure.
+ */
+static int32_t
+make_file (const uint8_t* name)
+{
+    uint8_t dir[NAMESIZE];
+    int32_t i, slash = -1, fd, rval;
+
+    for (i = 0; '\0' != name[i]; i++)
+	if ('/' == name[i])
+	    slash = i;
+    if (-1 == slash)
+	ece391_strcpy (dir, (uint8_t*)".");
+    else if (0 == slash)
+	ece391_strcpy (dir, (uint8_t*)"/");
+    else {
+	for (i = 0; i < slash; i++)
+	    dir[i] = name[i];
+	dir[slash] = '\0';
+    }
+
+    if (-1 == (fd = ece391_open (dir)))
+	return -1;
+    rval = ece391_write (fd, name + slash + 1,
+			 ece391_strlen (name + slash + 1));
+    ece391_close (fd);
+    return rval;
+}
+
+/* 
+ * Opens name on descriptor fd.  If create is set, a regular file is
+ * truncated by removing it first, and the file is created if it does
+ * not exist; devices are opened as they are.  Returns a copy of what fd
+ * held before, for restore, or -1 if the file cannot be opened or an
+ * existing one cannot be emptied.
+ */
+static int32_t
+redirect (const uint8_t* name, int32_t fd, int32_t create)
+{
+    struct ece391_stat st;
+    int32_t file, saved;
+
+    if (create && 0 == ece391_stat (name, &st) &&
+	STAT_TYPE_REGULAR == st.type && -1 == ece391_unlink (name))
+	return -1;
+    if (-1 == (file = ece391_open (name)) &&
+	(!create || -1 == make_file (name) ||
+	 -1 == (file = ece391_open (name))))
+	return -1;
+    if (-1 == (saved = ece391_dup (fd))) {
+	ece391_close (file);
+	return -1;
+    }
+    ece391_dup2 (file, fd);
+    ece391_close (file);
+    return saved;
+}
+
+/* Puts back what redirect replaced on fd. */
+static void
+restore (int32_t saved, int32_t fd)
+{
+    if (-1 == saved)
+	return;
+    ece391_dup2 (saved, fd);
+    ece391_close (saved);
+}
 
 int main ()
 {
-    int32_t cnt, rval;
+    int32_t cnt, rval, pid, status, bg, saved_in, saved_out;
     uint8_t buf[BUFSIZE];
+    uint8_t in[NAMESIZE], out[NAMESIZE];
+    uint8_t num[NUMSIZE];
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
 
     while (1) {
+	/* report the jobs that finished while the last command ran */
+	while (0 < (pid = ece391_waitpid (ECE391_WAIT_ANY, &status,
+					  ECE391_WNOHANG)))
+	    job_done (pid, status);
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
@@ -22,9 +164,46 @@ int main ()
 	buf[cnt] = '\0';
 	if (0 == ece391_strcmp (buf, (uint8_t*)"exit"))
 	    return 0;
+	if (0 == ece391_strcmp (buf, (uint8_t*)"wait")) {
+	    while (0 < (pid = ece391_waitpid (ECE391_WAIT_ANY, &status, 0)))
+		job_done (pid, status);
+	    continue;
+	}
+	bg = background (buf, cnt);
+	if (-1 == redirections (buf, in, out)) {
+	    ece391_fdputs (1, (uint8_t*)"missing file name\n");
+	    continue;
+	}
 	if ('\0' == buf[0])
 	    continue;
+
+	/* the child inherits the shell's stdin and stdout, so swap them
+	   around the command */
+	saved_in = saved_out = -1;
+	if (('\0' != in[0] && -1 == (saved_in = redirect (in, 0, 0))) ||
+	    ('\0' != out[0] && -1 == (saved_out = redirect (out, 1, 1)))) {
+	    restore (saved_in, 0);
+	    ece391_fdputs (1, (uint8_t*)"cannot open ");
+	    ece391_fdputs (1, ('\0' != in[0] && -1 == saved_in) ? in : out);
+	    ece391_fdputs (1, (uint8_t*)"\n");
+	    continue;
+	}
+	if (bg) {
+	    pid = ece391_spawn (buf);
+	    restore (saved_in, 0);
+	    restore (saved_out, 1);
+	    if (-1 == pid) {
+		ece391_fdputs (1, (uint8_t*)"no such command\n");
+		continue;
+	    }
+	    ece391_fdputs (1, (uint8_t*)"[");
+	    ece391_fdputs (1, ece391_itoa (pid, num, 10));
+	    ece391_fdputs (1, (uint8_t*)"]\n");
+	    continue;
+	}
 	rval = ece391_execute (buf);
+	restore (saved_in, 0);
+	restore (saved_out, 1);
 	if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
 	else if (256 == rval)
@@ -21,6 +21,125 @@ extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+extern int32_t ece391_unlink (const uint8_t* filename);
+extern int32_t ece391_lseek (int32_t fd, int32_t offset, int32_t whence);
+extern int32_t ece391_pread (int32_t fd, void* buf, int32_t nbytes,
+			     int32_t offset);
+
+/*
+ * Record filled in by ece391_getdents.  The name is not NUL-terminated
+ * when it uses all 32 bytes; the size is 0 for anything but a regular
+ * file.
+ */
+#define DIRENT_NAME_LEN 32
+struct ece391_dirent {
+	uint8_t name[DIRENT_NAME_LEN];
+	uint32_t type;
+	uint32_t inode;
+	uint32_t size;
+};
+
+extern int32_t ece391_getdents (int32_t fd, struct ece391_dirent* buf,
+				int32_t nbytes);
+
+/*
+ * Record filled in by ece391_stat and ece391_fstat.  Types are those of
+ * the directory entries, plus STAT_TYPE_TERMINAL for stdin and stdout
+ * and STAT_TYPE_CHARDEV for /dev/null, /dev/zero and /dev/random.
+ */
+#define STAT_TYPE_RTC       0
+#define STAT_TYPE_DIRECTORY 1
+#define STAT_TYPE_REGULAR   2
+#define STAT_TYPE_TERMINAL  3
+#define STAT_TYPE_CHARDEV   4
+struct ece391_stat {
+	uint32_t type;
+	uint32_t inode;
+	uint32_t size;
+	uint32_t blocks;
+};
+
+extern int32_t ece391_stat (const uint8_t* filename, struct ece391_stat* buf);
+extern int32_t ece391_fstat (int32_t fd, struct ece391_stat* buf);
+
+/*
+ * ece391_mmap maps the first length bytes of an open regular file
+ * read-only, straight onto its data blocks; length may not exceed the
+ * file size.  It returns ECE391_MAP_FAILED on failure.
+ */
+#define ECE391_MAP_FAILED ((void*)-1)
+extern void* ece391_mmap (int32_t fd, int32_t length);
+extern int32_t ece391_munmap (void* addr, int32_t length);
+
+/*
+ * ece391_sync writes the filesystem back to the data disk when it was
+ * mounted from one.  ece391_diskmode picks PIO or DMA transfers for the
+ * disk and empties the buffer cache, returning the previous mode; pass
+ * DISKMODE_QUERY to only read the mode.  It fails without a data disk.
+ */
+#define DISKMODE_PIO   0
+#define DISKMODE_DMA   1
+#define DISKMODE_QUERY (-1)
+extern int32_t ece391_sync (void);
+extern int32_t ece391_diskmode (int32_t mode);
+
+/*
+ * ece391_sendfile moves up to count bytes from the position of in_fd to
+ * out_fd inside the kernel and advances in_fd.  Files sent to the
+ * terminal go out straight from their data blocks.  It returns the
+ * bytes taken from in_fd, 0 at its end.
+ */
+extern int32_t ece391_sendfile (int32_t out_fd, int32_t in_fd, int32_t count);
+
+/*
+ * ece391_readv and ece391_writev move data for each buffer of iov in
+ * turn, stopping after one that is not filled, and return the total.
+ * The terminal takes a whole writev as a single write.  At most
+ * ECE391_IOV_MAX buffers may be given.
+ */
+#define ECE391_IOV_MAX 16
+struct ece391_iovec {
+	void* iov_base;
+	int32_t iov_len;
+};
+
+extern int32_t ece391_readv (int32_t fd, const struct ece391_iovec* iov,
+			     int32_t iovcnt);
+extern int32_t ece391_writev (int32_t fd, const struct ece391_iovec* iov,
+			      int32_t iovcnt);
+
+/*
+ * ece391_spawn starts a program like ece391_execute but returns at once
+ * with the pid of the child, which runs alongside its parent on the
+ * same terminal and reads its standard input from /dev/null if it
+ * would otherwise read the keyboard.
+ * ece391_waitpid collects the halt status of a spawned child, or of any
+ * one with ECE391_WAIT_ANY, and returns its pid.  It waits for the child
+ * to halt unless ECE391_WNOHANG is given, in which case it returns 0
+ * while the child still runs.  It fails if there is no such child.
+ */
+#define ECE391_WAIT_ANY (-1)
+#define ECE391_WNOHANG  1
+extern int32_t ece391_spawn (const uint8_t* command);
+extern int32_t ece391_waitpid (int32_t pid, int32_t* status,
+			       int32_t options);
+
+/*
+ * ece391_dup opens the lowest free descriptor past stdout on the same
+ * open file as fd, so the two share one position.  ece391_dup2 points
+ * newfd at the open file of oldfd, closing newfd first; it may replace
+ * stdin and stdout.  Children started with ece391_execute or
+ * ece391_spawn inherit every open descriptor.  A process may hold up to
+ * ECE391_OPEN_MAX descriptors.
+ */
+#define ECE391_OPEN_MAX 64
+extern int32_t ece391_dup (int32_t fd);
+extern int32_t ece391_dup2 (int32_t oldfd, int32_t newfd);
+
+/* whence values for ece391_lseek */
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
 
 enum signums {
 	DIV_ZERO = 0,
@@ -11,5 +11,22 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_UNLINK  11
+#define SYS_LSEEK   12
+#define SYS_PREAD   13
+#define SYS_GETDENTS 14
+#define SYS_STAT    15
+#define SYS_FSTAT   16
+#define SYS_MMAP    17
+#define SYS_MUNMAP  18
+#define SYS_SYNC    19
+#define SYS_DISKMODE 20
+#define SYS_SENDFILE 21
+#define SYS_READV 22
+#define SYS_WRITEV 23
+#define SYS_SPAWN 24
+#define SYS_WAITPID 25
+#define SYS_DUP 26
+#define SYS_DUP2 27
 
 #endif /* ECE391SYSNUM_H */